@@ -0,0 +1,122 @@
+# Shared plumbing of our benchmark scripts: timing loop, environment metadata and JSON output.
+#
+# A benchmark is a function which sets up its fixtures and returns a callable performing one operation
+# (or `inner` operations, e.g. when the loop runs in JS). We calibrate the number of loops so that one repeat takes
+# at least `min_time` seconds, do one warm-up repeat and report statistics over the remaining repeats.
+# The median is the number to compare, min/max/stdev tell how noisy the machine was.
+
+import gc
+import json
+import os
+import platform
+import re
+import statistics
+import subprocess
+import sys
+import time
+
+SCHEMA_VERSION = 1
+
+
+class Registry:
+    def __init__(self):
+        self.benchmarks = []
+
+    def register(self, name, inner=1):
+        def decorator(fn):
+            self.benchmarks.append((name, fn, inner))
+            return fn
+
+        return decorator
+
+    def select(self, pattern=None):
+        if not pattern:
+            return list(self.benchmarks)
+        regex = re.compile(pattern)
+        return [b for b in self.benchmarks if regex.search(b[0])]
+
+
+def git_revision():
+    root = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    try:
+        out = subprocess.run(["git", "rev-parse", "--short", "HEAD"], cwd=root, stdout=subprocess.PIPE,
+                             stderr=subprocess.DEVNULL, universal_newlines=True, check=True)
+        return out.stdout.strip()
+    except (OSError, subprocess.CalledProcessError):
+        return None
+
+
+def environment(label=None):
+    import naga.aux
+
+    return {
+        "label": label,
+        "timestamp": time.strftime("%Y-%m-%dT%H:%M:%S%z"),
+        "git_revision": os.environ.get("NAGA_BENCH_REVISION") or git_revision(),
+        "build": naga.aux.build_info(),
+        "python": sys.version.split()[0],
+        "platform": platform.platform(),
+        "machine": platform.machine(),
+        "cpu_count": os.cpu_count(),
+    }
+
+
+def time_op(op, loops):
+    timer = time.perf_counter
+    start = timer()
+    for _ in range(loops):
+        op()
+    return timer() - start
+
+
+def calibrate(op, min_time):
+    loops = 1
+    while True:
+        elapsed = time_op(op, loops)
+        if elapsed >= min_time or loops >= 1 << 30:
+            return loops
+        # aim a bit above min_time to avoid another round
+        loops = max(loops * 2, int(loops * min_time * 1.2 / max(elapsed, 1e-9)))
+
+
+def measure(op, inner=1, repeats=7, min_time=0.05):
+    gc_was_enabled = gc.isenabled()
+    gc.collect()
+    gc.disable()
+    try:
+        loops = calibrate(op, min_time)
+        time_op(op, loops)  # warm-up
+        samples = [time_op(op, loops) / (loops * inner) * 1e9 for _ in range(repeats)]
+    finally:
+        if gc_was_enabled:
+            gc.enable()
+    return {
+        "ns_per_op": statistics.median(samples),
+        "min": min(samples),
+        "max": max(samples),
+        "stdev": statistics.stdev(samples) if len(samples) > 1 else 0.0,
+        "loops": loops,
+        "inner": inner,
+        "repeats": repeats,
+    }
+
+
+def run(registry, pattern=None, repeats=7, min_time=0.05, label=None, log=sys.stderr):
+    results = {}
+    for name, setup, inner in registry.select(pattern):
+        op = setup()
+        results[name] = measure(op, inner=inner, repeats=repeats, min_time=min_time)
+        if log:
+            print("{:<40} {:>12.1f} ns/op  (±{:.1f})".format(name, results[name]["ns_per_op"], results[name]["stdev"]),
+                  file=log)
+    return {"schema": SCHEMA_VERSION, "meta": environment(label), "results": results}
+
+
+def write(report, path):
+    if path == "-":
+        json.dump(report, sys.stdout, indent=2, sort_keys=True)
+        sys.stdout.write("\n")
+        return
+    with open(path, "w") as f:
+        json.dump(report, f, indent=2, sort_keys=True)
+        f.write("\n")
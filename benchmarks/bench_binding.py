@@ -0,0 +1,226 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+# Microbenchmarks of the binding hot paths.
+#
+# usage: python3 bench_binding.py [--filter REGEX] [--output results.json] [--label release-pch]
+# compare two runs with: python3 compare.py before.json after.json
+
+import argparse
+import datetime
+import os
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+
+import _harness
+from naga import JSContext, JSEngine, JSError
+
+suite = _harness.Registry()
+benchmark = suite.register
+
+# these get initialized in main, benchmarks run inside a single entered context
+ctx = None
+engine = None
+
+
+class Payload:
+    def __init__(self):
+        self.x = 1
+
+
+def js_loop(body, n):
+    # runs the body n times inside JS, so we measure callbacks without Python loop overhead
+    return engine.compile("(function() {{ for (var i = 0; i < {}; i++) {{ {} }} }})()".format(n, body)).run
+
+
+# -- eval/compile ------------------------------------------------------------------------------------------------------
+
+@benchmark("eval.trivial")
+def bench_eval_trivial():
+    return lambda: ctx.eval("1")
+
+
+@benchmark("compile.small")
+def bench_compile_small():
+    src = "function add(a, b) { return a + b }; add(1, 2)"
+    return lambda: engine.compile(src)
+
+
+@benchmark("script.run")
+def bench_script_run():
+    return engine.compile("1 + 2").run
+
+
+# -- function calls by arity -------------------------------------------------------------------------------------------
+
+def register_call(arity):
+    @benchmark("call.arity{}".format(arity))
+    def bench_call():
+        fn = ctx.eval("(function(a, b, c, d) { return a })")
+        args = list(range(arity))
+        return lambda: fn(*args)
+
+
+for call_arity in range(5):
+    register_call(call_arity)
+
+
+# -- attributes --------------------------------------------------------------------------------------------------------
+
+@benchmark("attr.get")
+def bench_attr_get():
+    obj = ctx.eval("({x: 1})")
+    return lambda: obj.x
+
+
+@benchmark("attr.set")
+def bench_attr_set():
+    obj = ctx.eval("({x: 1})")
+    return lambda: setattr(obj, "x", 2)
+
+
+# -- arrays ------------------------------------------------------------------------------------------------------------
+
+@benchmark("array.iterate", inner=1000)
+def bench_array_iterate():
+    arr = ctx.eval("Array.from({length: 1000}, (_, i) => i)")
+
+    def op():
+        for _ in arr:
+            pass
+
+    return op
+
+
+# -- strings by size and encoding --------------------------------------------------------------------------------------
+
+STRING_CHARS = {"ascii": "a", "latin1": "é", "ucs2": "ž", "astral": "😀"}
+STRING_SIZES = {"16": 16, "1k": 1024, "64k": 64 * 1024}
+
+
+def register_strings(encoding, size_name):
+    text = STRING_CHARS[encoding] * STRING_SIZES[size_name]
+
+    @benchmark("str.py_to_js.{}.{}".format(encoding, size_name))
+    def bench_py_to_js():
+        sink = ctx.eval("(function(s) {})")
+        return lambda: sink(text)
+
+    @benchmark("str.js_to_py.{}.{}".format(encoding, size_name))
+    def bench_js_to_py():
+        source = ctx.eval("(function(s) { return function() { return s } })")(text)
+        return source
+
+
+for string_encoding in STRING_CHARS:
+    for string_size in STRING_SIZES:
+        register_strings(string_encoding, string_size)
+
+
+# -- tracer ------------------------------------------------------------------------------------------------------------
+
+@benchmark("tracer.hit")
+def bench_tracer_hit():
+    sink = ctx.eval("(function(o) {})")
+    payload = Payload()
+    return lambda: sink(payload)
+
+
+@benchmark("tracer.miss")
+def bench_tracer_miss():
+    sink = ctx.eval("(function(o) {})")
+    return lambda: sink(Payload())
+
+
+# -- interceptor callbacks ---------------------------------------------------------------------------------------------
+
+@benchmark("callback.named_get", inner=1000)
+def bench_named_get():
+    ctx.locals.bench_payload = Payload()
+    return js_loop("bench_payload.x", 1000)
+
+
+@benchmark("callback.named_set", inner=1000)
+def bench_named_set():
+    ctx.locals.bench_payload = Payload()
+    return js_loop("bench_payload.x = i", 1000)
+
+
+@benchmark("callback.indexed_get", inner=1000)
+def bench_indexed_get():
+    ctx.locals.bench_list = list(range(10))
+    return js_loop("bench_list[3]", 1000)
+
+
+@benchmark("callback.call", inner=1000)
+def bench_callback_call():
+    ctx.locals.bench_fn = lambda a: a
+    return js_loop("bench_fn(i)", 1000)
+
+
+# -- exceptions --------------------------------------------------------------------------------------------------------
+
+@benchmark("exception.js_to_py")
+def bench_exception_js_to_py():
+    thrower = ctx.eval("(function() { throw new Error('boom') })")
+
+    def op():
+        try:
+            thrower()
+        except JSError:
+            pass
+
+    return op
+
+
+@benchmark("exception.py_to_js", inner=100)
+def bench_exception_py_to_js():
+    def raiser():
+        raise ValueError("boom")
+
+    ctx.locals.bench_raiser = raiser
+    return js_loop("try { bench_raiser() } catch (e) {}", 100)
+
+
+# -- dates -------------------------------------------------------------------------------------------------------------
+
+@benchmark("date.py_to_js")
+def bench_date_py_to_js():
+    sink = ctx.eval("(function(d) {})")
+    now = datetime.datetime.now()
+    return lambda: sink(now)
+
+
+@benchmark("date.js_to_py")
+def bench_date_js_to_py():
+    return ctx.eval("(function() { var d = new Date(); return function() { return d } })()")
+
+
+def main(argv=None):
+    global ctx, engine
+
+    parser = argparse.ArgumentParser(description="naga binding microbenchmarks")
+    parser.add_argument("--filter", help="only run benchmarks with names matching this regex")
+    parser.add_argument("--output", default="-", help="where to write JSON results, '-' means stdout")
+    parser.add_argument("--label", help="free-form label stored with results, e.g. 'release-pch'")
+    parser.add_argument("--repeats", type=int, default=7)
+    parser.add_argument("--min-time", type=float, default=0.05, help="minimal duration of one repeat in seconds")
+    parser.add_argument("--list", action="store_true", help="list benchmark names and exit")
+    args = parser.parse_args(argv)
+
+    if args.list:
+        for name, _, _ in suite.select(args.filter):
+            print(name)
+        return 0
+
+    with JSContext() as ctx:
+        with JSEngine() as engine:
+            report = _harness.run(suite, pattern=args.filter, repeats=args.repeats, min_time=args.min_time,
+                                  label=args.label)
+    _harness.write(report, args.output)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
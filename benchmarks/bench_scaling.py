@@ -0,0 +1,230 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+# Scaling benchmark: throughput and latency percentiles as we add Python threads per isolate, isolates per process
+# and contexts per isolate.
+#
+# Every operation locks and enters an isolate and a context, runs one unit of a workload and leaves again.
+# That way the numbers include what real embedders pay: IsolateLockerHolder, JSContext::Enter/Leave and the GIL
+# handoffs around them. Latency of an operation is measured from the moment the thread starts waiting for the lock.
+#
+# dimensions:
+#   threads   - N Python threads share one isolate, each thread has its own context
+#   isolates  - N Python threads, each with its own isolate
+#   contexts  - one thread round-robins over N contexts of one isolate
+#
+# workloads:
+#   js          - pure JS computation, the GIL should not matter much
+#   callback    - JS calling back into Python in a loop
+#   conversion  - Python values converted into JS and the result converted back
+#   mixed       - all of the above in rotation
+#
+# usage: python3 bench_scaling.py [--dimension threads] [--workload mixed] [--levels 1,2,4,8] [--duration 2]
+#                                 [--format csv|json] [--output results.csv]
+
+import argparse
+import csv
+import json
+import os
+import statistics
+import sys
+import threading
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+
+import _harness
+from naga import JSIsolate, JSContext
+
+DIMENSIONS = ["threads", "isolates", "contexts"]
+WORKLOADS = ["js", "callback", "conversion", "mixed"]
+
+
+def make_js_op(ctx):
+    fn = ctx.eval("(function() { var s = 0; for (var i = 0; i < 2000; i++) { s += i * i % 7 } return s })")
+    return fn
+
+
+def make_callback_op(ctx):
+    counter = [0]
+
+    def tick(i):
+        counter[0] += i
+        return i
+
+    fn = ctx.eval("(function(tick) { var s = 0; for (var i = 0; i < 50; i++) { s += tick(i) } return s })")
+    return lambda: fn(tick)
+
+
+def make_conversion_op(ctx):
+    fn = ctx.eval("(function(name, items, meta) { return [name.length, items.length, meta.id, String(items[0])] })")
+    name = "conversion-" * 20
+    items = list(range(20))
+    meta = {"id": 42, "tags": ["a", "b"]}
+
+    def op():
+        result = fn(name, items, meta)
+        return list(result)
+
+    return op
+
+
+def make_mixed_op(ctx):
+    ops = [make_js_op(ctx), make_callback_op(ctx), make_conversion_op(ctx)]
+    state = [0]
+
+    def op():
+        state[0] = (state[0] + 1) % len(ops)
+        return ops[state[0]]()
+
+    return op
+
+
+OP_FACTORIES = {
+    "js": make_js_op,
+    "callback": make_callback_op,
+    "conversion": make_conversion_op,
+    "mixed": make_mixed_op,
+}
+
+
+class Slot:
+    """An isolate + context pair with a prepared workload operation."""
+
+    def __init__(self, isolate, workload):
+        self.isolate = isolate
+        with isolate:
+            self.ctx = JSContext()
+            with self.ctx:
+                self.op = OP_FACTORIES[workload](self.ctx)
+
+    def run_once(self):
+        with self.isolate:
+            with self.ctx:
+                self.op()
+
+
+def percentile(sorted_values, p):
+    if not sorted_values:
+        return 0.0
+    k = (len(sorted_values) - 1) * p / 100.0
+    lo = int(k)
+    hi = min(lo + 1, len(sorted_values) - 1)
+    return sorted_values[lo] + (sorted_values[hi] - sorted_values[lo]) * (k - lo)
+
+
+def drive(workers, duration):
+    """Runs each worker (a list of slots) in its own thread for duration seconds, returns per-op latencies."""
+    latencies = [[] for _ in workers]
+    start_barrier = threading.Barrier(len(workers) + 1)
+    deadline = [0.0]
+
+    def worker_main(index, slots):
+        timer = time.perf_counter
+        out = latencies[index]
+        start_barrier.wait()
+        i = 0
+        while True:
+            begin = timer()
+            if begin >= deadline[0]:
+                break
+            slots[i % len(slots)].run_once()
+            out.append(timer() - begin)
+            i += 1
+
+    threads = [threading.Thread(target=worker_main, args=(i, slots)) for i, slots in enumerate(workers)]
+    for t in threads:
+        t.start()
+    deadline[0] = time.perf_counter() + duration
+    start = time.perf_counter()
+    start_barrier.wait()
+    for t in threads:
+        t.join()
+    wall = time.perf_counter() - start
+    return [lat for per_thread in latencies for lat in per_thread], wall
+
+
+def build_workers(dimension, level, workload):
+    if dimension == "threads":
+        isolate = JSIsolate()
+        return [[Slot(isolate, workload)] for _ in range(level)]
+    if dimension == "isolates":
+        return [[Slot(JSIsolate(), workload)] for _ in range(level)]
+    if dimension == "contexts":
+        isolate = JSIsolate()
+        return [[Slot(isolate, workload) for _ in range(level)]]
+    raise ValueError("unknown dimension '{}'".format(dimension))
+
+
+def measure(dimension, level, workload, duration):
+    workers = build_workers(dimension, level, workload)
+    # one short warm-up run lets V8 optimize the workload functions
+    drive(workers, min(duration / 10, 0.2))
+    latencies, wall = drive(workers, duration)
+    latencies.sort()
+    to_ms = 1000.0
+    return {
+        "dimension": dimension,
+        "level": level,
+        "workload": workload,
+        "ops": len(latencies),
+        "seconds": wall,
+        "throughput": len(latencies) / wall if wall else 0.0,
+        "mean_ms": statistics.mean(latencies) * to_ms if latencies else 0.0,
+        "p50_ms": percentile(latencies, 50) * to_ms,
+        "p99_ms": percentile(latencies, 99) * to_ms,
+        "max_ms": latencies[-1] * to_ms if latencies else 0.0,
+    }
+
+
+def write_csv(rows, out):
+    fields = ["dimension", "level", "workload", "ops", "seconds", "throughput", "mean_ms", "p50_ms", "p99_ms",
+              "max_ms"]
+    writer = csv.DictWriter(out, fieldnames=fields)
+    writer.writeheader()
+    for row in rows:
+        writer.writerow(row)
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description="naga scaling benchmark")
+    parser.add_argument("--dimension", action="append", choices=DIMENSIONS,
+                        help="what to scale, can be repeated (default: all)")
+    parser.add_argument("--workload", action="append", choices=WORKLOADS,
+                        help="workload to run, can be repeated (default: all)")
+    parser.add_argument("--levels", default="1,2,4,8", help="comma separated scaling levels")
+    parser.add_argument("--duration", type=float, default=2.0, help="seconds per measurement")
+    parser.add_argument("--format", choices=["csv", "json"], default="csv")
+    parser.add_argument("--output", default="-", help="where to write results, '-' means stdout")
+    parser.add_argument("--label", help="free-form label stored with JSON results")
+    args = parser.parse_args(argv)
+
+    dimensions = args.dimension or DIMENSIONS
+    workloads = args.workload or WORKLOADS
+    levels = [int(level) for level in args.levels.split(",")]
+
+    rows = []
+    for dimension in dimensions:
+        for workload in workloads:
+            for level in levels:
+                row = measure(dimension, level, workload, args.duration)
+                print("{dimension:<9} {level:>3} {workload:<11} {throughput:>10.0f} ops/s  "
+                      "p50 {p50_ms:.3f} ms  p99 {p99_ms:.3f} ms".format(**row), file=sys.stderr)
+                rows.append(row)
+
+    out = sys.stdout if args.output == "-" else open(args.output, "w", newline="")
+    try:
+        if args.format == "csv":
+            write_csv(rows, out)
+        else:
+            json.dump({"schema": _harness.SCHEMA_VERSION, "meta": _harness.environment(args.label), "rows": rows},
+                      out, indent=2, sort_keys=True)
+            out.write("\n")
+    finally:
+        if out is not sys.stdout:
+            out.close()
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,82 @@
+#!/usr/bin/env python
+
+# Compares two JSON results produced by our benchmark scripts.
+#
+# usage: python3 compare.py before.json after.json [--threshold 5] [--fail-on-regression]
+#
+# A change is reported as significant when the medians differ by more than threshold percent and the difference is
+# larger than the combined standard deviations of both runs.
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        report = json.load(f)
+    return report["meta"], report["results"]
+
+
+def describe(meta):
+    build = meta.get("build", {})
+    flavor = "debug" if build.get("debug") else "release"
+    pch = "pch" if build.get("precompiled_headers") else "no-pch"
+    parts = [meta.get("label"), meta.get("git_revision"), flavor, pch, "v8 " + str(build.get("v8_version"))]
+    return " ".join(p for p in parts if p)
+
+
+def compare(before, after, threshold):
+    rows = []
+    for name in sorted(set(before) | set(after)):
+        if name not in before or name not in after:
+            rows.append((name, before.get(name), after.get(name), None, "missing"))
+            continue
+        b, a = before[name], after[name]
+        ratio = a["ns_per_op"] / b["ns_per_op"] if b["ns_per_op"] else float("inf")
+        delta = a["ns_per_op"] - b["ns_per_op"]
+        noise = a["stdev"] + b["stdev"]
+        if abs(ratio - 1) * 100 <= threshold or abs(delta) <= noise:
+            verdict = ""
+        elif ratio > 1:
+            verdict = "slower"
+        else:
+            verdict = "faster"
+        rows.append((name, b, a, ratio, verdict))
+    return rows
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description="compare naga benchmark results")
+    parser.add_argument("before")
+    parser.add_argument("after")
+    parser.add_argument("--threshold", type=float, default=5.0, help="ignore changes below this many percent")
+    parser.add_argument("--fail-on-regression", action="store_true", help="exit with 1 when anything got slower")
+    args = parser.parse_args(argv)
+
+    before_meta, before = load(args.before)
+    after_meta, after = load(args.after)
+    print("before: " + describe(before_meta))
+    print("after:  " + describe(after_meta))
+    print()
+
+    rows = compare(before, after, args.threshold)
+    print("{:<40} {:>12} {:>12} {:>8}".format("benchmark", "before ns", "after ns", "ratio"))
+    regressions = 0
+    for name, b, a, ratio, verdict in rows:
+        if ratio is None:
+            print("{:<40} {:>12} {:>12} {:>8}  {}".format(name, "-" if b is None else "{:.1f}".format(b["ns_per_op"]),
+                                                          "-" if a is None else "{:.1f}".format(a["ns_per_op"]), "",
+                                                          verdict))
+            continue
+        print("{:<40} {:>12.1f} {:>12.1f} {:>8.3f}  {}".format(name, b["ns_per_op"], a["ns_per_op"], ratio, verdict))
+        if verdict == "slower":
+            regressions += 1
+
+    if args.fail_on_regression and regressions:
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,167 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+# Soak harness: runs workload mixes for a long time and watches resource counters for unbounded growth.
+#
+# Every sample interval we force a full GC (both V8 and Python) and record:
+#   rss_kb              - resident set size of the process
+#   heap_used           - V8 used heap size of the soaked isolate
+#   tracer_live/zombie  - JSTracer records (see JSTracer.h)
+#   hospital_patients   - JSHospital records
+#   global_handles      - our tagged v8::Global handles (see v8x::countGlobalHandles)
+#   handle_scope_level  - ObservedHandleScope nesting, must be back to zero between operations
+#                         (always zero in builds without naga_enable_tracing)
+#
+# Samples taken during the warm-up period are ignored. For the rest we compare the first and the last third of
+# samples, a metric fails when it grew by more than its tolerance and the samples trend upwards.
+#
+# usage: python3 soak.py [--duration 3600] [--interval 10] [--workload mixed] [--output samples.json]
+
+import argparse
+import gc
+import json
+import os
+import statistics
+import sys
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+
+import _harness
+import bench_scaling
+import naga.aux as aux
+from naga import JSIsolate, JSContext
+
+# absolute slack for each metric on top of relative tolerance, so tiny counters don't trip on noise
+ABSOLUTE_TOLERANCES = {
+    "rss_kb": 8 * 1024,
+    "heap_used": 1024 * 1024,
+    "tracer_live": 16,
+    "tracer_zombie": 16,
+    "hospital_patients": 16,
+    "global_handles": 16,
+    "handle_scope_level": 0,
+}
+
+
+class Payload:
+    def __init__(self, i):
+        self.i = i
+
+
+def make_churn_op(ctx):
+    """Creates short-lived contexts, JS objects and traced Python objects."""
+    keep = ctx.eval("(function(o) { return {o: o, list: [o, o.i]} })")
+
+    def op():
+        with JSContext() as tmp:
+            tmp.eval("var garbage = []; for (var i = 0; i < 100; i++) garbage.push({i: i})")
+        result = keep(Payload(1))
+        return result.list[1]
+
+    return op
+
+
+WORKLOADS = dict(bench_scaling.OP_FACTORIES, churn=make_churn_op)
+
+
+def rss_kb():
+    try:
+        with open("/proc/self/statm") as f:
+            pages = int(f.read().split()[1])
+        return pages * os.sysconf("SC_PAGE_SIZE") // 1024
+    except (OSError, ValueError):
+        import resource
+        # peak RSS only, still catches unbounded growth
+        usage = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+        return usage // 1024 if sys.platform == "darwin" else usage
+
+
+def take_sample(isolate, elapsed, ops):
+    aux.v8_request_gc_for_testing()
+    gc.collect()
+    tracer = aux.tracer_stats()
+    handles = aux.handle_stats()
+    return {
+        "elapsed": elapsed,
+        "ops": ops,
+        "rss_kb": rss_kb(),
+        "heap_used": isolate.stats()["heap"]["used_heap_size"],
+        "tracer_live": tracer["live"],
+        "tracer_zombie": tracer["zombie"],
+        "hospital_patients": aux.hospital_stats()["patients"],
+        "global_handles": handles["global_total"],
+        "handle_scope_level": handles["handle_scope_level"],
+    }
+
+
+def find_growth(samples, relative_tolerance):
+    """Returns {metric: description} of metrics growing without bound."""
+    failures = {}
+    if len(samples) < 6:
+        return failures
+    third = len(samples) // 3
+    for metric, absolute_tolerance in ABSOLUTE_TOLERANCES.items():
+        values = [s[metric] for s in samples]
+        first = statistics.median(values[:third])
+        middle = statistics.median(values[third:-third])
+        last = statistics.median(values[-third:])
+        allowed = first + max(absolute_tolerance, first * relative_tolerance)
+        if last > allowed and middle >= first and last >= middle:
+            failures[metric] = "grew from {} to {} (allowed {:.0f})".format(first, last, allowed)
+    return failures
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description="naga soak harness")
+    parser.add_argument("--duration", type=float, default=600.0, help="total run time in seconds")
+    parser.add_argument("--interval", type=float, default=10.0, help="seconds between samples")
+    parser.add_argument("--warmup", type=float, default=0.2, help="fraction of duration ignored by trend checks")
+    parser.add_argument("--workload", action="append", choices=sorted(WORKLOADS),
+                        help="workload to mix in, can be repeated (default: all)")
+    parser.add_argument("--tolerance", type=float, default=0.05, help="allowed relative growth of each metric")
+    parser.add_argument("--output", help="where to write JSON with all samples")
+    args = parser.parse_args(argv)
+
+    workloads = args.workload or sorted(WORKLOADS)
+    isolate = JSIsolate()
+    samples = []
+    with isolate:
+        with JSContext() as ctx:
+            ops = [WORKLOADS[name](ctx) for name in workloads]
+            start = time.perf_counter()
+            total_ops = 0
+            while True:
+                elapsed = time.perf_counter() - start
+                if elapsed >= args.duration:
+                    break
+                interval_end = min(elapsed + args.interval, args.duration)
+                i = 0
+                while time.perf_counter() - start < interval_end:
+                    ops[i % len(ops)]()
+                    i += 1
+                total_ops += i
+                sample = take_sample(isolate, time.perf_counter() - start, total_ops)
+                samples.append(sample)
+                print("{elapsed:8.1f}s rss {rss_kb} kB  heap {heap_used}  tracer {tracer_live}/{tracer_zombie}  "
+                      "hospital {hospital_patients}  globals {global_handles}  scopes {handle_scope_level}"
+                      .format(**sample), file=sys.stderr)
+
+    measured = [s for s in samples if s["elapsed"] >= args.duration * args.warmup]
+    failures = find_growth(measured, args.tolerance)
+    if any(s["handle_scope_level"] for s in samples):
+        failures["handle_scope_level"] = "handle scopes leaked between operations"
+
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump({"schema": _harness.SCHEMA_VERSION, "meta": _harness.environment(), "workloads": workloads,
+                       "samples": samples, "failures": failures}, f, indent=2, sort_keys=True)
+            f.write("\n")
+
+    for metric, description in sorted(failures.items()):
+        print("UNBOUNDED GROWTH: {} {}".format(metric, description), file=sys.stderr)
+    return 1 if failures else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,59 @@
+# This module builds naga bundles, see JSBundle.
+#
+#   python -m naga.bundle -o app.nbundle --root src src/polyfills.js src/app/main.mjs src/app/util.mjs
+#
+# Bundle names are file paths relative to --root with forward slashes. Files ending with .mjs and files passed via
+# --module are compiled as ES modules, other files as classic scripts. Relative imports between modules are resolved
+# at build time and recorded in the bundle, so they work the same at runtime.
+#
+# Code caches are valid only for the V8 version and flags which produced them. Build bundles with the naga build
+# (and the V8 flags) which will load them, otherwise they are served without code caches.
+
+import argparse
+import os
+import sys
+
+__all__ = ["build"]
+
+
+def _bundle_name(path, root):
+    return os.path.relpath(path, root).replace(os.sep, "/")
+
+
+def _read_sources(paths, root):
+    sources = {}
+    for path in paths:
+        with open(path, encoding="utf-8") as f:
+            sources[_bundle_name(path, root)] = f.read()
+    return sources
+
+
+def build(output, scripts=(), modules=(), root="."):
+    """Builds bundle `output` from script and module file paths, names are relative to `root`."""
+    from naga import JSBundle, JSContext
+
+    with JSContext():
+        JSBundle.build(output, scripts=_read_sources(scripts, root), modules=_read_sources(modules, root))
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(prog="python -m naga.bundle", description="Builds a naga bundle.")
+    parser.add_argument("-o", "--output", required=True, help="bundle file to write")
+    parser.add_argument("--root", default=".", help="directory bundle names are relative to")
+    parser.add_argument("--module", action="append", default=[], metavar="FILE",
+                        help="compile FILE as ES module regardless of its extension")
+    parser.add_argument("files", nargs="*", help="scripts, and modules ending with .mjs")
+    args = parser.parse_args(argv)
+
+    modules = args.module + [path for path in args.files if path.endswith(".mjs")]
+    scripts = [path for path in args.files if not path.endswith(".mjs")]
+    build(args.output, scripts=scripts, modules=modules, root=args.root)
+
+    from naga import JSBundle
+    stats = JSBundle(args.output).stats()
+    print("{}: {} scripts, {} modules, {} bytes".format(args.output, stats["scripts"], stats["modules"], stats["size"]))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -5,6 +5,9 @@ import os
 
 naga_auto_init = True
 
+# keyword arguments passed to JSPlatform.init(), e.g. {'worker_threads': 2, 'cpu_affinity': [0, 1]}
+naga_platform_options = {}
+
 naga_wait_for_debugger = False
 if os.environ.get('NAGA_WAIT_FOR_DEBUGGER') is not None:
     naga_wait_for_debugger = True
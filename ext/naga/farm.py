@@ -0,0 +1,352 @@
+# This module implements a farm of worker processes hosting naga isolates.
+#
+# Threads sharing one process are limited by the GIL on the Python side of every call. The farm side-steps that by
+# running JS in N worker processes. Each worker has its own isolate and a context prepared by the `bootstrap` script.
+#
+# Requests and responses are encoded with V8's ValueSerializer (toolkit.serialize/deserialize) and travel through
+# a pair of single-producer single-consumer ring buffers in shared memory per worker. Ring positions are updated with
+# seq_cst atomics (JSSharedBuffer), a cross-process semaphore per ring lets the consumer sleep while the ring is empty.
+#
+# The Python API is submit() returning concurrent.futures.Future:
+#   - backpressure: at most `max_pending` requests are in flight, submit() blocks beyond that (and when a ring is full)
+#   - recycling: a worker which served `max_requests_per_worker` requests gets replaced once its requests are done
+#   - crash isolation: when a worker dies, its in-flight requests fail with JSFarmWorkerCrashed and a fresh worker
+#     takes its place, other workers are not affected
+#
+# Results are converted to plain Python values (lists, dicts, bytes, primitives), see toolkit.deserialize.
+
+import itertools
+import multiprocessing
+import struct
+import threading
+import time
+from concurrent.futures import Future
+from multiprocessing import shared_memory
+
+__all__ = ["JSFarm",
+           "JSFarmError",
+           "JSFarmWorkerCrashed"]
+
+_HEADER = struct.Struct("<iiq")  # payload length, kind, request id
+_HEAD_SLOT = 0  # int32 slot written by the producer
+_TAIL_SLOT = 16  # int32 slot written by the consumer, on its own cache line
+_DATA_OFFSET = 128
+_WRAP = -1  # length of the marker telling the consumer to continue at the start of the ring
+
+_KIND_CALL = 1
+_KIND_RESULT = 2
+_KIND_ERROR = 3
+_KIND_STOP = 4
+
+_DISPATCH_JS = """(function(name, args) {
+  let self = globalThis, fn = globalThis;
+  for (const part of name.split('.')) {
+    self = fn;
+    fn = fn[part];
+  }
+  return fn.apply(self, args);
+})"""
+
+
+class JSFarmError(Exception):
+    """A request failed in the worker, the message carries the JS error."""
+
+
+class JSFarmWorkerCrashed(JSFarmError):
+    """The worker process died while the request was in flight."""
+
+
+class _Ring(object):
+    """Single-producer single-consumer ring of length-prefixed records in shared memory."""
+
+    def __init__(self, capacity, available, name=None):
+        from naga import JSSharedBuffer
+
+        self.capacity = capacity & ~7
+        # a record wrapping around an otherwise empty ring must fit in front of the tail, so larger records could
+        # wait for room forever
+        self.max_record_size = ((self.capacity - 8) // 2) & ~7
+        self.available = available
+        self.owner = name is None
+        if self.owner:
+            self.shm = shared_memory.SharedMemory(create=True, size=_DATA_OFFSET + self.capacity)
+        else:
+            self.shm = shared_memory.SharedMemory(name=name)
+            # the creator unlinks the memory, keep the resource tracker of this process from doing it (again)
+            from multiprocessing import resource_tracker
+            resource_tracker.unregister(self.shm._name, "shared_memory")
+        self.atomics = JSSharedBuffer(self.shm.buf)
+
+    @property
+    def name(self):
+        return self.shm.name
+
+    def try_write(self, kind, request_id, payload):
+        record_size = (_HEADER.size + len(payload) + 7) & ~7
+        if record_size > self.max_record_size:
+            raise ValueError("message of {} bytes does not fit into ring of {} bytes".format(len(payload),
+                                                                                          self.capacity))
+        head = self.atomics.load(_HEAD_SLOT)
+        tail = self.atomics.load(_TAIL_SLOT)
+        room_at_end = self.capacity - head
+        needed = record_size if record_size <= room_at_end else room_at_end + record_size
+        if needed > (tail - head - 8) % self.capacity:
+            return False
+
+        buf = self.shm.buf
+        if record_size > room_at_end:
+            # with less room than a header left, the wrap is implicit, see read()
+            if room_at_end >= _HEADER.size:
+                _HEADER.pack_into(buf, _DATA_OFFSET + head, _WRAP, 0, 0)
+            head = 0
+        offset = _DATA_OFFSET + head
+        _HEADER.pack_into(buf, offset, len(payload), kind, request_id)
+        buf[offset + _HEADER.size:offset + _HEADER.size + len(payload)] = payload
+        # the atomic store publishes the record written above
+        self.atomics.store(_HEAD_SLOT, (head + record_size) % self.capacity)
+        self.available.release()
+        return True
+
+    def write(self, kind, request_id, payload, is_alive=lambda: True):
+        while not self.try_write(kind, request_id, payload):
+            if not is_alive():
+                return False
+            time.sleep(0.0005)
+        return True
+
+    def read(self):
+        # call only after acquiring self.available
+        buf = self.shm.buf
+        tail = self.atomics.load(_TAIL_SLOT)
+        if self.capacity - tail < _HEADER.size:
+            tail = 0
+        length, kind, request_id = _HEADER.unpack_from(buf, _DATA_OFFSET + tail)
+        if length == _WRAP:
+            tail = 0
+            length, kind, request_id = _HEADER.unpack_from(buf, _DATA_OFFSET)
+        offset = _DATA_OFFSET + tail + _HEADER.size
+        payload = bytes(buf[offset:offset + length])
+        self.atomics.store(_TAIL_SLOT, (tail + ((_HEADER.size + length + 7) & ~7)) % self.capacity)
+        return kind, request_id, payload
+
+    def close(self):
+        # the buffer view held by JSSharedBuffer must go first, otherwise the memory cannot be unmapped
+        self.atomics = None
+        self.shm.close()
+        if self.owner:
+            self.shm.unlink()
+
+
+def _worker_main(requests_name, requests_available, responses_name, responses_available, capacity, bootstrap):
+    from naga import JSContext, JSError
+    import naga.toolkit as toolkit
+
+    requests = _Ring(capacity, requests_available, requests_name)
+    responses = _Ring(capacity, responses_available, responses_name)
+    with JSContext() as ctx:
+        if bootstrap:
+            ctx.eval(bootstrap)
+        dispatch = ctx.eval(_DISPATCH_JS)
+        while True:
+            requests.available.acquire()
+            kind, request_id, payload = requests.read()
+            if kind == _KIND_STOP:
+                break
+            try:
+                request = toolkit.deserialize(payload)
+                response = toolkit.serialize(dispatch(request[0], request[1]))
+                kind = _KIND_RESULT
+            except JSError as e:
+                response, kind = str(e).encode(), _KIND_ERROR
+            except Exception as e:
+                response, kind = "{}: {}".format(type(e).__name__, e).encode(), _KIND_ERROR
+            if kind == _KIND_RESULT and len(response) + _HEADER.size > responses.max_record_size:
+                response, kind = b"response does not fit into the ring buffer", _KIND_ERROR
+            responses.write(kind, request_id, response)
+    requests.close()
+    responses.close()
+
+
+class _Worker(object):
+    def __init__(self, farm):
+        mp = farm._mp
+        self.requests = _Ring(farm._ring_size, mp.Semaphore(0))
+        self.responses = _Ring(farm._ring_size, mp.Semaphore(0))
+        self.process = mp.Process(target=_worker_main,
+                                  args=(self.requests.name, self.requests.available,
+                                        self.responses.name, self.responses.available,
+                                        self.requests.capacity, farm._bootstrap),
+                                  daemon=True)
+        self.send_lock = threading.Lock()
+        self.in_flight = {}
+        self.served = 0
+        self.retiring = False
+        self.stopping = False
+        self.process.start()
+        self.collector = threading.Thread(target=farm._collect, args=(self,), daemon=True)
+        self.collector.start()
+
+    def is_alive(self):
+        return self.process.is_alive()
+
+    def send(self, kind, request_id, payload):
+        with self.send_lock:
+            return self.requests.write(kind, request_id, payload, self.is_alive)
+
+    def stop(self):
+        self.stopping = True
+        self.send(_KIND_STOP, 0, b"")
+
+
+class JSFarm(object):
+    """Runs JS function calls in a pool of worker processes.
+
+    `bootstrap` is JS source evaluated once in every worker, typically defining the functions to be called.
+    submit(name, *args) calls global function `name` (dotted paths like "api.render" work too) with plain Python
+    values (None, bool, numbers, str, bytes, lists, tuples and dicts) and returns a Future of the plain result.
+    Encoded requests and results must fit into half of `ring_size`.
+    """
+
+    def __init__(self, workers=None, bootstrap="", ring_size=1 << 20, max_pending=256, max_requests_per_worker=0,
+                 start_method="spawn"):
+        from naga import JSIsolate, JSContext
+
+        self._mp = multiprocessing.get_context(start_method)
+        self._bootstrap = bootstrap
+        self._ring_size = ring_size
+        self._max_requests_per_worker = max_requests_per_worker
+        self._pending = threading.BoundedSemaphore(max_pending)
+        self._lock = threading.Lock()
+        self._request_ids = itertools.count(1)
+        self._closed = False
+        self._num_crashes = 0
+        self._num_recycled = 0
+
+        # requests are encoded and results decoded in a private isolate, any thread may do it under its lock
+        self._codec_isolate = JSIsolate()
+        with self._codec_isolate:
+            self._codec_context = JSContext()
+
+        self._workers = [_Worker(self) for _ in range(workers or multiprocessing.cpu_count())]
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, exc_type, exc_value, traceback):
+        self.close()
+
+    def _encode(self, value):
+        import naga.toolkit as toolkit
+        with self._codec_isolate:
+            with self._codec_context:
+                return toolkit.serialize(value)
+
+    def _decode(self, payload):
+        import naga.toolkit as toolkit
+        with self._codec_isolate:
+            with self._codec_context:
+                return toolkit.deserialize(payload, plain=True)
+
+    def _pick_worker(self):
+        # expects self._lock to be held
+        candidates = [w for w in self._workers if not w.retiring and not w.stopping]
+        return min(candidates, key=lambda w: len(w.in_flight))
+
+    def _replace(self, worker):
+        # expects self._lock to be held
+        if self._closed:
+            return
+        self._workers[self._workers.index(worker)] = _Worker(self)
+
+    def submit(self, name, *args):
+        if self._closed:
+            raise RuntimeError("cannot submit to a closed farm")
+        payload = self._encode([name, list(args)])
+        self._pending.acquire()
+        future = Future()
+        with self._lock:
+            worker = self._pick_worker()
+            request_id = next(self._request_ids)
+            worker.in_flight[request_id] = future
+            worker.served += 1
+            if self._max_requests_per_worker and worker.served >= self._max_requests_per_worker:
+                # no more requests for this one, it stops once the in-flight ones are done
+                worker.retiring = True
+                self._num_recycled += 1
+                self._replace(worker)
+        try:
+            if not worker.send(_KIND_CALL, request_id, payload):
+                self._fail(worker, request_id, JSFarmWorkerCrashed("worker process died"))
+        except Exception as e:
+            self._fail(worker, request_id, e)
+        return future
+
+    def _fail(self, worker, request_id, error):
+        with self._lock:
+            future = worker.in_flight.pop(request_id, None)
+        if future is not None:
+            self._pending.release()
+            future.set_exception(error)
+
+    def _collect(self, worker):
+        while True:
+            if worker.responses.available.acquire(timeout=0.1):
+                kind, request_id, payload = worker.responses.read()
+                with self._lock:
+                    future = worker.in_flight.pop(request_id, None)
+                    retired = worker.retiring and not worker.in_flight and not worker.stopping
+                if future is not None:
+                    self._pending.release()
+                    try:
+                        if kind == _KIND_RESULT:
+                            future.set_result(self._decode(payload))
+                        else:
+                            future.set_exception(JSFarmError(payload.decode(errors="replace")))
+                    except Exception as e:
+                        future.set_exception(e)
+                if retired:
+                    worker.stop()
+                continue
+
+            if worker.is_alive():
+                continue
+            # the process is gone, either after we stopped it or because it crashed
+            with self._lock:
+                in_flight, worker.in_flight = worker.in_flight, {}
+                crashed = not worker.stopping
+                if crashed:
+                    self._num_crashes += 1
+                    if worker in self._workers:
+                        self._replace(worker)
+            for future in in_flight.values():
+                self._pending.release()
+                future.set_exception(JSFarmWorkerCrashed("worker process exited with code {}".format(
+                    worker.process.exitcode)))
+            worker.process.join()
+            worker.requests.close()
+            worker.responses.close()
+            return
+
+    def stats(self):
+        with self._lock:
+            return {
+                "workers": [{"pid": w.process.pid,
+                             "in_flight": len(w.in_flight),
+                             "served": w.served,
+                             "retiring": w.retiring} for w in self._workers],
+                "crashes": self._num_crashes,
+                "recycled": self._num_recycled,
+            }
+
+    def close(self):
+        with self._lock:
+            if self._closed:
+                return
+            self._closed = True
+            workers = list(self._workers)
+        for worker in workers:
+            # requests are processed in order, so the stop request comes after everything submitted before
+            if worker.is_alive() and not worker.stopping:
+                worker.stop()
+        for worker in workers:
+            worker.collector.join()
@@ -10,15 +10,19 @@ import naga.debug_support
 # noinspection PyUnresolvedReferences
 import naga_native
 
-__all__ = ["JSClass",
+__all__ = ["JSBundle",
+           "JSClass",
            "JSContext",
            "JSEngine",
            "JSError",
            "JSIsolate",
+           "JSModule",
            "JSNull",
            "JSObject",
            "JSPlatform",
            "JSScript",
+           "JSScriptFuture",
+           "JSSharedBuffer",
            "JSStackTrace",
            "JSStackFrame",
            "JSUndefined"]
@@ -189,9 +193,13 @@ naga_native.JSError = JSError
 
 JSNull = naga_native.JSNull
 JSUndefined = naga_native.JSUndefined
+JSBundle = naga_native.JSBundle
+JSModule = naga_native.JSModule
 JSObject = naga_native.JSObject
 JSPlatform = naga_native.JSPlatform
 JSScript = naga_native.JSScript
+JSScriptFuture = naga_native.JSScriptFuture
+JSSharedBuffer = naga_native.JSSharedBuffer
 JSStackFrame = naga_native.JSStackFrame
 
 # -- init code --------------------------------------------------------------------------------------------------------
@@ -203,7 +211,7 @@ default_isolate: JSIsolate
 def init_default_platform():
     global default_platform
     default_platform = JSPlatform.instance
-    default_platform.init()
+    default_platform.init(**naga.config.naga_platform_options)
 
 
 def deinit_default_isolate():
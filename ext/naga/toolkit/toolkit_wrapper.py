@@ -3,5 +3,155 @@
 # It is imported in __init__ of the `naga.toolkit` package.
 
 
+import glob
+import os
+
 # noinspection PyUnresolvedReferences
 from naga_native.toolkit import *
+
+
+def format_prometheus(stats, prefix="naga", labels=None):
+    """Renders `JSIsolate.stats()` in Prometheus text exposition format.
+
+    `labels` is an optional dict of extra labels attached to every sample, e.g. {'isolate': 'worker-1'}.
+    """
+    lines = []
+    base_labels = dict(labels or {})
+
+    def fmt_labels(extra=None):
+        all_labels = dict(base_labels, **(extra or {}))
+        if not all_labels:
+            return ""
+        pairs = ('{}="{}"'.format(k, str(v).replace('\\', '\\\\').replace('"', '\\"')) for k, v in all_labels.items())
+        return "{" + ",".join(pairs) + "}"
+
+    def metric(name, kind, help_text, samples):
+        full_name = "{}_{}".format(prefix, name)
+        lines.append("# HELP {} {}".format(full_name, help_text))
+        lines.append("# TYPE {} {}".format(full_name, kind))
+        for suffix, extra, value in samples:
+            lines.append("{}{}{} {}".format(full_name, suffix, fmt_labels(extra), value))
+
+    for key, value in stats["heap"].items():
+        metric("heap_" + key, "gauge", "V8 heap statistics: " + key, [("", None, value)])
+
+    for field in ("space_size", "space_used_size", "space_available_size", "physical_space_size"):
+        samples = [("", {"space": space}, values[field]) for space, values in stats["heap_spaces"].items()]
+        metric("heap_" + field, "gauge", "V8 heap space statistics: " + field, samples)
+
+    samples = []
+    for kind, record in stats["gc"].items():
+        cumulative = 0
+        for le, count in record["pause_histogram"].items():
+            cumulative += count
+            samples.append(("_bucket", {"kind": kind, "le": le}, cumulative))
+        samples.append(("_sum", {"kind": kind}, record["total_pause"]))
+        samples.append(("_count", {"kind": kind}, record["count"]))
+    metric("gc_pause_seconds", "histogram", "GC pause times in seconds", samples)
+
+    for name in ("compile", "execute"):
+        metric(name + "_seconds_total", "counter", "Cumulative script {} time".format(name),
+               [("", None, stats[name]["time"])])
+        metric(name + "_total", "counter", "Number of script {}s".format(name), [("", None, stats[name]["count"])])
+
+    samples = [("", {"direction": direction}, count) for direction, count in stats["conversions"].items()]
+    metric("conversions_total", "counter", "Number of values converted between JS and Python", samples)
+
+    return "\n".join(lines) + "\n"
+
+
+def compile_directory(engine, path, pattern="*.js"):
+    """Compiles scripts matching `pattern` under directory `path` in parallel on V8 worker threads.
+
+    Must be called in a context of the engine's isolate. Returns a dict of JSScripts keyed by paths relative to `path`.
+    Errors are raised after all compilations have finished.
+    """
+    futures = {}
+    for file_path in sorted(glob.glob(os.path.join(path, "**", pattern), recursive=True)):
+        with open(file_path, encoding="utf-8") as f:
+            futures[os.path.relpath(file_path, path)] = engine.compile_async(f.read(), file_path)
+    for future in futures.values():
+        future.wait()
+    return {name: future.result() for name, future in futures.items()}
+
+
+def _heap_snapshot_categories(path):
+    """Aggregates a .heapsnapshot file into {category: [count, size]}.
+
+    Objects are categorized by constructor name like in the DevTools summary view, other nodes by their type,
+    e.g. "(string)" or "(compiled code)". Additionally, objects directly held by Naga (edges labeled "Naga ..." or
+    "naga.Tracer") are counted under "[<label>]" categories.
+    """
+    import json
+
+    with open(path, "r") as f:
+        snapshot = json.load(f)
+
+    meta = snapshot["snapshot"]["meta"]
+    node_fields = meta["node_fields"]
+    edge_fields = meta["edge_fields"]
+    node_types = meta["node_types"][0]
+    edge_types = meta["edge_types"][0]
+    strings = snapshot["strings"]
+    nodes = snapshot["nodes"]
+    edges = snapshot["edges"]
+
+    node_size = len(node_fields)
+    edge_size = len(edge_fields)
+    n_type = node_fields.index("type")
+    n_name = node_fields.index("name")
+    n_self_size = node_fields.index("self_size")
+    n_edge_count = node_fields.index("edge_count")
+    e_type = edge_fields.index("type")
+    e_name = edge_fields.index("name_or_index")
+    e_to = edge_fields.index("to_node")
+    named_types = {"object", "native", "synthetic", "closure", "regexp"}
+    indexed_edge_types = {"element", "hidden"}
+
+    categories = {}
+
+    def add(category, size):
+        record = categories.setdefault(category, [0, 0])
+        record[0] += 1
+        record[1] += size
+
+    edge_index = 0
+    for i in range(0, len(nodes), node_size):
+        node_type = node_types[nodes[i + n_type]]
+        if node_type in named_types:
+            add(strings[nodes[i + n_name]], nodes[i + n_self_size])
+        else:
+            add("({})".format(node_type), nodes[i + n_self_size])
+
+        for j in range(edge_index, edge_index + nodes[i + n_edge_count] * edge_size, edge_size):
+            if edge_types[edges[j + e_type]] in indexed_edge_types:
+                continue
+            label = strings[edges[j + e_name]]
+            if label.startswith("Naga ") or label.startswith("naga."):
+                to_node = edges[j + e_to]
+                add("[{}]".format(label), nodes[to_node + n_self_size])
+        edge_index += nodes[i + n_edge_count] * edge_size
+
+    return categories
+
+
+def diff_heap_snapshots(before_path, after_path, top=20):
+    """Compares two snapshots written by `JSIsolate.write_heap_snapshot` and reports categories which grew.
+
+    Returns a list of dicts with keys category, count_delta, size_delta, count and size (the latter two taken from
+    the second snapshot), sorted by size_delta, at most `top` entries. Sizes are shallow sizes in bytes.
+    """
+    before = _heap_snapshot_categories(before_path)
+    after = _heap_snapshot_categories(after_path)
+
+    report = []
+    for category, (count, size) in after.items():
+        before_count, before_size = before.get(category, (0, 0))
+        if count > before_count or size > before_size:
+            report.append({"category": category,
+                           "count_delta": count - before_count,
+                           "size_delta": size - before_size,
+                           "count": count,
+                           "size": size})
+    report.sort(key=lambda r: (r["size_delta"], r["count_delta"]), reverse=True)
+    return report[:top] if top else report
@@ -54,6 +54,7 @@ NAGA_CLANG_TIDY_EXTRA_ARGS=${NAGA_CLANG_TIDY_EXTRA_ARGS}
 NAGA_CPYTHON_REPO_DIR=${NAGA_CPYTHON_REPO_DIR:-"$NAGA_WORK_DIR/cpython"}
 
 NAGA_ACTIVE_LOG_LEVEL=${NAGA_ACTIVE_LOG_LEVEL}
+NAGA_ENABLE_TRACING=${NAGA_ENABLE_TRACING}
 
 NAGA_DOCKER_BUILDER_IMAGE_NAME=${NAGA_DOCKER_BUILDER_IMAGE_NAME:-naga-builder-image}
 NAGA_DOCKER_BUILDER_CACHE_VOLUME_NAME=${NAGA_DOCKER_BUILDER_CACHE_VOLUME_NAME:-naga-builder-cache}
@@ -0,0 +1,23 @@
+#!/usr/bin/env bash
+
+set -e -o pipefail
+# shellcheck source=_config.sh
+source "$(dirname "${BASH_SOURCE[0]}")/_config.sh"
+
+cd "$ROOT_DIR"
+
+./scripts/prepare-venv.sh
+
+cd benchmarks
+activate_python3
+
+BENCH_SCRIPT=bench_binding.py
+if [[ "$1" == "--scaling" ]]; then
+  BENCH_SCRIPT=bench_scaling.py
+  shift
+elif [[ "$1" == "--soak" ]]; then
+  BENCH_SCRIPT=soak.py
+  shift
+fi
+
+echo_cmd python3 "$BENCH_SCRIPT" "$@"
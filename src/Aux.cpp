@@ -1,6 +1,8 @@
 #include "Aux.h"
 #include "JSIsolate.h"
 #include "JSContext.h"
+#include "JSTracer.h"
+#include "JSHospital.h"
 #include "Logging.h"
 #include "V8XUtils.h"
 
@@ -60,4 +62,85 @@ SharedJSContextPtr testEncounteringForeignContext() {
   auto v8_scope = v8x::withScope(v8_isolate);
   auto foreign_v8_context = v8::Context::New(v8_isolate);
   return JSContext::FromV8(foreign_v8_context);
-}
\ No newline at end of file
+}
+
+// these introspection functions are meant for leak accounting (see benchmarks/soak.py), they report on current isolate
+
+py::dict tracerStats() {
+  TRACE("tracerStats");
+  auto v8_isolate = v8x::getCurrentIsolate();
+  auto& tracer = JSIsolate::FromV8(v8_isolate)->Tracer();
+  py::dict py_result;
+  py_result["live"] = tracer.NumberOfLiveRecords();
+  py_result["zombie"] = tracer.NumberOfZombieRecords();
+  return py_result;
+}
+
+py::dict hospitalStats() {
+  TRACE("hospitalStats");
+  auto v8_isolate = v8x::getCurrentIsolate();
+  py::dict py_result;
+  py_result["patients"] = JSIsolate::FromV8(v8_isolate)->Hospital().NumberOfPatients();
+  return py_result;
+}
+
+py::dict handleStats() {
+  TRACE("handleStats");
+  auto v8_isolate = v8x::getCurrentIsolate();
+  static const char* g_class_names[] = {"untagged",     "js_object",    "js_context",     "js_script",
+                                        "js_module",    "js_exception", "tracer_wrapper", "hospital_patient",
+                                        "message_port"};
+  static_assert(std::size(g_class_names) == v8x::kNumGlobalHandleClasses);
+
+  auto counts = v8x::countGlobalHandles(v8_isolate);
+  py::dict py_globals;
+  size_t total = 0;
+  for (size_t i = 1; i < v8x::kNumGlobalHandleClasses; i++) {
+    py_globals[g_class_names[i]] = counts[i];
+    total += counts[i];
+  }
+
+  py::dict py_result;
+  py_result["global"] = py_globals;
+  py_result["global_total"] = total;
+  py_result["local"] = v8::HandleScope::NumberOfHandles(v8_isolate);
+  py_result["handle_scope_level"] = getCurrentHandleScopeLevel(v8_isolate);
+  py_result["total_handle_scope_level"] = getTotalHandleScopeLevel();
+  return py_result;
+}
+
+#define NAGA_STRINGIFY(x) NAGA_STRINGIFY_IMPL(x)
+#define NAGA_STRINGIFY_IMPL(x) #x
+
+// this is recorded with benchmark results, so we can tell apart numbers measured with different builds
+py::dict buildInfo() {
+  TRACE("buildInfo");
+  py::dict py_result;
+#if defined(NAGA_BUILD_DEBUG)
+  py_result["debug"] = true;
+#else
+  py_result["debug"] = false;
+#endif
+#if defined(NAGA_BUILD_PRECOMPILED_HEADERS)
+  py_result["precompiled_headers"] = true;
+#else
+  py_result["precompiled_headers"] = false;
+#endif
+#if defined(NAGA_ACTIVE_LOG_LEVEL)
+  py_result["log_level"] = NAGA_STRINGIFY(NAGA_ACTIVE_LOG_LEVEL);
+#else
+  py_result["log_level"] = "TRACE";
+#endif
+#if defined(NAGA_ENABLE_TRACING)
+  py_result["tracing"] = true;
+#else
+  py_result["tracing"] = false;
+#endif
+#if defined(NAGA_FEATURE_CLJS)
+  py_result["cljs"] = true;
+#else
+  py_result["cljs"] = false;
+#endif
+  py_result["v8_version"] = v8::V8::GetVersion();
+  return py_result;
+}
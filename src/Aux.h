@@ -13,5 +13,9 @@ void trace(const py::str& s);
 void v8RequestGarbageCollectionForTesting();
 SharedJSIsolatePtr testEncounteringForeignIsolate();
 SharedJSContextPtr testEncounteringForeignContext();
+py::dict buildInfo();
+py::dict tracerStats();
+py::dict hospitalStats();
+py::dict handleStats();
 
 #endif
\ No newline at end of file
@@ -0,0 +1,170 @@
+#include "JSBoundaryProfiler.h"
+#include "Logging.h"
+#include "Printing.h"
+
+#include <algorithm>
+
+#define TRACE(...) \
+  LOGGER_INDENT;   \
+  SPDLOG_LOGGER_TRACE(getLogger(kJSProfilerLogger), __VA_ARGS__)
+
+static const char* kindName(size_t kind) {
+  static const char* g_names[] = {"js_to_py.null",
+                                  "js_to_py.undefined",
+                                  "js_to_py.bool",
+                                  "js_to_py.int",
+                                  "js_to_py.float",
+                                  "js_to_py.str",
+                                  "js_to_py.date",
+                                  "js_to_py.traced_object",
+                                  "js_to_py.js_object",
+                                  "py_to_js.null",
+                                  "py_to_js.undefined",
+                                  "py_to_js.bool",
+                                  "py_to_js.int",
+                                  "py_to_js.float",
+                                  "py_to_js.str",
+                                  "py_to_js.date",
+                                  "py_to_js.js_object",
+                                  "py_to_js.traced_wrapper_hit",
+                                  "py_to_js.traced_wrapper_miss",
+                                  "callback.NamedGetter",
+                                  "callback.NamedSetter",
+                                  "callback.NamedQuery",
+                                  "callback.NamedDeleter",
+                                  "callback.NamedEnumerator",
+                                  "callback.IndexedGetter",
+                                  "callback.IndexedSetter",
+                                  "callback.IndexedQuery",
+                                  "callback.IndexedDeleter",
+                                  "callback.IndexedEnumerator",
+                                  "callback.CallPythonCallable"};
+  static_assert(std::size(g_names) == JSBoundaryProfiler::kNumKinds);
+  return g_names[kind];
+}
+
+static constexpr int kPathBitsPerLevel = 6;
+static_assert(JSBoundaryProfiler::kNumKinds < (1 << kPathBitsPerLevel));
+static_assert(JSBoundaryProfiler::kMaxDepth * kPathBitsPerLevel <= 64);
+
+JSBoundaryProfiler::JSBoundaryProfiler(v8x::ProtectedIsolatePtr v8_protected_isolate)
+    : m_v8_isolate(v8_protected_isolate) {
+  TRACE("JSBoundaryProfiler::JSBoundaryProfiler {} v8_isolate={}", THIS, m_v8_isolate);
+  m_v8_isolate.giveMeRawIsolateAndTrustMe()->SetData(kIsolateDataSlot, this);
+}
+
+JSBoundaryProfiler::~JSBoundaryProfiler() {
+  TRACE("JSBoundaryProfiler::~JSBoundaryProfiler {}", THIS);
+  m_v8_isolate.giveMeRawIsolateAndTrustMe()->SetData(kIsolateDataSlot, nullptr);
+}
+
+void JSBoundaryProfiler::Enable(uint32_t sample_every) {
+  TRACE("JSBoundaryProfiler::Enable {} sample_every={}", THIS, sample_every);
+  // previous results are dropped, each enable starts a fresh profile
+  m_records = {};
+  m_paths.clear();
+  m_sample_every = std::max(sample_every, 1u);
+  m_countdown = m_sample_every;
+  m_enabled = true;
+}
+
+void JSBoundaryProfiler::Disable() {
+  TRACE("JSBoundaryProfiler::Disable {}", THIS);
+  m_enabled = false;
+}
+
+JSBoundaryProfiler::PathKey JSBoundaryProfiler::CurrentPath(size_t depth) const {
+  PathKey key = 0;
+  for (size_t i = 0; i <= std::min(depth, kMaxDepth - 1); i++) {
+    key = (key << kPathBitsPerLevel) | (m_stack[i] + 1);
+  }
+  return key;
+}
+
+void JSBoundaryProfiler::Leave(size_t depth, Kind kind) {
+  m_records[kind].m_count++;
+  m_depth = depth;
+}
+
+void JSBoundaryProfiler::LeaveSampled(size_t depth, Kind kind, Clock::duration duration) {
+  auto& record = m_records[kind];
+  record.m_count++;
+  record.m_sampled++;
+  record.m_sampled_time += duration;
+  auto us = std::chrono::duration<double, std::micro>(duration).count();
+  auto bucket = std::upper_bound(std::begin(kLatencyBucketsUs), std::end(kLatencyBucketsUs), us);
+  record.m_histogram[bucket - std::begin(kLatencyBucketsUs)]++;
+
+  auto& path_record = m_paths[CurrentPath(depth)];
+  path_record.m_sampled++;
+  path_record.m_sampled_time += duration;
+  m_depth = depth;
+}
+
+py::dict JSBoundaryProfiler::GetProfile() const {
+  TRACE("JSBoundaryProfiler::GetProfile {}", THIS);
+  py::dict py_kinds;
+  for (size_t kind = 0; kind < kNumKinds; kind++) {
+    auto& record = m_records[kind];
+    if (!record.m_count) {
+      continue;
+    }
+    py::dict py_histogram;
+    for (size_t i = 0; i < kNumLatencyBuckets; i++) {
+      auto py_le = i < std::size(kLatencyBucketsUs) ? py::object(py::float_(kLatencyBucketsUs[i] / 1e6))
+                                                    : py::object(py::str("+Inf"));
+      py_histogram[py_le] = record.m_histogram[i];
+    }
+    auto sampled_time = std::chrono::duration<double>(record.m_sampled_time).count();
+    py::dict py_kind;
+    py_kind["count"] = record.m_count;
+    py_kind["sampled"] = record.m_sampled;
+    py_kind["sampled_time"] = sampled_time;
+    py_kind["mean_time"] = record.m_sampled ? sampled_time / record.m_sampled : 0.0;
+    // extrapolated from samples
+    py_kind["estimated_time"] = record.m_sampled ? sampled_time / record.m_sampled * record.m_count : 0.0;
+    py_kind["latency_histogram"] = py_histogram;
+    py_kinds[kindName(kind)] = py_kind;
+  }
+
+  py::dict py_result;
+  py_result["enabled"] = m_enabled;
+  py_result["sample_every"] = m_sample_every;
+  py_result["kinds"] = py_kinds;
+  return py_result;
+}
+
+std::string JSBoundaryProfiler::GetFoldedProfile() const {
+  TRACE("JSBoundaryProfiler::GetFoldedProfile {}", THIS);
+  // one "outer;inner estimated_microseconds" line per path, weights are extrapolated by the sampling rate
+  // flamegraph tools expect self weights, so we subtract sampled times of direct children
+  std::unordered_map<PathKey, double> self_us;
+  for (auto& [key, record] : m_paths) {
+    self_us[key] += std::chrono::duration<double, std::micro>(record.m_sampled_time).count();
+    auto parent = key >> kPathBitsPerLevel;
+    if (parent) {
+      self_us[parent] -= std::chrono::duration<double, std::micro>(record.m_sampled_time).count();
+    }
+  }
+
+  std::vector<std::string> lines;
+  for (auto& [key, us] : self_us) {
+    if (!m_paths.count(key)) {
+      continue;
+    }
+    std::string stack;
+    for (auto rest = key; rest; rest >>= kPathBitsPerLevel) {
+      auto frame = std::string(kindName((rest & ((1 << kPathBitsPerLevel) - 1)) - 1));
+      stack = stack.empty() ? frame : frame + ";" + stack;
+    }
+    auto weight = std::max(us, 0.0) * m_sample_every;
+    lines.push_back(fmt::format("{} {}", stack, static_cast<uint64_t>(weight + 0.5)));
+  }
+  std::sort(lines.begin(), lines.end());
+
+  std::string result;
+  for (auto& line : lines) {
+    result += line + "\n";
+  }
+  return result;
+}
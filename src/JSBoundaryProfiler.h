@@ -0,0 +1,172 @@
+#ifndef NAGA_JSBOUNDARYPROFILER_H_
+#define NAGA_JSBOUNDARYPROFILER_H_
+
+#include "Base.h"
+
+#include <array>
+#include <chrono>
+#include <unordered_map>
+
+// JSBoundaryProfiler measures time spent crossing the JS/Python boundary, see JSIsolate::EnableBoundaryProfiler.
+//
+// Each crossing is marked by a JSBoundaryScope placed in wrap() (per conversion kind) and in PythonObject callbacks
+// (per callback kind). When the profiler is disabled a scope costs one load and one branch. When enabled, every
+// crossing is counted but only every n-th crossing is timed, so the clock is read rarely enough to keep the overhead
+// in low single percents even for conversion-heavy code.
+//
+// Scopes nest (e.g. argument conversions inside CallPythonCallable), so we keep a small stack of active kinds and
+// attribute sampled times to the whole path. That gives us folded stacks suitable for flamegraph tools. Note that
+// timings are inclusive, a callback's time includes the Python code it ran and the conversions it did.
+//
+// All state is touched only by the thread holding the isolate lock. Hot paths get to the profiler via isolate data
+// slot (see FromV8), same as JSIsolateStats.
+
+class JSBoundaryProfiler {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  enum Kind : uint8_t {
+    kJSToPyNull = 0,
+    kJSToPyUndefined,
+    kJSToPyBool,
+    kJSToPyInt,
+    kJSToPyFloat,
+    kJSToPyStr,
+    kJSToPyDate,
+    kJSToPyTracedObject,
+    kJSToPyJSObject,
+    kPyToJSNull,
+    kPyToJSUndefined,
+    kPyToJSBool,
+    kPyToJSInt,
+    kPyToJSFloat,
+    kPyToJSStr,
+    kPyToJSDate,
+    kPyToJSJSObject,
+    kPyToJSTracedWrapperHit,
+    kPyToJSTracedWrapperMiss,
+    kNamedGetter,
+    kNamedSetter,
+    kNamedQuery,
+    kNamedDeleter,
+    kNamedEnumerator,
+    kIndexedGetter,
+    kIndexedSetter,
+    kIndexedQuery,
+    kIndexedDeleter,
+    kIndexedEnumerator,
+    kCallPythonCallable,
+    kNumKinds
+  };
+  // upper bounds of latency histogram buckets in microseconds, the last bucket is unbounded
+  static constexpr double kLatencyBucketsUs[] = {0.5, 1, 2, 5, 10, 20, 50, 100, 500, 1000};
+  static constexpr size_t kNumLatencyBuckets = std::size(kLatencyBucketsUs) + 1;
+  static constexpr size_t kMaxDepth = 8;
+  static constexpr uint32_t kIsolateDataSlot = 1;
+
+  struct KindRecord {
+    uint64_t m_count{0};
+    uint64_t m_sampled{0};
+    Clock::duration m_sampled_time{};
+    std::array<uint64_t, kNumLatencyBuckets> m_histogram{};
+  };
+
+  struct PathRecord {
+    uint64_t m_sampled{0};
+    Clock::duration m_sampled_time{};
+  };
+
+ private:
+  // a path of active kinds is encoded into 64 bits, 6 bits per level (kind + 1, zero means no level)
+  using PathKey = uint64_t;
+
+  v8x::ProtectedIsolatePtr m_v8_isolate;
+  bool m_enabled{false};
+  uint32_t m_sample_every{1};
+  uint32_t m_countdown{0};
+  std::array<KindRecord, kNumKinds> m_records;
+  std::array<Kind, kMaxDepth> m_stack{};
+  size_t m_depth{0};
+  std::unordered_map<PathKey, PathRecord> m_paths;
+
+  PathKey CurrentPath(size_t depth) const;
+
+ public:
+  explicit JSBoundaryProfiler(v8x::ProtectedIsolatePtr v8_protected_isolate);
+  ~JSBoundaryProfiler();
+
+  static JSBoundaryProfiler* FromV8(v8::Isolate* v8_isolate) {
+    return static_cast<JSBoundaryProfiler*>(v8_isolate->GetData(kIsolateDataSlot));
+  }
+
+  bool Enabled() const { return m_enabled; }
+  void Enable(uint32_t sample_every);
+  void Disable();
+
+  // returns depth of the entered scope, sampled is set when the caller should time it
+  size_t Enter(Kind kind, bool& sampled) {
+    m_countdown--;
+    sampled = m_countdown == 0;
+    if (sampled) {
+      m_countdown = m_sample_every;
+    }
+    auto depth = m_depth;
+    if (depth < kMaxDepth) {
+      m_stack[depth] = kind;
+    }
+    m_depth = depth + 1;
+    return depth;
+  }
+  void Reclassify(size_t depth, Kind kind) {
+    if (depth < kMaxDepth) {
+      m_stack[depth] = kind;
+    }
+  }
+  void Leave(size_t depth, Kind kind);
+  void LeaveSampled(size_t depth, Kind kind, Clock::duration duration);
+
+  py::dict GetProfile() const;
+  std::string GetFoldedProfile() const;
+};
+
+class JSBoundaryScope {
+  JSBoundaryProfiler* m_profiler;
+  JSBoundaryProfiler::Kind m_kind;
+  size_t m_depth{0};
+  bool m_sampled{false};
+  JSBoundaryProfiler::Clock::time_point m_start;
+
+ public:
+  JSBoundaryScope(v8::Isolate* v8_isolate, JSBoundaryProfiler::Kind kind) : m_profiler(nullptr), m_kind(kind) {
+    auto profiler = JSBoundaryProfiler::FromV8(v8_isolate);
+    if (profiler && profiler->Enabled()) {
+      m_profiler = profiler;
+      m_depth = profiler->Enter(kind, m_sampled);
+      if (m_sampled) {
+        m_start = JSBoundaryProfiler::Clock::now();
+      }
+    }
+  }
+  ~JSBoundaryScope() {
+    if (!m_profiler) {
+      return;
+    }
+    if (m_sampled) {
+      m_profiler->LeaveSampled(m_depth, m_kind, JSBoundaryProfiler::Clock::now() - m_start);
+    } else {
+      m_profiler->Leave(m_depth, m_kind);
+    }
+  }
+  JSBoundaryScope(const JSBoundaryScope&) = delete;
+  JSBoundaryScope& operator=(const JSBoundaryScope&) = delete;
+
+  // conversions learn their kind only after inspecting the value
+  void SetKind(JSBoundaryProfiler::Kind kind) {
+    m_kind = kind;
+    if (m_profiler) {
+      m_profiler->Reclassify(m_depth, kind);
+    }
+  }
+};
+
+#endif
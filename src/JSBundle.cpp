@@ -0,0 +1,433 @@
+#include "JSBundle.h"
+#include "JSIsolate.h"
+#include "JSModuleMap.h"
+#include "JSException.h"
+#include "Logging.h"
+#include "Printing.h"
+#include "V8XUtils.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <vector>
+
+#define TRACE(...) \
+  LOGGER_INDENT;   \
+  SPDLOG_LOGGER_TRACE(getLogger(kJSBundleLogger), __VA_ARGS__)
+
+const char kBundleMagic[8] = {'N', 'A', 'G', 'A', 'B', 'N', 'D', 'L'};
+const uint32_t kBundleFormat = 1;
+
+enum BundleEntryFlags : uint32_t {
+  kModuleEntry = 1 << 0,
+  kTwoByteSource = 1 << 1,
+};
+
+struct BundleSpan {
+  uint64_t m_offset;
+  uint64_t m_length;
+};
+
+struct BundleHeader {
+  char m_magic[8];
+  uint32_t m_format;
+  uint32_t m_num_entries;
+  BundleSpan m_v8_version;
+  BundleSpan m_index;
+};
+
+struct BundleEntry {
+  BundleSpan m_name;
+  BundleSpan m_source;
+  BundleSpan m_code_cache;
+  BundleSpan m_requests;
+  uint32_t m_flags;
+  uint32_t m_reserved;
+};
+
+struct BundleRequest {
+  BundleSpan m_specifier;
+  BundleSpan m_name;
+};
+
+class BundleWriter {
+  std::string m_data;
+
+ public:
+  BundleWriter() : m_data(sizeof(BundleHeader), '\0') {}
+
+  BundleSpan Append(std::string_view bytes) {
+    m_data.resize((m_data.size() + 7) & ~size_t(7), '\0');
+    auto span = BundleSpan{m_data.size(), bytes.size()};
+    m_data.append(bytes);
+    return span;
+  }
+
+  template <typename T>
+  BundleSpan AppendRecords(const std::vector<T>& records) {
+    return Append(std::string_view(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(T)));
+  }
+
+  void WriteHeader(const BundleHeader& header) { std::memcpy(m_data.data(), &header, sizeof(header)); }
+
+  const std::string& Data() const { return m_data; }
+};
+
+class BundleOneByteSource : public v8::String::ExternalOneByteStringResource {
+  std::shared_ptr<const void> m_file;
+  std::string_view m_source;
+
+ public:
+  BundleOneByteSource(std::shared_ptr<const void> file, std::string_view source)
+      : m_file(std::move(file)),
+        m_source(source) {}
+
+  const char* data() const override { return m_source.data(); }
+  size_t length() const override { return m_source.size(); }
+};
+
+class BundleTwoByteSource : public v8::String::ExternalStringResource {
+  std::shared_ptr<const void> m_file;
+  std::string_view m_source;
+
+ public:
+  BundleTwoByteSource(std::shared_ptr<const void> file, std::string_view source)
+      : m_file(std::move(file)),
+        m_source(source) {}
+
+  const uint16_t* data() const override { return reinterpret_cast<const uint16_t*>(m_source.data()); }
+  size_t length() const override { return m_source.size() / sizeof(uint16_t); }
+};
+
+class BundleModuleResolver : public JSModuleResolver {
+  SharedJSBundlePtr m_bundle;
+
+ public:
+  explicit BundleModuleResolver(SharedJSBundlePtr bundle) : m_bundle(std::move(bundle)) {}
+
+  std::string Resolve(const std::string& specifier, const std::string& referrer) const override {
+    // prefer the resolution recorded when the bundle was built
+    if (auto entry = m_bundle->Find(referrer)) {
+      auto it = entry->m_requests.find(specifier);
+      if (it != entry->m_requests.end()) {
+        return it->second;
+      }
+    }
+    return JSModuleResolver::Resolve(specifier, referrer);
+  }
+
+  std::string Load(const std::string& name) const override {
+    throw JSException(fmt::format("Module '{}' is not in bundle '{}'", name, m_bundle->GetPath()), PyExc_ImportError);
+  }
+
+  JSModuleSource LoadModule(v8x::LockedIsolatePtr& v8_isolate, const std::string& name) const override {
+    auto entry = m_bundle->Find(name);
+    if (!entry || !entry->m_is_module) {
+      throw JSException(fmt::format("Module '{}' is not in bundle '{}'", name, m_bundle->GetPath()), PyExc_ImportError);
+    }
+    auto code_cache = m_bundle->CodeCache(*entry);
+    // the map keeps its own code cache only for sources coming without one, then it needs the hash
+    auto source_hash = code_cache.empty() ? std::hash<std::string_view>{}(entry->m_source) : 0;
+    return JSModuleSource{m_bundle->Source(v8_isolate, *entry), source_hash, code_cache};
+  }
+};
+
+static std::string_view readSpan(std::string_view file, const BundleSpan& span) {
+  if (span.m_offset > file.size() || span.m_length > file.size() - span.m_offset) {
+    throw JSException("Corrupted bundle, span out of bounds", PyExc_ValueError);
+  }
+  return file.substr(span.m_offset, span.m_length);
+}
+
+template <typename T>
+static std::vector<T> readRecords(std::string_view file, const BundleSpan& span) {
+  auto bytes = readSpan(file, span);
+  if (bytes.size() % sizeof(T)) {
+    throw JSException("Corrupted bundle, bad record size", PyExc_ValueError);
+  }
+  // records are aligned by the writer, but we do not rely on it
+  std::vector<T> records(bytes.size() / sizeof(T));
+  std::memcpy(records.data(), bytes.data(), bytes.size());
+  return records;
+}
+
+static std::string encodeSource(v8x::LockedIsolatePtr& v8_isolate, v8::Local<v8::String> v8_source, uint32_t& flags) {
+  auto length = v8_source->Length();
+  std::string result;
+  if (v8_source->ContainsOnlyOneByte()) {
+    result.resize(length);
+    v8_source->WriteOneByte(v8_isolate, reinterpret_cast<uint8_t*>(result.data()), 0, length,
+                            v8::String::NO_NULL_TERMINATION);
+  } else {
+    flags |= kTwoByteSource;
+    result.resize(length * sizeof(uint16_t));
+    v8_source->Write(v8_isolate, reinterpret_cast<uint16_t*>(result.data()), 0, length,
+                     v8::String::NO_NULL_TERMINATION);
+  }
+  return result;
+}
+
+static std::string toCodeCache(v8::ScriptCompiler::CachedData* raw_cached_data) {
+  std::unique_ptr<v8::ScriptCompiler::CachedData> v8_cached_data(raw_cached_data);
+  if (!v8_cached_data) {
+    return std::string();
+  }
+  return std::string(reinterpret_cast<const char*>(v8_cached_data->data), v8_cached_data->length);
+}
+
+struct JSBundle::MappedFile {
+  void* m_data{MAP_FAILED};
+  size_t m_size{0};
+
+  ~MappedFile() {
+    if (m_data != MAP_FAILED) {
+      munmap(m_data, m_size);
+    }
+  }
+
+  std::string_view View() const { return std::string_view(static_cast<const char*>(m_data), m_size); }
+};
+
+JSBundle::JSBundle(const std::string& path) : m_path(path), m_code_caches_usable(false) {
+  TRACE("JSBundle::JSBundle {} path={}", THIS, path);
+  auto file = std::make_shared<MappedFile>();
+  auto fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw JSException(fmt::format("Unable to open bundle '{}': {}", path, strerror(errno)), PyExc_OSError);
+  }
+  struct stat file_stat {};
+  if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0) {
+    file->m_size = static_cast<size_t>(file_stat.st_size);
+    file->m_data = mmap(nullptr, file->m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  auto mmap_errno = errno;
+  close(fd);
+  if (file->m_size < sizeof(BundleHeader)) {
+    throw JSException(fmt::format("'{}' is not a bundle", path), PyExc_ValueError);
+  }
+  if (file->m_data == MAP_FAILED) {
+    throw JSException(fmt::format("Unable to map bundle '{}': {}", path, strerror(mmap_errno)), PyExc_OSError);
+  }
+  m_file = file;
+
+  auto view = file->View();
+  BundleHeader header{};
+  std::memcpy(&header, view.data(), sizeof(header));
+  if (std::memcmp(header.m_magic, kBundleMagic, sizeof(kBundleMagic)) != 0) {
+    throw JSException(fmt::format("'{}' is not a bundle", path), PyExc_ValueError);
+  }
+  if (header.m_format != kBundleFormat) {
+    throw JSException(fmt::format("Bundle '{}' has unsupported format {}", path, header.m_format), PyExc_ValueError);
+  }
+  m_v8_version = std::string(readSpan(view, header.m_v8_version));
+  m_code_caches_usable = m_v8_version == v8::V8::GetVersion();
+
+  auto index = readRecords<BundleEntry>(view, header.m_index);
+  if (index.size() != header.m_num_entries) {
+    throw JSException("Corrupted bundle, bad index size", PyExc_ValueError);
+  }
+  m_entries.reserve(index.size());
+  for (auto& record : index) {
+    Entry entry{(record.m_flags & kModuleEntry) != 0, (record.m_flags & kTwoByteSource) != 0,
+                readSpan(view, record.m_source), readSpan(view, record.m_code_cache)};
+    for (auto& request : readRecords<BundleRequest>(view, record.m_requests)) {
+      entry.m_requests.emplace(readSpan(view, request.m_specifier), readSpan(view, request.m_name));
+    }
+    m_entries.emplace(readSpan(view, record.m_name), std::move(entry));
+  }
+  TRACE("JSBundle::JSBundle {} entries={} v8_version={}", THIS, m_entries.size(), m_v8_version);
+}
+
+JSBundle::~JSBundle() {
+  TRACE("JSBundle::~JSBundle {}", THIS);
+}
+
+void JSBundle::Build(const std::string& path, const py::dict& py_scripts, const py::dict& py_modules) {
+  TRACE("JSBundle::Build path={} py_scripts={} py_modules={}", path, py_scripts, py_modules);
+  auto v8_isolate = v8x::getCurrentIsolate();
+  auto v8_scope = v8x::withScope(v8_isolate);
+  auto v8_context = v8x::getCurrentContext(v8_isolate);
+  auto& resolver = JSIsolate::FromV8(v8_isolate)->Modules().Resolver();
+  auto v8_try_catch = v8x::withAutoTryCatch(v8_isolate);
+
+  BundleWriter writer;
+  std::vector<BundleEntry> index;
+
+  auto add_entry = [&](const py::handle& py_name, const py::handle& py_source, bool is_module) {
+    auto name = py::cast<std::string>(py_name);
+    auto v8_name = v8x::toString(v8_isolate, name);
+    auto v8_source_string = v8x::toString(v8_isolate, py_source);
+    auto entry = BundleEntry{};
+    entry.m_flags = is_module ? kModuleEntry : 0;
+
+    std::string code_cache;
+    std::vector<BundleRequest> requests;
+    if (is_module) {
+      auto v8_origin = v8x::createModuleOrigin(v8_isolate, v8_name);
+      v8::ScriptCompiler::Source v8_source(v8_source_string, v8_origin);
+      auto v8_maybe_module = v8::ScriptCompiler::CompileModule(v8_isolate, &v8_source);
+      v8x::checkTryCatch(v8_isolate, v8_try_catch);
+      auto v8_module = v8_maybe_module.ToLocalChecked();
+      code_cache = toCodeCache(v8::ScriptCompiler::CreateCodeCache(v8_module->GetUnboundModuleScript()));
+
+      // the module graph is resolved now, with the resolver of this isolate
+      std::map<std::string, std::string> resolved;
+      for (int i = 0; i < v8_module->GetModuleRequestsLength(); i++) {
+        auto specifier = v8x::toStdString(v8_isolate, v8_module->GetModuleRequest(i));
+        resolved.emplace(specifier, resolver.Resolve(specifier, name));
+      }
+      for (auto& [specifier, resolved_name] : resolved) {
+        requests.push_back(BundleRequest{writer.Append(specifier), writer.Append(resolved_name)});
+      }
+    } else {
+      auto v8_origin = v8x::createScriptOrigin(v8_name, v8x::toPositiveInteger(v8_isolate, -1),
+                                               v8x::toPositiveInteger(v8_isolate, -1));
+      v8::ScriptCompiler::Source v8_source(v8_source_string, v8_origin);
+      auto v8_maybe_script = v8::ScriptCompiler::Compile(v8_context, &v8_source);
+      v8x::checkTryCatch(v8_isolate, v8_try_catch);
+      auto v8_script = v8_maybe_script.ToLocalChecked();
+      code_cache = toCodeCache(v8::ScriptCompiler::CreateCodeCache(v8_script->GetUnboundScript()));
+    }
+
+    entry.m_name = writer.Append(name);
+    entry.m_source = writer.Append(encodeSource(v8_isolate, v8_source_string, entry.m_flags));
+    entry.m_code_cache = writer.Append(code_cache);
+    entry.m_requests = writer.AppendRecords(requests);
+    index.push_back(entry);
+  };
+
+  for (auto [py_name, py_source] : py_scripts) {
+    add_entry(py_name, py_source, false);
+  }
+  for (auto [py_name, py_source] : py_modules) {
+    add_entry(py_name, py_source, true);
+  }
+
+  auto header = BundleHeader{};
+  std::memcpy(header.m_magic, kBundleMagic, sizeof(kBundleMagic));
+  header.m_format = kBundleFormat;
+  header.m_num_entries = static_cast<uint32_t>(index.size());
+  header.m_v8_version = writer.Append(v8::V8::GetVersion());
+  header.m_index = writer.AppendRecords(index);
+  writer.WriteHeader(header);
+
+  // bundles may be mapped by running processes, we replace the file instead of rewriting it in place
+  auto tmp_path = path + ".tmp";
+  {
+    std::ofstream file(tmp_path, std::ios::out | std::ios::trunc | std::ios::binary);
+    file.write(writer.Data().data(), static_cast<std::streamsize>(writer.Data().size()));
+    if (!file) {
+      throw JSException(fmt::format("Unable to write bundle to '{}'", tmp_path), PyExc_OSError);
+    }
+  }
+  if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+    throw JSException(fmt::format("Unable to write bundle to '{}': {}", path, strerror(errno)), PyExc_OSError);
+  }
+}
+
+const JSBundle::Entry* JSBundle::Find(const std::string& name) const {
+  auto it = m_entries.find(name);
+  return it == m_entries.end() ? nullptr : &it->second;
+}
+
+v8::Local<v8::String> JSBundle::Source(v8x::LockedIsolatePtr& v8_isolate, const Entry& entry) const {
+  TRACE("JSBundle::Source {} size={}", THIS, entry.m_source.size());
+  m_num_sources_served++;
+  if (entry.m_source.empty()) {
+    return v8::String::Empty(v8_isolate);
+  }
+  // V8 takes ownership of a resource once the string is created, the resource keeps the mapping alive
+  v8::Local<v8::String> v8_source;
+  if (entry.m_is_two_byte) {
+    auto resource = std::make_unique<BundleTwoByteSource>(m_file, entry.m_source);
+    if (v8::String::NewExternalTwoByte(v8_isolate, resource.get()).ToLocal(&v8_source)) {
+      resource.release();
+    }
+  } else {
+    auto resource = std::make_unique<BundleOneByteSource>(m_file, entry.m_source);
+    if (v8::String::NewExternalOneByte(v8_isolate, resource.get()).ToLocal(&v8_source)) {
+      resource.release();
+    }
+  }
+  if (v8_source.IsEmpty()) {
+    throw JSException(fmt::format("Source of {} bytes in bundle '{}' exceeds V8 string length limit",
+                                  entry.m_source.size(), m_path),
+                      PyExc_ValueError);
+  }
+  return v8_source;
+}
+
+std::string_view JSBundle::CodeCache(const Entry& entry) const {
+  return m_code_caches_usable ? entry.m_code_cache : std::string_view();
+}
+
+const std::string& JSBundle::GetPath() const {
+  return m_path;
+}
+
+const std::string& JSBundle::GetV8Version() const {
+  return m_v8_version;
+}
+
+py::list JSBundle::GetNames() const {
+  std::vector<std::string_view> names;
+  for (auto& [name, _] : m_entries) {
+    names.push_back(name);
+  }
+  std::sort(names.begin(), names.end());
+  py::list py_result;
+  for (auto name : names) {
+    py_result.append(py::str(name.data(), name.size()));
+  }
+  return py_result;
+}
+
+py::dict JSBundle::GetRequests(const std::string& name) const {
+  auto entry = Find(name);
+  if (!entry) {
+    throw JSException(fmt::format("'{}' is not in bundle '{}'", name, m_path), PyExc_KeyError);
+  }
+  py::dict py_result;
+  for (auto& [specifier, resolved_name] : entry->m_requests) {
+    py_result[py::str(specifier)] = resolved_name;
+  }
+  return py_result;
+}
+
+py::dict JSBundle::GetStats() const {
+  size_t source_bytes = 0;
+  size_t code_cache_bytes = 0;
+  size_t num_modules = 0;
+  for (auto& [_, entry] : m_entries) {
+    source_bytes += entry.m_source.size();
+    code_cache_bytes += entry.m_code_cache.size();
+    num_modules += entry.m_is_module;
+  }
+
+  py::dict py_result;
+  py_result["size"] = m_file->m_size;
+  py_result["scripts"] = m_entries.size() - num_modules;
+  py_result["modules"] = num_modules;
+  py_result["source_bytes"] = source_bytes;
+  py_result["code_cache_bytes"] = code_cache_bytes;
+  py_result["code_caches_usable"] = m_code_caches_usable;
+  py_result["sources_served"] = m_num_sources_served.load();
+  return py_result;
+}
+
+void JSBundle::Install() {
+  TRACE("JSBundle::Install {}", THIS);
+  auto v8_isolate = v8x::getCurrentIsolate();
+  JSIsolate::FromV8(v8_isolate)->Modules().SetResolver(std::make_unique<BundleModuleResolver>(shared_from_this()));
+}
+
+void JSBundle::Dump(std::ostream& os) const {
+  fmt::print(os, "JSBundle {} path={} entries={}", THIS, m_path, m_entries.size());
+}
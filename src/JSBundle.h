@@ -0,0 +1,70 @@
+#ifndef NAGA_JSBUNDLE_H_
+#define NAGA_JSBUNDLE_H_
+
+#include "Base.h"
+
+#include <atomic>
+#include <string_view>
+#include <unordered_map>
+
+// A bundle is a single file holding classic scripts and ES modules together with their V8 code caches and the resolved
+// module graph. Bundles are built by JSBundle.build (see naga.bundle for the command line tool) and opened by mapping
+// the file into memory. Only the index is read at open, sources and code caches are touched when first compiled.
+//
+// Sources are stored the way V8 keeps strings, Latin-1 or UTF-16 in native byte order, so they are handed to V8
+// as external strings pointing into the mapping without copies. Code caches are fed to ScriptCompiler straight from
+// the mapping as well. The mapping stays alive while any such string is alive, even after the bundle object is gone.
+//
+// Code caches are valid only for the V8 version (and flags) which produced them. Bundles built by another V8 version
+// are served without caches, V8 itself rejects caches produced with different flags.
+//
+// Layout, all offsets are from the start of the file and every blob starts 8-byte aligned:
+//
+//   header    magic "NAGABNDL", format, number of entries, V8 version span, index span
+//   blobs     names, sources, code caches, V8 version
+//   requests  per module: (import specifier span, resolved name span) pairs
+//   index     per entry: name, source, code cache and requests spans, flags
+
+class JSBundle : public std::enable_shared_from_this<JSBundle> {
+ public:
+  struct Entry {
+    bool m_is_module;
+    bool m_is_two_byte;
+    std::string_view m_source;
+    std::string_view m_code_cache;
+    std::unordered_map<std::string, std::string> m_requests;  // import specifier => resolved name
+  };
+
+ private:
+  struct MappedFile;
+
+  std::string m_path;
+  std::shared_ptr<const MappedFile> m_file;
+  std::string m_v8_version;
+  bool m_code_caches_usable;
+  std::unordered_map<std::string, Entry> m_entries;
+  mutable std::atomic<uint64_t> m_num_sources_served{0};
+
+ public:
+  explicit JSBundle(const std::string& path);
+  ~JSBundle();
+
+  static void Build(const std::string& path, const py::dict& py_scripts, const py::dict& py_modules);
+
+  [[nodiscard]] const Entry* Find(const std::string& name) const;
+  [[nodiscard]] v8::Local<v8::String> Source(v8x::LockedIsolatePtr& v8_isolate, const Entry& entry) const;
+  // empty when the bundle was built by another V8 version
+  [[nodiscard]] std::string_view CodeCache(const Entry& entry) const;
+
+  [[nodiscard]] const std::string& GetPath() const;
+  [[nodiscard]] const std::string& GetV8Version() const;
+  [[nodiscard]] py::list GetNames() const;
+  [[nodiscard]] py::dict GetRequests(const std::string& name) const;
+  [[nodiscard]] py::dict GetStats() const;
+
+  void Install();
+
+  void Dump(std::ostream& os) const;
+};
+
+#endif
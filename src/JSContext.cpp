@@ -2,7 +2,9 @@
 #include "JSEngine.h"
 #include "JSScript.h"
 #include "JSIsolate.h"
+#include "JSModuleMap.h"
 #include "JSException.h"
+#include "JSStructuredClone.h"
 #include "Wrapping.h"
 #include "Logging.h"
 #include "Printing.h"
@@ -54,6 +56,9 @@ JSContext::JSContext(const py::object& py_global) : m_entered_level(0) {
   v8_context->SetEmbedderData(kSelfEmbedderDataIndex, v8_this);
   m_v8_context.Reset(v8_isolate, v8_context);
   m_v8_context.AnnotateStrongRetainer("Naga JSContext");
+  m_v8_context.SetWrapperClassId(v8x::kJSContextHandle);
+
+  installStructuredClone(v8_isolate, v8_context);
 
   if (!py_global.is_none()) {
     auto v8_context_scope = v8x::withContext(v8_context);
@@ -65,9 +70,14 @@ JSContext::JSContext(const py::object& py_global) : m_entered_level(0) {
 
 JSContext::~JSContext() {
   TRACE("JSContext::~JSContext {}", THIS);
+  m_isolate->Modules().ForgetContext(this);
   m_v8_context.Reset();
 }
 
+SharedJSIsolatePtr JSContext::GetIsolate() const {
+  return m_isolate;
+}
+
 py::object JSContext::GetGlobal() const {
   assert(areIsolatesConsistent(m_v8_context, m_isolate));
   auto v8_isolate = m_isolate->ToV8();
@@ -124,22 +134,27 @@ py::object JSContext::GetCurrent() {
   return py_result;
 }
 
-py::object JSContext::Evaluate(const std::string& src, const std::string& name, int line, int col) {
-  TRACE("JSContext::Evaluate name={} line={} col={} src={}", name, line, col, traceText(src));
+py::object JSContext::Evaluate(const std::string& src, const std::string& name, int line, int col, double timeout) {
+  TRACE("JSContext::Evaluate name={} line={} col={} timeout={} src={}", name, line, col, timeout, traceText(src));
   auto v8_isolate = v8x::getCurrentIsolate();
   JSEngine engine(v8_isolate);
   SharedJSScriptPtr script = engine.Compile(src, name, line, col);
-  auto py_result = script->Run();
+  auto py_result = script->Run(timeout);
   TRACE("JSContext::Evaluate => {}", py_result);
   return py_result;
 }
 
-py::object JSContext::EvaluateW(const std::wstring& src, const std::wstring& name, int line, int col) {
-  TRACE("JSContext::EvaluateW name={} line={} col={} src={}", P$(name), line, col, traceText(P$(src)));
+py::object JSContext::EvaluateW(const std::wstring& src,
+                                const std::wstring& name,
+                                int line,
+                                int col,
+                                double timeout) {
+  TRACE("JSContext::EvaluateW name={} line={} col={} timeout={} src={}", P$(name), line, col, timeout,
+        traceText(P$(src)));
   auto v8_isolate = v8x::getCurrentIsolate();
   JSEngine engine(v8_isolate);
   SharedJSScriptPtr script = engine.CompileW(src, name, line, col);
-  return script->Run();
+  return script->Run(timeout);
 }
 
 void JSContext::Enter() {
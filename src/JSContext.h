@@ -22,6 +22,7 @@ class JSContext : public std::enable_shared_from_this<JSContext> {
 
   void Dump(std::ostream& os) const;
 
+  [[nodiscard]] SharedJSIsolatePtr GetIsolate() const;
   [[nodiscard]] py::object GetGlobal() const;
 
   py::str GetSecurityToken() const;
@@ -35,11 +36,13 @@ class JSContext : public std::enable_shared_from_this<JSContext> {
   static py::object Evaluate(const std::string& src,
                              const std::string& name = std::string(),
                              int line = -1,
-                             int col = -1);
+                             int col = -1,
+                             double timeout = 0);
   static py::object EvaluateW(const std::wstring& src,
                               const std::wstring& name = std::wstring(),
                               int line = -1,
-                              int col = -1);
+                              int col = -1,
+                              double timeout = 0);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,164 @@
+#include "JSCpuProfiler.h"
+#include "JSException.h"
+#include "Logging.h"
+#include "Printing.h"
+#include "V8XUtils.h"
+
+#include <algorithm>
+
+#define TRACE(...) \
+  LOGGER_INDENT;   \
+  SPDLOG_LOGGER_TRACE(getLogger(kJSProfilerLogger), __VA_ARGS__)
+
+static std::string frameName(const v8::CpuProfileNode* v8_node) {
+  auto function_name = std::string(v8_node->GetFunctionNameStr());
+  if (function_name.empty()) {
+    function_name = "(anonymous)";
+  }
+  auto url = std::string(v8_node->GetScriptResourceNameStr());
+  if (url.empty()) {
+    return function_name;
+  }
+  return fmt::format("{} ({}:{})", function_name, url, v8_node->GetLineNumber());
+}
+
+static void collectFoldedStacks(const v8::CpuProfileNode* v8_node, const std::string& stack, std::string& out) {
+  // the artificial "(root)" node is not part of any stack
+  auto node_stack = v8_node->GetParent() ? (stack.empty() ? frameName(v8_node) : stack + ";" + frameName(v8_node))  //
+                                         : std::string();
+  auto hit_count = v8_node->GetHitCount();
+  if (hit_count > 0 && !node_stack.empty()) {
+    out += fmt::format("{} {}\n", node_stack, hit_count);
+  }
+  for (int i = 0; i < v8_node->GetChildrenCount(); i++) {
+    collectFoldedStacks(v8_node->GetChild(i), node_stack, out);
+  }
+}
+
+static void collectNodes(const v8::CpuProfileNode* v8_node, py::list& py_nodes) {
+  py::dict py_call_frame;
+  py_call_frame["functionName"] = v8_node->GetFunctionNameStr();
+  py_call_frame["scriptId"] = std::to_string(v8_node->GetScriptId());
+  py_call_frame["url"] = v8_node->GetScriptResourceNameStr();
+  // DevTools expects zero-based positions in call frames
+  py_call_frame["lineNumber"] = v8_node->GetLineNumber() - 1;
+  py_call_frame["columnNumber"] = v8_node->GetColumnNumber() - 1;
+
+  py::list py_children;
+  for (int i = 0; i < v8_node->GetChildrenCount(); i++) {
+    py_children.append(v8_node->GetChild(i)->GetNodeId());
+  }
+
+  py::list py_position_ticks;
+  auto line_count = v8_node->GetHitLineCount();
+  if (line_count > 0) {
+    std::vector<v8::CpuProfileNode::LineTick> line_ticks(line_count);
+    if (v8_node->GetLineTicks(line_ticks.data(), line_count)) {
+      for (auto& line_tick : line_ticks) {
+        py::dict py_tick;
+        py_tick["line"] = line_tick.line;
+        py_tick["ticks"] = line_tick.hit_count;
+        py_position_ticks.append(py_tick);
+      }
+    }
+  }
+
+  py::dict py_node;
+  py_node["id"] = v8_node->GetNodeId();
+  py_node["callFrame"] = py_call_frame;
+  py_node["hitCount"] = v8_node->GetHitCount();
+  py_node["children"] = py_children;
+  if (!py_position_ticks.empty()) {
+    py_node["positionTicks"] = py_position_ticks;
+  }
+  if (auto bailout_reason = v8_node->GetBailoutReason(); bailout_reason && *bailout_reason) {
+    py_node["deoptReason"] = bailout_reason;
+  }
+  py_nodes.append(py_node);
+
+  for (int i = 0; i < v8_node->GetChildrenCount(); i++) {
+    collectNodes(v8_node->GetChild(i), py_nodes);
+  }
+}
+
+static std::string serializeCpuProfile(const v8::CpuProfile* v8_profile) {
+  py::list py_nodes;
+  collectNodes(v8_profile->GetTopDownRoot(), py_nodes);
+
+  py::list py_samples;
+  py::list py_time_deltas;
+  auto last_timestamp = v8_profile->GetStartTime();
+  for (int i = 0; i < v8_profile->GetSamplesCount(); i++) {
+    py_samples.append(v8_profile->GetSample(i)->GetNodeId());
+    auto timestamp = v8_profile->GetSampleTimestamp(i);
+    py_time_deltas.append(timestamp - last_timestamp);
+    last_timestamp = timestamp;
+  }
+
+  py::dict py_profile;
+  py_profile["nodes"] = py_nodes;
+  py_profile["startTime"] = v8_profile->GetStartTime();
+  py_profile["endTime"] = v8_profile->GetEndTime();
+  py_profile["samples"] = py_samples;
+  py_profile["timeDeltas"] = py_time_deltas;
+
+  auto py_json = py::module::import("json");
+  return py_json.attr("dumps")(py_profile).cast<std::string>();
+}
+
+JSCpuProfiler::JSCpuProfiler(v8x::ProtectedIsolatePtr v8_protected_isolate) : m_v8_isolate(v8_protected_isolate) {
+  TRACE("JSCpuProfiler::JSCpuProfiler {} v8_isolate={}", THIS, m_v8_isolate);
+}
+
+JSCpuProfiler::~JSCpuProfiler() {
+  TRACE("JSCpuProfiler::~JSCpuProfiler {}", THIS);
+  if (m_v8_profiler) {
+    m_v8_profiler->Dispose();
+  }
+}
+
+void JSCpuProfiler::Start(const std::string& name, int sampling_interval_us) {
+  TRACE("JSCpuProfiler::Start {} name={} sampling_interval_us={}", THIS, name, sampling_interval_us);
+  auto v8_isolate = m_v8_isolate.lock();
+  auto v8_scope = v8x::withScope(v8_isolate);
+
+  if (!m_v8_profiler) {
+    m_v8_profiler = v8::CpuProfiler::New(v8_isolate);
+  }
+  if (sampling_interval_us > 0) {
+    m_v8_profiler->SetSamplingInterval(sampling_interval_us);
+  }
+
+  auto v8_options = v8::CpuProfilingOptions(v8::kLeafNodeLineNumbers, v8::CpuProfilingOptions::kNoSampleLimit,
+                                            std::max(sampling_interval_us, 0));
+  auto status = m_v8_profiler->StartProfiling(v8x::toString(v8_isolate, name), v8_options);
+  if (status == v8::CpuProfilingStatus::kAlreadyStarted) {
+    throw JSException(v8_isolate, fmt::format("CPU profile '{}' is already being recorded", name));
+  }
+  if (status != v8::CpuProfilingStatus::kStarted) {
+    throw JSException(v8_isolate, fmt::format("Unable to start CPU profile '{}'", name));
+  }
+}
+
+std::string JSCpuProfiler::Stop(const std::string& name, const std::string& format) {
+  TRACE("JSCpuProfiler::Stop {} name={} format={}", THIS, name, format);
+  if (format != "cpuprofile" && format != "folded") {
+    throw JSException(m_v8_isolate, fmt::format("Unknown CPU profile format '{}'", format), PyExc_ValueError);
+  }
+
+  auto v8_isolate = m_v8_isolate.lock();
+  auto v8_scope = v8x::withScope(v8_isolate);
+  auto v8_profile = m_v8_profiler ? m_v8_profiler->StopProfiling(v8x::toString(v8_isolate, name)) : nullptr;
+  if (!v8_profile) {
+    throw JSException(v8_isolate, fmt::format("CPU profile '{}' was not started", name));
+  }
+
+  std::string result;
+  if (format == "folded") {
+    collectFoldedStacks(v8_profile->GetTopDownRoot(), std::string(), result);
+  } else {
+    result = serializeCpuProfile(v8_profile);
+  }
+  v8_profile->Delete();
+  return result;
+}
@@ -0,0 +1,27 @@
+#ifndef NAGA_JSCPUPROFILER_H_
+#define NAGA_JSCPUPROFILER_H_
+
+#include "Base.h"
+#include "V8XProtectedIsolate.h"
+
+// JSCpuProfiler wraps v8::CpuProfiler of one isolate, see JSIsolate::StartCpuProfile/StopCpuProfile.
+//
+// The V8 profiler is created lazily on first use and disposed together with the isolate.
+// Finished profiles are serialized either as Chrome DevTools .cpuprofile JSON or as folded stacks
+// (one "frame;frame;frame count" line per unique stack) which can be fed into flamegraph.pl or speedscope.
+// Source positions come from script origins recorded at compile time (script name, line and column offsets).
+
+class JSCpuProfiler {
+  v8x::ProtectedIsolatePtr m_v8_isolate;
+  v8::CpuProfiler* m_v8_profiler{nullptr};
+
+ public:
+  explicit JSCpuProfiler(v8x::ProtectedIsolatePtr v8_protected_isolate);
+  ~JSCpuProfiler();
+
+  void Start(const std::string& name, int sampling_interval_us);
+  // format is either "cpuprofile" or "folded"
+  std::string Stop(const std::string& name, const std::string& format);
+};
+
+#endif
@@ -1,5 +1,15 @@
 #include "JSEngine.h"
+#include "JSBundle.h"
+#include "JSFunctionCache.h"
 #include "JSScript.h"
+#include "JSScriptFuture.h"
+#include "JSScriptStreamer.h"
+#include "JSModule.h"
+#include "JSModuleMap.h"
+#include "JSIsolate.h"
+#include "JSIsolateStats.h"
+#include "JSWatchdog.h"
+#include "JSException.h"
 #include "PythonUtils.h"
 #include "Wrapping.h"
 #include "Logging.h"
@@ -66,17 +76,22 @@ bool JSEngine::IsDead() {
   return result;
 }
 
-py::object JSEngine::ExecuteScript(v8::Local<v8::Script> v8_script) const {
-  TRACE("JSEngine::ExecuteScript v8_script={}", v8_script);
+py::object JSEngine::ExecuteScript(v8::Local<v8::Script> v8_script, double timeout) const {
+  TRACE("JSEngine::ExecuteScript v8_script={} timeout={}", v8_script, timeout);
   auto v8_isolate = v8x::getCurrentIsolate();
+  JSIsolate::FromV8(v8_isolate)->CheckOutOfMemory();
   auto v8_scope = v8x::withScope(v8_isolate);
   auto v8_context = v8x::getCurrentContext(v8_isolate);
+  // note the deadline must outlive the try catch
+  auto deadline = JSDeadline(v8_isolate, timeout);
   auto v8_try_catch = v8x::withAutoTryCatch(v8_isolate);
 
   v8::MaybeLocal<v8::Value> v8_maybe_result;
   {
     auto _ = pyu::withoutGIL();
+    auto start = JSIsolateStats::Clock::now();
     v8_maybe_result = v8_script->Run(v8_context);
+    JSIsolateStats::FromV8(v8_isolate)->RecordExecute(JSIsolateStats::Clock::now() - start);
   }
 
   if (v8_maybe_result.IsEmpty()) {
@@ -114,13 +129,221 @@ SharedJSScriptPtr JSEngine::InternalCompile(v8x::LockedIsolatePtr& v8_isolate,
     auto v8_line = v8x::toPositiveInteger(v8_isolate, line);
     auto v8_col = v8x::toPositiveInteger(v8_isolate, col);
     auto v8_script_origin = v8x::createScriptOrigin(v8_name, v8_line, v8_col);
+    auto start = JSIsolateStats::Clock::now();
     v8_maybe_script = v8::Script::Compile(v8_context, v8_src, &v8_script_origin);
+    JSIsolateStats::FromV8(v8_isolate)->RecordCompile(JSIsolateStats::Clock::now() - start);
   }
 
   v8x::checkTryCatch(v8_isolate, v8_try_catch);
   return std::make_shared<JSScript>(v8_isolate, *this, v8_src, v8_maybe_script.ToLocalChecked());
 }
 
+// file-like sources are read in chunks of this size, iterables yield their own chunks
+constexpr size_t kStreamChunkSize = 64 * 1024;
+
+static std::string_view streamChunk(const py::handle& py_chunk) {
+  if (PyUnicode_Check(py_chunk.ptr())) {
+    Py_ssize_t size;
+    auto data = PyUnicode_AsUTF8AndSize(py_chunk.ptr(), &size);
+    if (!data) {
+      throw py::error_already_set();
+    }
+    return {data, static_cast<size_t>(size)};
+  }
+  if (PyBytes_Check(py_chunk.ptr())) {
+    return {PyBytes_AS_STRING(py_chunk.ptr()), static_cast<size_t>(PyBytes_GET_SIZE(py_chunk.ptr()))};
+  }
+  if (PyByteArray_Check(py_chunk.ptr())) {
+    return {PyByteArray_AS_STRING(py_chunk.ptr()), static_cast<size_t>(PyByteArray_GET_SIZE(py_chunk.ptr()))};
+  }
+  throw JSException(fmt::format("Script source chunks must be str or UTF-8 bytes, got {}",
+                                py::str(py_chunk.get_type().attr("__name__")).cast<std::string>()),
+                    PyExc_TypeError);
+}
+
+SharedJSScriptPtr JSEngine::CompileStream(const py::object& py_source,
+                                          const std::string& name,
+                                          int line,
+                                          int col) const {
+  TRACE("JSEngine::CompileStream name={} line={} col={} py_source={}", name, line, col, py_source);
+  auto v8_isolate = m_v8_isolate.lock();
+
+  // the worker thread parses each chunk while we are reading the next one from Python
+  auto streamer = JSScriptStreamer(v8_isolate);
+  try {
+    if (py::hasattr(py_source, "read")) {
+      auto py_read = py_source.attr("read");
+      while (true) {
+        auto py_chunk = py_read(kStreamChunkSize);
+        auto chunk = streamChunk(py_chunk);
+        if (chunk.empty()) {
+          break;
+        }
+        streamer.Push(chunk);
+      }
+    } else {
+      for (auto py_chunk : py::iter(py_source)) {
+        streamer.Push(streamChunk(py_chunk));
+      }
+    }
+  } catch (...) {
+    streamer.Finish();
+    auto _ = pyu::withoutGIL();
+    streamer.Wait();
+    throw;
+  }
+  streamer.Finish();
+  return CompileStreamed(v8_isolate, streamer, name, line, col);
+}
+
+SharedJSScriptFuturePtr JSEngine::CompileAsync(const std::string& src,
+                                               const std::string& name,
+                                               int line,
+                                               int col) const {
+  TRACE("JSEngine::CompileAsync name={} line={} col={} src={}", name, line, col, traceText(src));
+  auto v8_isolate = m_v8_isolate.lock();
+  auto streamer = std::make_unique<JSScriptStreamer>(v8_isolate);
+  streamer->Push(src);
+  streamer->Finish();
+  return std::make_shared<JSScriptFuture>(v8_isolate, *this, std::move(streamer), name, line, col);
+}
+
+SharedJSScriptPtr JSEngine::CompileStreamed(v8x::LockedIsolatePtr& v8_isolate,
+                                            JSScriptStreamer& streamer,
+                                            const std::string& name,
+                                            int line,
+                                            int col) const {
+  TRACE("JSEngine::CompileStreamed name={} line={} col={}", name, line, col);
+  JSIsolate::FromV8(v8_isolate)->CheckOutOfMemory();
+  auto v8_scope = v8x::withScope(v8_isolate);
+  auto v8_context = v8x::getCurrentContext(v8_isolate);
+  auto v8_src = v8x::toString(v8_isolate, streamer.GetSource());
+  auto v8_try_catch = v8x::withAutoTryCatch(v8_isolate);
+  v8::MaybeLocal<v8::Script> v8_maybe_script;
+  {
+    auto _ = pyu::withoutGIL();
+    streamer.Wait();
+    auto v8_name = v8x::toString(v8_isolate, name);
+    auto v8_line = v8x::toPositiveInteger(v8_isolate, line);
+    auto v8_col = v8x::toPositiveInteger(v8_isolate, col);
+    auto v8_script_origin = v8x::createScriptOrigin(v8_name, v8_line, v8_col);
+    auto start = JSIsolateStats::Clock::now();
+    v8_maybe_script = streamer.Compile(v8_context, v8_src, v8_script_origin);
+    JSIsolateStats::FromV8(v8_isolate)->RecordCompile(JSIsolateStats::Clock::now() - start);
+  }
+
+  v8x::checkTryCatch(v8_isolate, v8_try_catch);
+  return std::make_shared<JSScript>(v8_isolate, *this, v8_src, v8_maybe_script.ToLocalChecked());
+}
+
+SharedJSScriptPtr JSEngine::CompileBundled(const SharedJSBundlePtr& bundle, const std::string& name) const {
+  TRACE("JSEngine::CompileBundled bundle={} name={}", (void*)bundle.get(), name);
+  auto entry = bundle->Find(name);
+  if (!entry || entry->m_is_module) {
+    throw JSException(fmt::format("Script '{}' is not in bundle '{}'", name, bundle->GetPath()), PyExc_KeyError);
+  }
+
+  auto v8_isolate = m_v8_isolate.lock();
+  auto v8_scope = v8x::withScope(v8_isolate);
+  auto v8_context = v8x::getCurrentContext(v8_isolate);
+  auto v8_src = bundle->Source(v8_isolate, *entry);
+  auto code_cache = bundle->CodeCache(*entry);
+  auto v8_try_catch = v8x::withAutoTryCatch(v8_isolate);
+  v8::MaybeLocal<v8::Script> v8_maybe_script;
+  {
+    auto _ = pyu::withoutGIL();
+    // the source takes ownership of the cached data object, the code cache itself stays in the bundle
+    v8::ScriptCompiler::CachedData* v8_cached_data = nullptr;
+    if (!code_cache.empty()) {
+      v8_cached_data = new v8::ScriptCompiler::CachedData(reinterpret_cast<const uint8_t*>(code_cache.data()),
+                                                          static_cast<int>(code_cache.size()));
+    }
+    auto v8_name = v8x::toString(v8_isolate, name);
+    auto v8_line = v8x::toPositiveInteger(v8_isolate, -1);
+    auto v8_col = v8x::toPositiveInteger(v8_isolate, -1);
+    auto v8_script_origin = v8x::createScriptOrigin(v8_name, v8_line, v8_col);
+    v8::ScriptCompiler::Source v8_source(v8_src, v8_script_origin, v8_cached_data);
+    auto v8_options = v8_cached_data ? v8::ScriptCompiler::kConsumeCodeCache : v8::ScriptCompiler::kNoCompileOptions;
+    auto start = JSIsolateStats::Clock::now();
+    v8_maybe_script = v8::ScriptCompiler::Compile(v8_context, &v8_source, v8_options);
+    JSIsolateStats::FromV8(v8_isolate)->RecordCompile(JSIsolateStats::Clock::now() - start);
+  }
+
+  v8x::checkTryCatch(v8_isolate, v8_try_catch);
+  return std::make_shared<JSScript>(v8_isolate, *this, v8_src, v8_maybe_script.ToLocalChecked());
+}
+
+py::object JSEngine::CompileFunction(const std::string& body,
+                                     const std::vector<std::string>& params,
+                                     const py::list& py_context_extensions,
+                                     const std::string& name) const {
+  TRACE("JSEngine::CompileFunction name={} params={} body={}", name, params.size(), traceText(body));
+  auto v8_isolate = m_v8_isolate.lock();
+  JSIsolate::FromV8(v8_isolate)->CheckOutOfMemory();
+  auto v8_scope = v8x::withScope(v8_isolate);
+  auto v8_context = v8x::getCurrentContext(v8_isolate);
+
+  std::vector<v8::Local<v8::Object>> v8_context_extensions;
+  for (auto py_extension : py_context_extensions) {
+    auto v8_extension = wrap(py_extension);
+    if (!v8_extension->IsObject()) {
+      throw JSException("Context extensions must be objects", PyExc_TypeError);
+    }
+    v8_context_extensions.push_back(v8_extension.As<v8::Object>());
+  }
+
+  auto v8_try_catch = v8x::withAutoTryCatch(v8_isolate);
+  v8::MaybeLocal<v8::Function> v8_maybe_function;
+  {
+    auto _ = pyu::withoutGIL();
+    auto& functions = JSIsolate::FromV8(v8_isolate)->Functions();
+    v8_maybe_function = functions.Compile(v8_isolate, v8_context, name, body, params, v8_context_extensions);
+  }
+
+  v8x::checkTryCatch(v8_isolate, v8_try_catch);
+  // the function is wrapped as an object, there is no script result to convert and no this to bind
+  return wrap(v8_isolate, v8_maybe_function.ToLocalChecked().As<v8::Object>());
+}
+
+SharedJSModulePtr JSEngine::CompileModule(const std::string& src, const std::string& name) const {
+  TRACE("JSEngine::CompileModule name={} src={}", name, traceText(src));
+  auto v8_isolate = m_v8_isolate.lock();
+  auto v8_scope = v8x::withScope(v8_isolate);
+  auto v8_context = v8x::getCurrentContext(v8_isolate);
+  auto v8_try_catch = v8x::withAutoTryCatch(v8_isolate);
+  v8::MaybeLocal<v8::Module> v8_maybe_module;
+  {
+    auto _ = pyu::withoutGIL();
+    v8_maybe_module = JSIsolate::FromV8(v8_isolate)->Modules().Compile(v8_isolate, v8_context, name, src);
+  }
+
+  v8x::checkTryCatch(v8_isolate, v8_try_catch);
+  return std::make_shared<JSModule>(v8_isolate, name, v8_maybe_module.ToLocalChecked());
+}
+
+py::object JSEngine::ImportModule(const std::string& specifier, const std::string& referrer, double timeout) const {
+  TRACE("JSEngine::ImportModule specifier={} referrer={} timeout={}", specifier, referrer, timeout);
+  auto v8_isolate = m_v8_isolate.lock();
+  auto isolate = JSIsolate::FromV8(v8_isolate);
+  isolate->CheckOutOfMemory();
+  auto v8_scope = v8x::withScope(v8_isolate);
+  auto v8_context = v8x::getCurrentContext(v8_isolate);
+  // note the deadline must outlive the try catch
+  auto deadline = JSDeadline(v8_isolate, timeout);
+  auto v8_try_catch = v8x::withAutoTryCatch(v8_isolate);
+
+  v8::MaybeLocal<v8::Value> v8_maybe_namespace;
+  {
+    auto _ = pyu::withoutGIL();
+    v8_maybe_namespace = isolate->Modules().Import(v8_isolate, v8_context, specifier, referrer);
+  }
+
+  if (v8_maybe_namespace.IsEmpty()) {
+    return py::js_null();
+  }
+  return wrap(v8_isolate, v8_maybe_namespace.ToLocalChecked());
+}
+
 void JSEngine::Dump(std::ostream& os) const {
   fmt::print(os, "CEngine {}", THIS);
 }
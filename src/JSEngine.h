@@ -24,7 +24,7 @@ class JSEngine {
   static bool IsDead();
   static void TerminateAllThreads();
 
-  [[nodiscard]] py::object ExecuteScript(v8::Local<v8::Script> v8_script) const;
+  [[nodiscard]] py::object ExecuteScript(v8::Local<v8::Script> v8_script, double timeout = 0) const;
   SharedJSScriptPtr Compile(const std::string& src,
                             const std::string& name = std::string(),
                             int line = -1,
@@ -34,6 +34,28 @@ class JSEngine {
                              int line = -1,
                              int col = -1) const;
 
+  SharedJSScriptPtr CompileStream(const py::object& py_source,
+                                  const std::string& name = std::string(),
+                                  int line = -1,
+                                  int col = -1) const;
+  SharedJSScriptFuturePtr CompileAsync(const std::string& src,
+                                       const std::string& name = std::string(),
+                                       int line = -1,
+                                       int col = -1) const;
+  // finalizes a script parsed by the streamer, waits for the streamer first
+  SharedJSScriptPtr CompileStreamed(v8x::LockedIsolatePtr& v8_isolate,
+                                    JSScriptStreamer& streamer,
+                                    const std::string& name,
+                                    int line,
+                                    int col) const;
+  SharedJSScriptPtr CompileBundled(const SharedJSBundlePtr& bundle, const std::string& name) const;
+  py::object CompileFunction(const std::string& body,
+                             const std::vector<std::string>& params,
+                             const py::list& py_context_extensions,
+                             const std::string& name = std::string()) const;
+  SharedJSModulePtr CompileModule(const std::string& src, const std::string& name) const;
+  py::object ImportModule(const std::string& specifier, const std::string& referrer, double timeout = 0) const;
+
   void Dump(std::ostream& os) const;
 };
 
@@ -1,5 +1,6 @@
 #include "JSException.h"
 #include "JSEternals.h"
+#include "JSIsolate.h"
 #include "PythonModule.h"
 #include "Logging.h"
 #include "V8XUtils.h"
@@ -150,6 +151,7 @@ JSException::JSException(v8x::ProtectedIsolatePtr v8_protected_isolate,
 
   m_v8_exception.Reset(v8_isolate, v8_try_catch.Exception());
   m_v8_exception.AnnotateStrongRetainer("Naga JSException.m_v8_exception");
+  m_v8_exception.SetWrapperClassId(v8x::kJSExceptionHandle);
 
   auto v8_context = v8x::getCurrentContext(v8_isolate);
   auto stack_trace = v8_try_catch.StackTrace(v8_context);
@@ -185,6 +187,7 @@ JSException::JSException(const JSException& ex) noexcept
   auto v8_scope = v8x::withScope(v8_isolate);
 
   m_v8_exception.Reset(v8_isolate, ex.Exception());
+  m_v8_exception.SetWrapperClassId(v8x::kJSExceptionHandle);
   m_v8_stack.Reset(v8_isolate, ex.Stack());
   m_v8_message.Reset(v8_isolate, ex.Message());
 }
@@ -361,6 +364,12 @@ void JSException::CheckTryCatch(v8x::LockedIsolatePtr& v8_isolate, v8x::TryCatch
 
 void JSException::Throw(v8x::LockedIsolatePtr& v8_isolate, v8x::TryCatchPtr v8_try_catch) {
   TRACE("JSException::Throw v8_isolate={} v8_try_catch={}", P$(v8_isolate), *v8_try_catch);
+  if (v8_try_catch->HasTerminated()) {
+    // there is no JS exception object to translate, the isolate knows why the execution got terminated
+    v8_try_catch->Reset();
+    throw JSIsolate::FromV8(v8_isolate)->TerminationError();
+  }
+
   auto v8_scope = v8x::withScope(v8_isolate);
   assert(v8_try_catch->HasCaught() && v8_try_catch->CanContinue());
 
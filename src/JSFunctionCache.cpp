@@ -0,0 +1,131 @@
+#include "JSFunctionCache.h"
+#include "JSIsolateStats.h"
+#include "Logging.h"
+#include "Printing.h"
+#include "V8XUtils.h"
+
+#define TRACE(...) \
+  LOGGER_INDENT;   \
+  SPDLOG_LOGGER_TRACE(getLogger(kJSEngineLogger), __VA_ARGS__)
+
+static std::string functionKey(const std::string& body, const std::vector<std::string>& params) {
+  // parameter names are length-prefixed, so no two parameter lists give the same key
+  std::string result;
+  for (auto& param : params) {
+    result += fmt::format("{}:{},", param.size(), param);
+  }
+  result += '\n';
+  result += body;
+  return result;
+}
+
+JSFunctionCache::JSFunctionCache(v8x::ProtectedIsolatePtr v8_isolate) : m_v8_isolate(std::move(v8_isolate)) {
+  TRACE("JSFunctionCache::JSFunctionCache {} v8_isolate={}", THIS, m_v8_isolate);
+}
+
+JSFunctionCache::~JSFunctionCache() {
+  TRACE("JSFunctionCache::~JSFunctionCache {}", THIS);
+}
+
+v8::MaybeLocal<v8::Function> JSFunctionCache::Compile(v8x::LockedIsolatePtr& v8_isolate,
+                                                      v8::Local<v8::Context> v8_context,
+                                                      const std::string& name,
+                                                      const std::string& body,
+                                                      const std::vector<std::string>& params,
+                                                      std::vector<v8::Local<v8::Object>>& v8_context_extensions) {
+  TRACE("JSFunctionCache::Compile {} name={} params={} body={}", THIS, name, params.size(), traceText(body));
+  auto v8_scope = v8x::withEscapableScope(v8_isolate);
+  auto cacheable = v8_context_extensions.empty();
+  auto key = cacheable ? functionKey(body, params) : std::string();
+  auto index_it = cacheable ? m_index.find(key) : m_index.end();
+  auto cache_it = index_it != m_index.end() ? index_it->second : m_code_caches.end();
+
+  // the source takes ownership of the cached data object, but not of the buffer it points to
+  v8::ScriptCompiler::CachedData* v8_cached_data = nullptr;
+  if (cache_it != m_code_caches.end()) {
+    m_code_caches.splice(m_code_caches.begin(), m_code_caches, cache_it);
+    auto& data = cache_it->m_data;
+    v8_cached_data = new v8::ScriptCompiler::CachedData(reinterpret_cast<const uint8_t*>(data.data()),
+                                                        static_cast<int>(data.size()));
+  }
+  std::vector<v8::Local<v8::String>> v8_params;
+  v8_params.reserve(params.size());
+  for (auto& param : params) {
+    v8_params.push_back(v8x::toString(v8_isolate, param));
+  }
+  auto v8_line = v8x::toPositiveInteger(v8_isolate, -1);
+  auto v8_col = v8x::toPositiveInteger(v8_isolate, -1);
+  auto v8_origin = v8x::createScriptOrigin(v8x::toString(v8_isolate, name), v8_line, v8_col);
+  v8::ScriptCompiler::Source v8_source(v8x::toString(v8_isolate, body), v8_origin, v8_cached_data);
+  auto v8_options = v8_cached_data ? v8::ScriptCompiler::kConsumeCodeCache : v8::ScriptCompiler::kNoCompileOptions;
+
+  auto start = JSIsolateStats::Clock::now();
+  auto v8_maybe_function = v8::ScriptCompiler::CompileFunctionInContext(
+      v8_context, &v8_source, v8_params.size(), v8_params.data(), v8_context_extensions.size(),
+      v8_context_extensions.data(), v8_options);
+  JSIsolateStats::FromV8(v8_isolate)->RecordCompile(JSIsolateStats::Clock::now() - start);
+
+  v8::Local<v8::Function> v8_function;
+  if (!v8_maybe_function.ToLocal(&v8_function)) {
+    return v8::MaybeLocal<v8::Function>();
+  }
+  m_num_compiled++;
+
+  if (v8_cached_data) {
+    if (v8_source.GetCachedData()->rejected) {
+      // e.g. V8 flags changed since the cache was produced
+      m_num_cache_rejects++;
+      Erase(cache_it);
+      cache_it = m_code_caches.end();
+    } else {
+      m_num_cache_hits++;
+    }
+  }
+  if (cacheable && cache_it == m_code_caches.end()) {
+    std::unique_ptr<v8::ScriptCompiler::CachedData> v8_new_cached_data(
+        v8::ScriptCompiler::CreateCodeCacheForFunction(v8_function));
+    if (v8_new_cached_data) {
+      auto raw_data = reinterpret_cast<const char*>(v8_new_cached_data->data);
+      Insert(std::move(key), std::string(raw_data, v8_new_cached_data->length));
+    }
+  }
+
+  return v8_scope.Escape(v8_function);
+}
+
+void JSFunctionCache::Insert(std::string key, std::string data) {
+  auto size = key.size() + data.size();
+  if (size > kMaxBytes) {
+    return;
+  }
+  while (m_num_bytes + size > kMaxBytes) {
+    m_num_evictions++;
+    Erase(std::prev(m_code_caches.end()));
+  }
+  m_code_caches.push_front(CodeCache{std::move(key), std::move(data)});
+  m_index.emplace(m_code_caches.front().m_key, m_code_caches.begin());
+  m_num_bytes += size;
+}
+
+void JSFunctionCache::Erase(CodeCaches::iterator it) {
+  m_num_bytes -= it->m_key.size() + it->m_data.size();
+  m_index.erase(it->m_key);
+  m_code_caches.erase(it);
+}
+
+py::dict JSFunctionCache::GetStats() const {
+  TRACE("JSFunctionCache::GetStats {}", THIS);
+  size_t code_cache_bytes = 0;
+  for (auto& code_cache : m_code_caches) {
+    code_cache_bytes += code_cache.m_data.size();
+  }
+
+  py::dict py_result;
+  py_result["compiled"] = m_num_compiled;
+  py_result["code_caches"] = m_code_caches.size();
+  py_result["code_cache_bytes"] = code_cache_bytes;
+  py_result["code_cache_hits"] = m_num_cache_hits;
+  py_result["code_cache_rejects"] = m_num_cache_rejects;
+  py_result["code_cache_evictions"] = m_num_evictions;
+  return py_result;
+}
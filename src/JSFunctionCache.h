@@ -0,0 +1,63 @@
+#ifndef NAGA_JSFUNCTIONCACHE_H_
+#define NAGA_JSFUNCTIONCACHE_H_
+
+#include "Base.h"
+#include "V8XProtectedIsolate.h"
+
+#include <list>
+#include <string_view>
+#include <unordered_map>
+
+// JSEngine.compile_function turns a function body and parameter names into a function with
+// v8::ScriptCompiler::CompileFunctionInContext, no wrapping script is compiled or run.
+//
+// JSFunctionCache keeps V8 code caches of such functions, one per isolate, keyed by the parameter names and the body.
+// V8 checks only the source length before accepting a cache, so the key is the full source rather than a hash of it.
+// Compiling the same function again, possibly in another context, consumes the cache instead of parsing.
+// The cache is produced right after the first compilation, so it covers the eagerly compiled parts.
+//
+// Bodies are often generated, so the cache is bounded by kMaxBytes (keys and code caches), least recently used
+// entries are evicted first.
+//
+// Functions compiled with context extensions are not cached, their scopes depend on the extension objects.
+
+class JSFunctionCache {
+ public:
+  static constexpr size_t kMaxBytes = 16 * 1024 * 1024;
+
+ private:
+  struct CodeCache {
+    std::string m_key;
+    std::string m_data;
+  };
+  using CodeCaches = std::list<CodeCache>;  // most recently used first
+
+  v8x::ProtectedIsolatePtr m_v8_isolate;
+  CodeCaches m_code_caches;
+  std::unordered_map<std::string_view, CodeCaches::iterator> m_index;  // views of m_key
+  size_t m_num_bytes{0};
+
+  uint64_t m_num_compiled{0};
+  uint64_t m_num_cache_hits{0};
+  uint64_t m_num_cache_rejects{0};
+  uint64_t m_num_evictions{0};
+
+  void Insert(std::string key, std::string data);
+  void Erase(CodeCaches::iterator it);
+
+ public:
+  explicit JSFunctionCache(v8x::ProtectedIsolatePtr v8_isolate);
+  ~JSFunctionCache();
+
+  // follows V8 conventions, errors are reported as a pending JS exception and an empty result
+  v8::MaybeLocal<v8::Function> Compile(v8x::LockedIsolatePtr& v8_isolate,
+                                       v8::Local<v8::Context> v8_context,
+                                       const std::string& name,
+                                       const std::string& body,
+                                       const std::vector<std::string>& params,
+                                       std::vector<v8::Local<v8::Object>>& v8_context_extensions);
+
+  py::dict GetStats() const;
+};
+
+#endif
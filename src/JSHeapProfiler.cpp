@@ -0,0 +1,210 @@
+#include "JSHeapProfiler.h"
+#include "JSIsolate.h"
+#include "JSTracer.h"
+#include "JSException.h"
+#include "Logging.h"
+#include "Printing.h"
+#include "V8XUtils.h"
+
+#define TRACE(...) \
+  LOGGER_INDENT;   \
+  SPDLOG_LOGGER_TRACE(getLogger(kJSProfilerLogger), __VA_ARGS__)
+
+class FileOutputStream : public v8::OutputStream {
+  std::ofstream& m_file;
+
+ public:
+  explicit FileOutputStream(std::ofstream& file) : m_file(file) {}
+
+  int GetChunkSize() override { return 64 * 1024; }
+  void EndOfStream() override { m_file.flush(); }
+  WriteResult WriteAsciiChunk(char* data, int size) override {
+    m_file.write(data, size);
+    return m_file ? kContinue : kAbort;
+  }
+};
+
+class PythonObjectNode : public v8::EmbedderGraph::Node {
+  std::string m_name;
+  size_t m_size;
+
+ public:
+  explicit PythonObjectNode(TracedRawObject* raw_object)
+      : m_name(fmt::format("Naga PythonObject {}", Py_TYPE(raw_object)->tp_name)),
+        m_size(static_cast<size_t>(Py_TYPE(raw_object)->tp_basicsize)) {}
+
+  const char* Name() override { return m_name.c_str(); }
+  size_t SizeInBytes() override { return m_size; }
+};
+
+struct AllocationTotals {
+  size_t m_host{0};
+  size_t m_script{0};
+};
+
+static void collectAllocationSites(v8x::LockedIsolatePtr& v8_isolate,
+                                   v8::AllocationProfile::Node* v8_node,
+                                   const py::list& py_parent_stack,
+                                   const py::object& py_parent_script_frame,
+                                   py::list& py_sites,
+                                   AllocationTotals& totals) {
+  auto url = v8x::toStdString(v8_isolate, v8_node->script_name);
+  auto function_name = v8x::toStdString(v8_isolate, v8_node->name);
+  // only the artificial root has no parent stack
+  auto is_root = py_parent_stack.empty() && function_name == "(root)";
+
+  // every node gets its own list, py::list(py_parent_stack) would alias the parent's list
+  py::list py_stack;
+  // builtins (e.g. Array.prototype.push), natives and VM state pseudo-frames have no script,
+  // their allocations are attributed to the nearest caller which belongs to a user script
+  auto py_script_frame = py_parent_script_frame;
+  if (!is_root) {
+    py::dict py_frame;
+    py_frame["function"] = function_name.empty() ? "(anonymous)" : function_name;
+    py_frame["url"] = url;
+    // positions are one-based, zero means unknown
+    py_frame["line"] = v8_node->line_number;
+    py_frame["column"] = v8_node->column_number;
+    py_stack.append(py_frame);
+    if (v8_node->script_id != v8::UnboundScript::kNoScriptId) {
+      py_script_frame = py_frame;
+    }
+  }
+  for (auto py_parent_frame : py_parent_stack) {
+    py_stack.append(py_parent_frame);
+  }
+
+  size_t size = 0;
+  size_t count = 0;
+  for (auto& allocation : v8_node->allocations) {
+    size += allocation.size * allocation.count;
+    count += allocation.count;
+  }
+  if (count > 0) {
+    // without any user script frame on the stack the allocation was made by the host, e.g. under "(V8 API)"
+    auto host = py_script_frame.is_none();
+    py::dict py_site;
+    py_site["stack"] = py_stack;
+    py_site["size"] = size;
+    py_site["count"] = count;
+    py_site["origin"] = host ? "host" : "script";
+    py_site["script_frame"] = py_script_frame;
+    py_sites.append(py_site);
+    (host ? totals.m_host : totals.m_script) += size;
+  }
+
+  for (auto v8_child : v8_node->children) {
+    collectAllocationSites(v8_isolate, v8_child, py_stack, py_script_frame, py_sites, totals);
+  }
+}
+
+JSHeapProfiler::JSHeapProfiler(v8x::ProtectedIsolatePtr v8_protected_isolate) : m_v8_isolate(v8_protected_isolate) {
+  TRACE("JSHeapProfiler::JSHeapProfiler {} v8_isolate={}", THIS, m_v8_isolate);
+  auto v8_isolate = m_v8_isolate.giveMeRawIsolateAndTrustMe();
+  v8_isolate->GetHeapProfiler()->AddBuildEmbedderGraphCallback(BuildEmbedderGraph, this);
+}
+
+JSHeapProfiler::~JSHeapProfiler() {
+  TRACE("JSHeapProfiler::~JSHeapProfiler {}", THIS);
+  auto v8_isolate = m_v8_isolate.giveMeRawIsolateAndTrustMe();
+  v8_isolate->GetHeapProfiler()->RemoveBuildEmbedderGraphCallback(BuildEmbedderGraph, this);
+}
+
+void JSHeapProfiler::BuildEmbedderGraph(v8::Isolate* v8_isolate, v8::EmbedderGraph* v8_graph, void* /* data */) {
+  TRACE("JSHeapProfiler::BuildEmbedderGraph v8_isolate={}", P$(v8_isolate));
+  auto isolate = JSIsolate::FromV8(v8_isolate);
+  auto v8_scope = v8::HandleScope(v8_isolate);
+  for (auto& [raw_object, record] : isolate->Tracer().Wrappers()) {
+    auto v8_wrapper = record.m_v8_wrapper.Get(v8_isolate);
+    if (v8_wrapper.IsEmpty()) {
+      continue;
+    }
+    auto v8_wrapper_node = v8_graph->V8Node(v8_wrapper);
+    auto python_node = v8_graph->AddNode(std::make_unique<PythonObjectNode>(raw_object));
+    if (record.m_weak_ref) {
+      // zombie mode, the wrapper is kept alive for the Python object
+      v8_graph->AddEdge(python_node, v8_wrapper_node, "naga.Tracer");
+    } else {
+      // live mode, the Python object is kept alive for the wrapper
+      v8_graph->AddEdge(v8_wrapper_node, python_node, "naga.Tracer");
+    }
+  }
+}
+
+void JSHeapProfiler::StartSampling(uint64_t sample_interval, int stack_depth, bool include_collected) {
+  TRACE("JSHeapProfiler::StartSampling {} sample_interval={} stack_depth={} include_collected={}", THIS,
+        sample_interval, stack_depth, include_collected);
+  auto v8_isolate = m_v8_isolate.lock();
+  if (m_sampling) {
+    throw JSException(v8_isolate, "Sampling heap profiler is already running");
+  }
+  auto v8_flags = include_collected ? v8::HeapProfiler::kSamplingIncludeObjectsCollectedByMajorGC |
+                                          v8::HeapProfiler::kSamplingIncludeObjectsCollectedByMinorGC
+                                    : v8::HeapProfiler::kSamplingNoFlags;
+  auto v8_heap_profiler = v8_isolate->GetHeapProfiler();
+  if (!v8_heap_profiler->StartSamplingHeapProfiler(sample_interval, stack_depth,
+                                                   static_cast<v8::HeapProfiler::SamplingFlags>(v8_flags))) {
+    throw JSException(v8_isolate, "Unable to start sampling heap profiler");
+  }
+  m_sampling = true;
+}
+
+py::dict JSHeapProfiler::GetAllocationReport() {
+  TRACE("JSHeapProfiler::GetAllocationReport {}", THIS);
+  auto v8_isolate = m_v8_isolate.lock();
+  auto v8_scope = v8x::withScope(v8_isolate);
+  if (!m_sampling) {
+    throw JSException(v8_isolate, "Sampling heap profiler is not running");
+  }
+
+  std::unique_ptr<v8::AllocationProfile> v8_profile(v8_isolate->GetHeapProfiler()->GetAllocationProfile());
+  if (!v8_profile) {
+    throw JSException(v8_isolate, "Unable to get allocation profile");
+  }
+
+  py::list py_sites;
+  AllocationTotals totals;
+  collectAllocationSites(v8_isolate, v8_profile->GetRootNode(), py::list(), py::none(), py_sites, totals);
+  py_sites.attr("sort")(py::arg("key") = py::module::import("operator").attr("itemgetter")("size"),
+                        py::arg("reverse") = true);
+
+  py::dict py_totals;
+  py_totals["host"] = totals.m_host;
+  py_totals["script"] = totals.m_script;
+  py::dict py_result;
+  py_result["sites"] = py_sites;
+  py_result["totals"] = py_totals;
+  return py_result;
+}
+
+py::dict JSHeapProfiler::StopSampling() {
+  TRACE("JSHeapProfiler::StopSampling {}", THIS);
+  auto py_result = GetAllocationReport();
+  auto v8_isolate = m_v8_isolate.lock();
+  v8_isolate->GetHeapProfiler()->StopSamplingHeapProfiler();
+  m_sampling = false;
+  return py_result;
+}
+
+void JSHeapProfiler::WriteHeapSnapshot(const std::string& path) {
+  TRACE("JSHeapProfiler::WriteHeapSnapshot {} path={}", THIS, path);
+  std::ofstream file(path, std::ios::out | std::ios::trunc | std::ios::binary);
+  if (!file) {
+    throw JSException(m_v8_isolate, fmt::format("Unable to write heap snapshot to '{}'", path), PyExc_OSError);
+  }
+
+  auto v8_isolate = m_v8_isolate.lock();
+  auto v8_scope = v8x::withScope(v8_isolate);
+  auto v8_heap_profiler = v8_isolate->GetHeapProfiler();
+
+  // note that we keep holding the GIL, BuildEmbedderGraph walks tracer records which are also touched by Python
+  // weak reference callbacks
+  auto v8_snapshot = v8_heap_profiler->TakeHeapSnapshot();
+  FileOutputStream stream(file);
+  v8_snapshot->Serialize(&stream, v8::HeapSnapshot::kJSON);
+  const_cast<v8::HeapSnapshot*>(v8_snapshot)->Delete();
+
+  if (!file) {
+    throw JSException(m_v8_isolate, fmt::format("Unable to write heap snapshot to '{}'", path), PyExc_OSError);
+  }
+}
@@ -0,0 +1,43 @@
+#ifndef NAGA_JSHEAPPROFILER_H_
+#define NAGA_JSHEAPPROFILER_H_
+
+#include "Base.h"
+#include "V8XProtectedIsolate.h"
+
+// JSHeapProfiler takes heap snapshots of one isolate, see JSIsolate::WriteHeapSnapshot.
+//
+// Snapshots are streamed into a file chunk by chunk, so we never hold the whole JSON in memory.
+//
+// V8 already labels objects held by our v8::Global handles with names given to AnnotateStrongRetainer
+// (e.g. "Naga JSObject", "Naga JSContext"). Python objects exposed to JS are invisible to V8 though, so we
+// contribute an embedder graph: each Python object traced by JSTracer becomes a "Naga PythonObject <type>" node
+// connected to its JS wrapper by a "naga.Tracer" edge. In live mode the wrapper retains the Python object,
+// in zombie mode it is the other way around.
+//
+// For cheap continuous monitoring there is also V8's sampling heap profiler. It samples roughly one allocation per
+// sample_interval bytes and records the JS stack (up to stack_depth frames) at the allocation site.
+// The report groups samples per call site. Each site is attributed to the nearest frame belonging to a user script
+// (reported as "script_frame"), so allocations in builtins or natives count for the script calling them rather than
+// for whatever happens to be the leaf frame. Sites without any user script frame on the stack can only come from
+// the host, e.g. from our wrap() or v8x::toString() conversions of values passed in from Python, such call sites are
+// reported with origin "host", the rest with origin "script". Note that conversions done inside a Python function
+// called from JS are attributed to the JS call site, V8 does not record API callback frames.
+
+class JSHeapProfiler {
+  v8x::ProtectedIsolatePtr m_v8_isolate;
+  bool m_sampling{false};
+
+  static void BuildEmbedderGraph(v8::Isolate* v8_isolate, v8::EmbedderGraph* v8_graph, void* data);
+
+ public:
+  explicit JSHeapProfiler(v8x::ProtectedIsolatePtr v8_protected_isolate);
+  ~JSHeapProfiler();
+
+  void WriteHeapSnapshot(const std::string& path);
+
+  void StartSampling(uint64_t sample_interval, int stack_depth, bool include_collected);
+  py::dict GetAllocationReport();
+  py::dict StopSampling();
+};
+
+#endif
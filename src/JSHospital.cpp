@@ -71,3 +71,7 @@ void JSHospital::UnplugPatient(HospitalRecord* record) {
 
   delete record;
 }
+
+size_t JSHospital::NumberOfPatients() const {
+  return m_records.size();
+}
@@ -3,6 +3,7 @@
 
 #include "Base.h"
 #include "V8XProtectedIsolate.h"
+#include "V8XUtils.h"
 
 // JSHospital is a place where we put V8 objects which have attached some external data which need some cleanup.
 
@@ -23,6 +24,7 @@ struct HospitalRecord {
 
   HospitalRecord(v8::Local<v8::Object> v8_patient, PatientClenupFn cleanup_fn) : m_cleanup_fn(cleanup_fn) {
     m_v8_patient.Reset(v8_patient->GetIsolate(), v8_patient);
+    m_v8_patient.SetWrapperClassId(v8x::kHospitalPatientHandle);
   }
 };
 
@@ -40,6 +42,7 @@ class JSHospital {
 
   void AcceptPatient(v8::Local<v8::Object> v8_patient, PatientClenupFn cleanup_fn);
   void PatientIsAboutToDie(v8::Isolate* v8_isolate, HospitalRecord* record);
+  size_t NumberOfPatients() const;
 
  protected:
   void UnplugPatient(HospitalRecord* record);
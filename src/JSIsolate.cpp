@@ -2,8 +2,17 @@
 #include "JSTracer.h"
 #include "JSHospital.h"
 #include "JSEternals.h"
+#include "JSIsolateStats.h"
+#include "JSBoundaryProfiler.h"
+#include "JSCpuProfiler.h"
+#include "JSHeapProfiler.h"
+#include "JSMessageChannel.h"
+#include "JSModuleMap.h"
+#include "JSFunctionCache.h"
+#include "JSPlatform.h"
 #include "JSStackTrace.h"
 #include "JSContext.h"
+#include "JSSharedBuffer.h"
 #include "JSException.h"
 #include "JSIsolateRegistry.h"
 #include "Logging.h"
@@ -28,15 +37,49 @@ v8x::LockedIsolatePtr JSIsolate::ToV8() {
   return m_locker_holder.GetLockedIsolate();
 }
 
-JSIsolate::JSIsolate()
-    : m_v8_isolate(v8x::createIsolate()),
+static v8::ResourceConstraints createResourceConstraints(size_t max_old_space,
+                                                         size_t max_young_space,
+                                                         size_t initial_heap) {
+  v8::ResourceConstraints v8_constraints;
+  if (max_old_space) {
+    v8_constraints.set_max_old_generation_size_in_bytes(max_old_space);
+  }
+  if (max_young_space) {
+    v8_constraints.set_max_young_generation_size_in_bytes(max_young_space);
+  }
+  if (initial_heap) {
+    v8_constraints.set_initial_old_generation_size_in_bytes(initial_heap);
+  }
+  return v8_constraints;
+}
+
+JSIsolate::JSIsolate(size_t max_old_space, size_t max_young_space, size_t initial_heap)
+    : m_v8_isolate(v8x::createIsolate(createResourceConstraints(max_old_space, max_young_space, initial_heap))),
       m_tracer(std::make_unique<decltype(m_tracer)::element_type>()),
       m_hospital(std::make_unique<decltype(m_hospital)::element_type>(m_v8_isolate)),
       m_eternals(std::make_unique<decltype(m_eternals)::element_type>(m_v8_isolate)),
+      m_stats(std::make_unique<decltype(m_stats)::element_type>(m_v8_isolate)),
+      m_boundary_profiler(std::make_unique<decltype(m_boundary_profiler)::element_type>(m_v8_isolate)),
+      m_cpu_profiler(std::make_unique<decltype(m_cpu_profiler)::element_type>(m_v8_isolate)),
+      m_heap_profiler(std::make_unique<decltype(m_heap_profiler)::element_type>(m_v8_isolate)),
+      m_mailbox(std::make_shared<decltype(m_mailbox)::element_type>(
+          m_v8_isolate,
+          JSPlatform::Instance()->GetForegroundTaskRunner(m_v8_isolate.giveMeRawIsolateAndTrustMe()))),
+      m_modules(std::make_unique<decltype(m_modules)::element_type>(m_v8_isolate)),
+      m_functions(std::make_unique<decltype(m_functions)::element_type>(m_v8_isolate)),
       m_locker_holder(m_v8_isolate.giveMeRawIsolateAndTrustMe()),
-      m_exposed_locker_level(0) {
-  TRACE("JSIsolate::JSIsolate {}", THIS);
+      m_event_loop(py::none()),
+      m_out_of_memory(false),
+      m_timed_out(false) {
+  TRACE("JSIsolate::JSIsolate {} max_old_space={} max_young_space={} initial_heap={}", THIS, max_old_space,
+        max_young_space, initial_heap);
   registerIsolate(m_v8_isolate, this);
+  m_v8_isolate.giveMeRawIsolateAndTrustMe()->AddNearHeapLimitCallback(NearHeapLimitCallback, this);
+  m_v8_isolate.giveMeRawIsolateAndTrustMe()->SetAtomicsWaitCallback(JSSharedBuffer::AtomicsWaitCallback, nullptr);
+  m_v8_isolate.giveMeRawIsolateAndTrustMe()->SetHostImportModuleDynamicallyCallback(
+      JSModuleMap::ImportModuleDynamicallyCallback);
+  m_v8_isolate.giveMeRawIsolateAndTrustMe()->SetHostInitializeImportMetaObjectCallback(
+      JSModuleMap::InitializeImportMetaCallback);
 }
 
 JSIsolate::~JSIsolate() {
@@ -50,9 +93,26 @@ JSIsolate::~JSIsolate() {
 
   m_eternals.reset();
 
+  m_boundary_profiler.reset();
+
+  m_cpu_profiler.reset();
+
+  m_heap_profiler.reset();
+
+  m_modules.reset();
+
+  m_functions.reset();
+
+  // senders may still hold the mailbox for a moment, but its ports and queued messages are gone after Close
+  m_mailbox->Close();
+  m_mailbox.reset();
+
+  // stats live in the isolate data slot, teardowns above may still convert values (see wrap) and record into them
+  m_stats.reset();
+
   unregisterIsolate(m_v8_isolate);
 
-  assert(m_exposed_locker_level == 0);  // someone forgot to call unlock
+  assert(m_exposed_lockers.empty());  // someone forgot to call unlock
 
   // This is interesting v8::Isolate::Dispose is documented to be used
   // under a lock but V8 asserts in debug mode.
@@ -82,6 +142,26 @@ JSEternals& JSIsolate::Eternals() const {
   return *m_eternals.get();
 }
 
+JSIsolateStats& JSIsolate::Stats() const {
+  TRACE("JSIsolate::Stats {} => {}", THIS, (void*)m_stats.get());
+  return *m_stats.get();
+}
+
+const std::shared_ptr<JSMailbox>& JSIsolate::Mailbox() const {
+  TRACE("JSIsolate::Mailbox {} => {}", THIS, (void*)m_mailbox.get());
+  return m_mailbox;
+}
+
+JSModuleMap& JSIsolate::Modules() const {
+  TRACE("JSIsolate::Modules {} => {}", THIS, (void*)m_modules.get());
+  return *m_modules.get();
+}
+
+JSFunctionCache& JSIsolate::Functions() const {
+  TRACE("JSIsolate::Functions {} => {}", THIS, (void*)m_functions.get());
+  return *m_functions.get();
+}
+
 SharedJSStackTracePtr JSIsolate::GetCurrentStackTrace(int frame_limit,
                                                       v8::StackTrace::StackTraceOptions v8_options) const {
   TRACE("JSIsolate::GetCurrentStackTrace {} frame_limit={} v8_options={:#x}", THIS, frame_limit, v8_options);
@@ -151,53 +231,248 @@ py::bool_ JSIsolate::InContext() const {
   return py_result;
 }
 
+JSIsolate::ExposedLocker& JSIsolate::GetExposedLocker() {
+  // references into unordered_map stay valid when other threads insert their entries
+  std::lock_guard<std::mutex> lock(m_exposed_lockers_mutex);
+  return m_exposed_lockers[std::this_thread::get_id()];
+}
+
+void JSIsolate::ReleaseExposedLocker(ExposedLocker& exposed_locker) {
+  exposed_locker.m_locker = nullptr;
+  if (exposed_locker.m_level == 0 && exposed_locker.m_levels.empty()) {
+    std::lock_guard<std::mutex> lock(m_exposed_lockers_mutex);
+    m_exposed_lockers.erase(std::this_thread::get_id());
+  }
+}
+
 // TODO: do not assert below, throw python runtime errors
 void JSIsolate::Lock() {
-  TRACE("JSIsolate::Lock {} m_exposed_locker_level={}", THIS, m_exposed_locker_level);
-  assert(m_exposed_locker_level >= 0);
-  if (m_exposed_locker_level == 0) {
-    m_exposed_locker = m_locker_holder.CreateOrShareLocker();
+  auto& exposed_locker = GetExposedLocker();
+  TRACE("JSIsolate::Lock {} level={}", THIS, exposed_locker.m_level);
+  assert(exposed_locker.m_level >= 0);
+  if (exposed_locker.m_level == 0) {
+    exposed_locker.m_locker = m_locker_holder.CreateOrShareLocker();
   }
-  m_exposed_locker_level++;
+  exposed_locker.m_level++;
 }
 
 void JSIsolate::Unlock() {
-  TRACE("JSIsolate::Unlock {} m_exposed_locker_level={}", THIS, m_exposed_locker_level);
-  assert(m_exposed_locker_level > 0);
-  m_exposed_locker_level--;
-  if (m_exposed_locker_level == 0) {
-    m_exposed_locker = nullptr;
+  auto& exposed_locker = GetExposedLocker();
+  TRACE("JSIsolate::Unlock {} level={}", THIS, exposed_locker.m_level);
+  assert(exposed_locker.m_level > 0);
+  exposed_locker.m_level--;
+  if (exposed_locker.m_level == 0) {
+    ReleaseExposedLocker(exposed_locker);
   }
 }
 
 void JSIsolate::UnlockAll() {
-  TRACE("JSIsolate::UnlockAll {} m_exposed_locker_level={}", THIS, m_exposed_locker_level);
-  assert(m_exposed_locker_level >= 0);
-  m_exposed_locker_levels.push(m_exposed_locker_level);
-  m_exposed_locker_level = 0;
-  m_exposed_locker = nullptr;
+  auto& exposed_locker = GetExposedLocker();
+  TRACE("JSIsolate::UnlockAll {} level={}", THIS, exposed_locker.m_level);
+  assert(exposed_locker.m_level >= 0);
+  exposed_locker.m_levels.push(exposed_locker.m_level);
+  exposed_locker.m_level = 0;
+  exposed_locker.m_locker = nullptr;
 }
 
 void JSIsolate::RelockAll() {
-  assert(m_exposed_locker_level == 0);
-  TRACE("JSIsolate::RelockAll {} m_exposed_locker_level={}", THIS, m_exposed_locker_level);
-  assert(m_exposed_locker_levels.size() > 0);
-  m_exposed_locker_level = m_exposed_locker_levels.top();
-  m_exposed_locker_levels.pop();
-  if (m_exposed_locker_level > 0) {
-    m_exposed_locker = m_locker_holder.CreateOrShareLocker();
+  auto& exposed_locker = GetExposedLocker();
+  assert(exposed_locker.m_level == 0);
+  TRACE("JSIsolate::RelockAll {} level={}", THIS, exposed_locker.m_level);
+  assert(exposed_locker.m_levels.size() > 0);
+  exposed_locker.m_level = exposed_locker.m_levels.top();
+  exposed_locker.m_levels.pop();
+  if (exposed_locker.m_level > 0) {
+    exposed_locker.m_locker = m_locker_holder.CreateOrShareLocker();
+  } else {
+    ReleaseExposedLocker(exposed_locker);
   }
 }
 
 int JSIsolate::LockLevel() const {
-  return m_exposed_locker_level;
+  std::lock_guard<std::mutex> lock(m_exposed_lockers_mutex);
+  auto it = m_exposed_lockers.find(std::this_thread::get_id());
+  if (it == m_exposed_lockers.end()) {
+    return 0;
+  }
+  return it->second.m_level;
+}
+
+py::object JSIsolate::GetEventLoop() const {
+  TRACE("JSIsolate::GetEventLoop {} => {}", THIS, m_event_loop);
+  return m_event_loop;
+}
+
+void JSIsolate::SetEventLoop(py::object py_loop) {
+  TRACE("JSIsolate::SetEventLoop {} py_loop={}", THIS, py_loop);
+  m_event_loop = std::move(py_loop);
 }
 
 bool JSIsolate::Locked() const {
   // this returns V8's opinion about locked state
-  // please understand that the isolate could be locked because of m_exposed_locker (someone called JSIsolate.lock from
+  // please understand that the isolate could be locked because of m_exposed_lockers (someone called JSIsolate.lock from
   // Python) or because some C++ code holds the lock themselves and this function happens to be called at that point.
   auto result = v8::Locker::IsLocked(m_v8_isolate.giveMeRawIsolateAndTrustMe());
   TRACE("JSIsolate::Locked {} => {}", THIS, result);
   return result;
 }
+
+size_t JSIsolate::NearHeapLimitCallback(void* data, size_t current_heap_limit, size_t initial_heap_limit) {
+  auto isolate = static_cast<JSIsolate*>(data);
+  TRACE("JSIsolate::NearHeapLimitCallback {} current_heap_limit={} initial_heap_limit={}", (void*)isolate,
+        current_heap_limit, initial_heap_limit);
+  // we are called by V8 from inside of an allocation on the thread holding the isolate lock
+  isolate->m_v8_isolate.giveMeRawIsolateAndTrustMe()->TerminateExecution();
+  if (isolate->m_out_of_memory) {
+    // the headroom was granted already, growing the heap again on each call would make the limit meaningless
+    return current_heap_limit;
+  }
+  SPDLOG_WARN("isolate {} reached its heap limit of {} bytes, terminating execution", (void*)isolate,
+              current_heap_limit);
+  isolate->m_out_of_memory = true;
+  // V8 needs some headroom to unwind the stack after termination, otherwise it would abort on the very next allocation
+  return current_heap_limit + current_heap_limit / 2;
+}
+
+bool JSIsolate::OutOfMemory() const {
+  return m_out_of_memory;
+}
+
+void JSIsolate::CheckOutOfMemory() const {
+  if (m_out_of_memory) {
+    throw TerminationError();
+  }
+}
+
+JSException JSIsolate::TerminationError() const {
+  if (m_out_of_memory) {
+    return JSException(m_v8_isolate, "JS heap limit reached, the isolate has to be disposed", PyExc_MemoryError);
+  }
+  if (m_timed_out) {
+    return JSException(m_v8_isolate, "JS execution timed out", PyExc_TimeoutError);
+  }
+  return JSException(m_v8_isolate, "JS execution was terminated", PyExc_RuntimeError);
+}
+
+void JSIsolate::TerminateOnTimeout() {
+  TRACE("JSIsolate::TerminateOnTimeout {}", THIS);
+  // called from the watchdog thread, TerminateExecution does not require the isolate lock
+  m_timed_out = true;
+  m_v8_isolate.giveMeRawIsolateAndTrustMe()->TerminateExecution();
+}
+
+void JSIsolate::CancelTerminationOnTimeout() {
+  TRACE("JSIsolate::CancelTerminationOnTimeout {}", THIS);
+  m_v8_isolate.giveMeRawIsolateAndTrustMe()->CancelTerminateExecution();
+  m_timed_out = false;
+}
+
+void JSIsolate::EnableTimeSlicing(double quantum) {
+  TRACE("JSIsolate::EnableTimeSlicing {} quantum={}", THIS, quantum);
+  m_locker_holder.GetTimeSlicer().Enable(quantum);
+}
+
+void JSIsolate::DisableTimeSlicing() {
+  TRACE("JSIsolate::DisableTimeSlicing {}", THIS);
+  m_locker_holder.GetTimeSlicer().Disable();
+}
+
+bool JSIsolate::TimeSlicingEnabled() {
+  return m_locker_holder.GetTimeSlicer().Enabled();
+}
+
+py::dict JSIsolate::GetTimeSlicingStats() {
+  return m_locker_holder.GetTimeSlicer().GetStats();
+}
+
+py::dict JSIsolate::GetStats() const {
+  TRACE("JSIsolate::GetStats {}", THIS);
+  return m_stats->GetStats();
+}
+
+py::dict JSIsolate::GetMessageStats() const {
+  TRACE("JSIsolate::GetMessageStats {}", THIS);
+  return m_mailbox->GetStats();
+}
+
+void JSIsolate::SetModuleResolver(py::object py_resolve, py::object py_load) {
+  TRACE("JSIsolate::SetModuleResolver {} py_resolve={} py_load={}", THIS, py_resolve, py_load);
+  if (py_resolve.is_none() && py_load.is_none()) {
+    m_modules->SetResolver(nullptr);
+    return;
+  }
+  m_modules->SetResolver(std::make_unique<PythonModuleResolver>(std::move(py_resolve), std::move(py_load)));
+}
+
+py::dict JSIsolate::GetModuleStats() const {
+  TRACE("JSIsolate::GetModuleStats {}", THIS);
+  return m_modules->GetStats();
+}
+
+py::dict JSIsolate::GetFunctionCacheStats() const {
+  TRACE("JSIsolate::GetFunctionCacheStats {}", THIS);
+  return m_functions->GetStats();
+}
+
+void JSIsolate::EnableBoundaryProfiler(uint32_t sample_every) {
+  TRACE("JSIsolate::EnableBoundaryProfiler {} sample_every={}", THIS, sample_every);
+  auto v8_isolate = m_v8_isolate.lock();
+  m_boundary_profiler->Enable(sample_every);
+}
+
+void JSIsolate::DisableBoundaryProfiler() {
+  TRACE("JSIsolate::DisableBoundaryProfiler {}", THIS);
+  auto v8_isolate = m_v8_isolate.lock();
+  m_boundary_profiler->Disable();
+}
+
+py::dict JSIsolate::GetBoundaryProfile() const {
+  TRACE("JSIsolate::GetBoundaryProfile {}", THIS);
+  auto v8_isolate = m_v8_isolate.lock();
+  return m_boundary_profiler->GetProfile();
+}
+
+std::string JSIsolate::GetBoundaryProfileFolded() const {
+  TRACE("JSIsolate::GetBoundaryProfileFolded {}", THIS);
+  auto v8_isolate = m_v8_isolate.lock();
+  return m_boundary_profiler->GetFoldedProfile();
+}
+
+void JSIsolate::StartCpuProfile(const std::string& name, int sampling_interval_us) {
+  TRACE("JSIsolate::StartCpuProfile {} name={} sampling_interval_us={}", THIS, name, sampling_interval_us);
+  m_cpu_profiler->Start(name, sampling_interval_us);
+}
+
+std::string JSIsolate::StopCpuProfile(const std::string& name, const std::string& format, const std::string& path) {
+  TRACE("JSIsolate::StopCpuProfile {} name={} format={} path={}", THIS, name, format, path);
+  auto result = m_cpu_profiler->Stop(name, format);
+  if (!path.empty()) {
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    if (!file) {
+      throw JSException(m_v8_isolate, fmt::format("Unable to write CPU profile to '{}'", path), PyExc_OSError);
+    }
+    file << result;
+  }
+  return result;
+}
+
+void JSIsolate::WriteHeapSnapshot(const std::string& path) {
+  TRACE("JSIsolate::WriteHeapSnapshot {} path={}", THIS, path);
+  m_heap_profiler->WriteHeapSnapshot(path);
+}
+
+void JSIsolate::StartSamplingHeapProfiler(uint64_t sample_interval, int stack_depth, bool include_collected) {
+  TRACE("JSIsolate::StartSamplingHeapProfiler {} sample_interval={} stack_depth={}", THIS, sample_interval,
+        stack_depth);
+  m_heap_profiler->StartSampling(sample_interval, stack_depth, include_collected);
+}
+
+py::dict JSIsolate::GetAllocationReport() {
+  TRACE("JSIsolate::GetAllocationReport {}", THIS);
+  return m_heap_profiler->GetAllocationReport();
+}
+
+py::dict JSIsolate::StopSamplingHeapProfiler() {
+  TRACE("JSIsolate::StopSamplingHeapProfiler {}", THIS);
+  return m_heap_profiler->StopSampling();
+}
@@ -6,6 +6,11 @@
 #include "V8XLockedIsolate.h"
 #include "V8XIsolateLockerHolder.h"
 
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
 // JSIsolate is our wrapper of v8::Isolate which provides Python interface for exposed JSIsolate object.
 //
 // JSIsolate instances are typically created from Python side by calling exposed JSIsolate().
@@ -22,25 +27,59 @@
 // by pybind and JSIsolatePtr in our codebase in C++). So for V8 isolate to be let go all users have to drop
 // reference to its JSIsolate wrapper which will call JSIsolate destructor which will dispose all resources and
 // finally dispose the isolate in V8.
+//
+// Heap limits can be passed to the constructor (in bytes, zero means V8 default). When the heap gets near its limit
+// we terminate running JS code (see nearHeapLimitCallback) and raise MemoryError instead of letting V8 abort the whole
+// process. Such isolate is considered out of memory for the rest of its life and refuses to run any more scripts,
+// the caller is expected to drop it and create a fresh one.
+//
+// Evaluation deadlines are enforced by JSWatchdog which calls TerminateOnTimeout from its own thread. Unlike the out
+// of memory case, the termination gets cancelled after the timed out call has unwound and the isolate stays usable.
 
 class JSIsolate : public std::enable_shared_from_this<JSIsolate> {
   using LockerLevelStack = std::stack<int>;
+
+  // state behind JSIsolate.lock/unlock, each thread has its own
+  struct ExposedLocker {
+    v8x::SharedIsolateLockerPtr m_locker;
+    int m_level{0};
+    LockerLevelStack m_levels;
+  };
+  using ExposedLockers = std::unordered_map<std::thread::id, ExposedLocker>;
+
   v8x::ProtectedIsolatePtr m_v8_isolate;
   std::unique_ptr<JSTracer> m_tracer;
   std::unique_ptr<JSHospital> m_hospital;
   std::unique_ptr<JSEternals> m_eternals;
+  std::unique_ptr<JSIsolateStats> m_stats;
+  std::unique_ptr<JSBoundaryProfiler> m_boundary_profiler;
+  std::unique_ptr<JSCpuProfiler> m_cpu_profiler;
+  std::unique_ptr<JSHeapProfiler> m_heap_profiler;
+  std::shared_ptr<JSMailbox> m_mailbox;
+  std::unique_ptr<JSModuleMap> m_modules;
+  std::unique_ptr<JSFunctionCache> m_functions;
   v8x::IsolateLockerHolder m_locker_holder;
-  v8x::SharedIsolateLockerPtr m_exposed_locker;
-  int m_exposed_locker_level;
-  LockerLevelStack m_exposed_locker_levels;
+  mutable std::mutex m_exposed_lockers_mutex;
+  ExposedLockers m_exposed_lockers;
+  py::object m_event_loop;
+  bool m_out_of_memory;
+  std::atomic<bool> m_timed_out;
+
+  ExposedLocker& GetExposedLocker();
+  void ReleaseExposedLocker(ExposedLocker& exposed_locker);
+  static size_t NearHeapLimitCallback(void* data, size_t current_heap_limit, size_t initial_heap_limit);
 
  public:
-  JSIsolate();
+  explicit JSIsolate(size_t max_old_space = 0, size_t max_young_space = 0, size_t initial_heap = 0);
   ~JSIsolate();
 
   JSTracer& Tracer() const;
   JSHospital& Hospital() const;
   JSEternals& Eternals() const;
+  JSIsolateStats& Stats() const;
+  const std::shared_ptr<JSMailbox>& Mailbox() const;
+  JSModuleMap& Modules() const;
+  JSFunctionCache& Functions() const;
 
   static SharedJSIsolatePtr FromV8(v8::Isolate* v8_isolate);
   [[nodiscard]] v8x::LockedIsolatePtr ToV8();
@@ -64,6 +103,40 @@ class JSIsolate : public std::enable_shared_from_this<JSIsolate> {
   py::object GetEnteredOrMicrotaskContext() const;
   py::object GetCurrentContext() const;
   py::bool_ InContext() const;
+
+  py::object GetEventLoop() const;
+  void SetEventLoop(py::object py_loop);
+
+  bool OutOfMemory() const;
+  void CheckOutOfMemory() const;
+  [[nodiscard]] JSException TerminationError() const;
+
+  void TerminateOnTimeout();
+  void CancelTerminationOnTimeout();
+
+  void EnableTimeSlicing(double quantum);
+  void DisableTimeSlicing();
+  bool TimeSlicingEnabled();
+  py::dict GetTimeSlicingStats();
+
+  py::dict GetStats() const;
+  py::dict GetMessageStats() const;
+
+  void SetModuleResolver(py::object py_resolve, py::object py_load);
+  py::dict GetModuleStats() const;
+  py::dict GetFunctionCacheStats() const;
+
+  void EnableBoundaryProfiler(uint32_t sample_every);
+  void DisableBoundaryProfiler();
+  py::dict GetBoundaryProfile() const;
+  std::string GetBoundaryProfileFolded() const;
+
+  void StartCpuProfile(const std::string& name, int sampling_interval_us);
+  std::string StopCpuProfile(const std::string& name, const std::string& format, const std::string& path);
+  void WriteHeapSnapshot(const std::string& path);
+  void StartSamplingHeapProfiler(uint64_t sample_interval, int stack_depth, bool include_collected);
+  py::dict GetAllocationReport();
+  py::dict StopSamplingHeapProfiler();
 };
 
 #endif
\ No newline at end of file
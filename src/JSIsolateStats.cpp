@@ -0,0 +1,159 @@
+#include "JSIsolateStats.h"
+#include "Logging.h"
+#include "Printing.h"
+
+#include <algorithm>
+
+#define TRACE(...) \
+  LOGGER_INDENT;   \
+  SPDLOG_LOGGER_TRACE(getLogger(kJSIsolateLogger), __VA_ARGS__)
+
+static std::optional<JSIsolateStats::GCKind> lookupGCKind(v8::GCType v8_type) {
+  switch (v8_type) {
+    case v8::kGCTypeScavenge:
+      return JSIsolateStats::kScavenge;
+    case v8::kGCTypeMinorMarkCompact:
+      return JSIsolateStats::kMinorMarkCompact;
+    case v8::kGCTypeMarkSweepCompact:
+      return JSIsolateStats::kMarkSweepCompact;
+    case v8::kGCTypeIncrementalMarking:
+      return JSIsolateStats::kIncrementalMarking;
+    case v8::kGCTypeProcessWeakCallbacks:
+      return JSIsolateStats::kWeakCallbacks;
+    default:
+      return std::nullopt;
+  }
+}
+
+static const char* gcKindName(size_t kind) {
+  static const char* g_names[] = {"scavenge", "minor_mark_compact", "mark_sweep_compact", "incremental_marking",
+                                  "weak_callbacks"};
+  static_assert(std::size(g_names) == JSIsolateStats::kNumGCKinds);
+  return g_names[kind];
+}
+
+static double toSeconds(JSIsolateStats::Clock::duration duration) {
+  return std::chrono::duration<double>(duration).count();
+}
+
+static py::dict timeRecordToDict(const JSIsolateStats::TimeRecord& record) {
+  py::dict py_result;
+  py_result["count"] = record.m_count;
+  py_result["time"] = toSeconds(record.m_total_time);
+  return py_result;
+}
+
+JSIsolateStats::JSIsolateStats(v8x::ProtectedIsolatePtr v8_protected_isolate) : m_v8_isolate(v8_protected_isolate) {
+  TRACE("JSIsolateStats::JSIsolateStats {} v8_isolate={}", THIS, m_v8_isolate);
+  auto v8_isolate = m_v8_isolate.giveMeRawIsolateAndTrustMe();
+  v8_isolate->SetData(kIsolateDataSlot, this);
+  v8_isolate->AddGCPrologueCallback(GCPrologueCallback, this);
+  v8_isolate->AddGCEpilogueCallback(GCEpilogueCallback, this);
+}
+
+JSIsolateStats::~JSIsolateStats() {
+  TRACE("JSIsolateStats::~JSIsolateStats {}", THIS);
+  auto v8_isolate = m_v8_isolate.giveMeRawIsolateAndTrustMe();
+  v8_isolate->RemoveGCPrologueCallback(GCPrologueCallback, this);
+  v8_isolate->RemoveGCEpilogueCallback(GCEpilogueCallback, this);
+  v8_isolate->SetData(kIsolateDataSlot, nullptr);
+}
+
+void JSIsolateStats::GCPrologueCallback(v8::Isolate* /* v8_isolate */,
+                                        v8::GCType v8_type,
+                                        v8::GCCallbackFlags /* flags */,
+                                        void* data) {
+  auto kind = lookupGCKind(v8_type);
+  if (!kind) {
+    return;
+  }
+  auto stats = static_cast<JSIsolateStats*>(data);
+  stats->m_gc[*kind].m_pause_start = Clock::now();
+}
+
+void JSIsolateStats::GCEpilogueCallback(v8::Isolate* /* v8_isolate */,
+                                        v8::GCType v8_type,
+                                        v8::GCCallbackFlags /* flags */,
+                                        void* data) {
+  auto kind = lookupGCKind(v8_type);
+  if (!kind) {
+    return;
+  }
+  auto stats = static_cast<JSIsolateStats*>(data);
+  auto& record = stats->m_gc[*kind];
+  auto pause = Clock::now() - record.m_pause_start;
+  record.m_count++;
+  record.m_total_pause += pause;
+  record.m_max_pause = std::max(record.m_max_pause, pause);
+
+  auto pause_ms = std::chrono::duration<double, std::milli>(pause).count();
+  size_t bucket = 0;
+  while (bucket < std::size(kPauseBucketsMs) && pause_ms > kPauseBucketsMs[bucket]) {
+    bucket++;
+  }
+  record.m_histogram[bucket]++;
+}
+
+py::dict JSIsolateStats::GetStats() const {
+  TRACE("JSIsolateStats::GetStats {}", THIS);
+  auto v8_isolate = m_v8_isolate.lock();
+
+  v8::HeapStatistics v8_heap_stats;
+  v8_isolate->GetHeapStatistics(&v8_heap_stats);
+  py::dict py_heap;
+  py_heap["total_heap_size"] = v8_heap_stats.total_heap_size();
+  py_heap["total_heap_size_executable"] = v8_heap_stats.total_heap_size_executable();
+  py_heap["total_physical_size"] = v8_heap_stats.total_physical_size();
+  py_heap["total_available_size"] = v8_heap_stats.total_available_size();
+  py_heap["used_heap_size"] = v8_heap_stats.used_heap_size();
+  py_heap["heap_size_limit"] = v8_heap_stats.heap_size_limit();
+  py_heap["malloced_memory"] = v8_heap_stats.malloced_memory();
+  py_heap["external_memory"] = v8_heap_stats.external_memory();
+  py_heap["peak_malloced_memory"] = v8_heap_stats.peak_malloced_memory();
+  py_heap["number_of_native_contexts"] = v8_heap_stats.number_of_native_contexts();
+  py_heap["number_of_detached_contexts"] = v8_heap_stats.number_of_detached_contexts();
+
+  py::dict py_heap_spaces;
+  for (size_t i = 0; i < v8_isolate->NumberOfHeapSpaces(); i++) {
+    v8::HeapSpaceStatistics v8_space_stats;
+    if (!v8_isolate->GetHeapSpaceStatistics(&v8_space_stats, i)) {
+      continue;
+    }
+    py::dict py_space;
+    py_space["space_size"] = v8_space_stats.space_size();
+    py_space["space_used_size"] = v8_space_stats.space_used_size();
+    py_space["space_available_size"] = v8_space_stats.space_available_size();
+    py_space["physical_space_size"] = v8_space_stats.physical_space_size();
+    py_heap_spaces[v8_space_stats.space_name()] = py_space;
+  }
+
+  py::dict py_gc;
+  for (size_t kind = 0; kind < kNumGCKinds; kind++) {
+    auto& record = m_gc[kind];
+    py::dict py_histogram;
+    for (size_t bucket = 0; bucket < kNumPauseBuckets; bucket++) {
+      auto le = bucket < std::size(kPauseBucketsMs) ? py::cast(kPauseBucketsMs[bucket] / 1000)  //
+                                                    : py::object(py::str("+Inf"));
+      py_histogram[le] = record.m_histogram[bucket];
+    }
+    py::dict py_record;
+    py_record["count"] = record.m_count;
+    py_record["total_pause"] = toSeconds(record.m_total_pause);
+    py_record["max_pause"] = toSeconds(record.m_max_pause);
+    py_record["pause_histogram"] = py_histogram;
+    py_gc[gcKindName(kind)] = py_record;
+  }
+
+  py::dict py_conversions;
+  py_conversions["js_to_py"] = m_num_js_to_py;
+  py_conversions["py_to_js"] = m_num_py_to_js;
+
+  py::dict py_result;
+  py_result["heap"] = py_heap;
+  py_result["heap_spaces"] = py_heap_spaces;
+  py_result["gc"] = py_gc;
+  py_result["compile"] = timeRecordToDict(m_compile);
+  py_result["execute"] = timeRecordToDict(m_execute);
+  py_result["conversions"] = py_conversions;
+  return py_result;
+}
@@ -0,0 +1,71 @@
+#ifndef NAGA_JSISOLATESTATS_H_
+#define NAGA_JSISOLATESTATS_H_
+
+#include "Base.h"
+
+#include <array>
+#include <chrono>
+
+// JSIsolateStats collects runtime metrics of one isolate, see JSIsolate::GetStats.
+//
+// Counters are plain integers updated by the thread holding the isolate lock, collection costs a few increments
+// and clock reads per operation. Heap statistics are not collected at all, they are queried from V8 on demand.
+// Hot paths get to the stats via isolate data slot (see FromV8) instead of going through the isolate registry.
+
+class JSIsolateStats {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  enum GCKind { kScavenge = 0, kMinorMarkCompact, kMarkSweepCompact, kIncrementalMarking, kWeakCallbacks, kNumGCKinds };
+  // upper bounds of GC pause histogram buckets in milliseconds, the last bucket is unbounded
+  static constexpr double kPauseBucketsMs[] = {0.1, 0.5, 1, 2, 5, 10, 20, 50, 100};
+  static constexpr size_t kNumPauseBuckets = std::size(kPauseBucketsMs) + 1;
+  static constexpr uint32_t kIsolateDataSlot = 0;
+
+  struct GCRecord {
+    uint64_t m_count{0};
+    Clock::duration m_total_pause{};
+    Clock::duration m_max_pause{};
+    std::array<uint64_t, kNumPauseBuckets> m_histogram{};
+    Clock::time_point m_pause_start;
+  };
+
+  struct TimeRecord {
+    uint64_t m_count{0};
+    Clock::duration m_total_time{};
+  };
+
+ private:
+  v8x::ProtectedIsolatePtr m_v8_isolate;
+  std::array<GCRecord, kNumGCKinds> m_gc;
+  TimeRecord m_compile;
+  TimeRecord m_execute;
+  uint64_t m_num_js_to_py{0};
+  uint64_t m_num_py_to_js{0};
+
+  static void GCPrologueCallback(v8::Isolate* v8_isolate, v8::GCType v8_type, v8::GCCallbackFlags flags, void* data);
+  static void GCEpilogueCallback(v8::Isolate* v8_isolate, v8::GCType v8_type, v8::GCCallbackFlags flags, void* data);
+
+ public:
+  explicit JSIsolateStats(v8x::ProtectedIsolatePtr v8_protected_isolate);
+  ~JSIsolateStats();
+
+  static JSIsolateStats* FromV8(v8::Isolate* v8_isolate) {
+    return static_cast<JSIsolateStats*>(v8_isolate->GetData(kIsolateDataSlot));
+  }
+
+  void RecordCompile(Clock::duration duration) {
+    m_compile.m_count++;
+    m_compile.m_total_time += duration;
+  }
+  void RecordExecute(Clock::duration duration) {
+    m_execute.m_count++;
+    m_execute.m_total_time += duration;
+  }
+  void RecordJSToPy() { m_num_js_to_py++; }
+  void RecordPyToJS() { m_num_py_to_js++; }
+
+  py::dict GetStats() const;
+};
+
+#endif
@@ -0,0 +1,314 @@
+#include "JSMessageChannel.h"
+#include "JSContext.h"
+#include "JSIsolate.h"
+#include "JSPlatform.h"
+#include "Logging.h"
+#include "Printing.h"
+#include "V8XUtils.h"
+
+#include <algorithm>
+
+#define TRACE(...) \
+  LOGGER_INDENT;   \
+  SPDLOG_LOGGER_TRACE(getLogger(kJSMessageChannelLogger), __VA_ARGS__)
+
+static std::atomic<uint64_t> g_next_port_id{1};
+
+class DispatchMessagesTask : public v8::Task {
+  std::weak_ptr<JSMailbox> m_mailbox;
+
+ public:
+  explicit DispatchMessagesTask(std::weak_ptr<JSMailbox> mailbox) : m_mailbox(std::move(mailbox)) {}
+
+  void Run() override {
+    // the isolate might be gone by now, its pending foreground tasks are not dropped by the platform
+    if (auto mailbox = m_mailbox.lock()) {
+      mailbox->Dispatch();
+    }
+  }
+};
+
+template <typename T>
+static void updateMax(std::atomic<T>& max, T value) {
+  auto current = max.load(std::memory_order_relaxed);
+  while (value > current && !max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+  }
+}
+
+static void postMessageCallback(const v8::FunctionCallbackInfo<v8::Value>& v8_info) {
+  TRACE("postMessageCallback v8_info={}", v8_info);
+  auto v8_isolate = v8x::lockIsolate(v8_info.GetIsolate());
+  auto v8_context = v8_isolate->GetCurrentContext();
+  auto port_id = static_cast<uint64_t>(v8_info.Data().As<v8::Number>()->Value());
+
+  // both postMessage(value, [transfer]) and postMessage(value, {transfer}) are accepted
+  v8::Local<v8::Value> v8_transfer_list;
+  if (v8_info.Length() > 1 && v8_info[1]->IsArray()) {
+    v8_transfer_list = v8_info[1];
+  } else if (v8_info.Length() > 1 && v8_info[1]->IsObject()) {
+    auto v8_transfer_key = v8x::toString(v8_isolate, "transfer");
+    if (!v8_info[1].As<v8::Object>()->Get(v8_context, v8_transfer_key).ToLocal(&v8_transfer_list)) {
+      return;
+    }
+  }
+
+  auto isolate = JSIsolate::FromV8(v8_isolate);
+  isolate->Mailbox()->PostToPeer(v8_isolate, port_id, v8_info[0], v8_transfer_list);
+}
+
+static void closePortCallback(const v8::FunctionCallbackInfo<v8::Value>& v8_info) {
+  TRACE("closePortCallback v8_info={}", v8_info);
+  auto v8_isolate = v8x::lockIsolate(v8_info.GetIsolate());
+  auto port_id = static_cast<uint64_t>(v8_info.Data().As<v8::Number>()->Value());
+  JSIsolate::FromV8(v8_isolate)->Mailbox()->ClosePort(port_id);
+}
+
+static v8::Local<v8::Function> createPortFunction(v8x::LockedIsolatePtr& v8_isolate,
+                                                  v8::Local<v8::Context> v8_context,
+                                                  v8::FunctionCallback callback,
+                                                  uint64_t port_id,
+                                                  const char* name,
+                                                  int length) {
+  auto v8_port_id = v8::Number::New(v8_isolate, static_cast<double>(port_id));
+  auto v8_fn = v8::Function::New(v8_context, callback, v8_port_id, length).ToLocalChecked();
+  v8_fn->SetName(v8x::toString(v8_isolate, name));
+  return v8_fn;
+}
+
+JSMailbox::JSMailbox(v8x::ProtectedIsolatePtr v8_protected_isolate, std::shared_ptr<v8::TaskRunner> v8_task_runner)
+    : m_v8_isolate(v8_protected_isolate), m_v8_task_runner(std::move(v8_task_runner)) {
+  TRACE("JSMailbox::JSMailbox {} v8_isolate={}", THIS, m_v8_isolate);
+}
+
+JSMailbox::~JSMailbox() {
+  TRACE("JSMailbox::~JSMailbox {}", THIS);
+  // ports hold V8 handles and must be gone by now, see Close
+  assert(m_ports.empty());
+}
+
+void JSMailbox::CreatePort(v8x::LockedIsolatePtr& v8_isolate,
+                           v8::Local<v8::Context> v8_context,
+                           const std::string& name,
+                           uint64_t port_id,
+                           const std::shared_ptr<JSMailbox>& peer_mailbox,
+                           uint64_t peer_id) {
+  TRACE("JSMailbox::CreatePort {} name={} port_id={} peer_id={}", THIS, name, port_id, peer_id);
+  PrunePorts();
+
+  auto v8_port = v8::Object::New(v8_isolate);
+  auto v8_post = createPortFunction(v8_isolate, v8_context, postMessageCallback, port_id, "postMessage", 1);
+  auto v8_close = createPortFunction(v8_isolate, v8_context, closePortCallback, port_id, "close", 0);
+  v8_port->DefineOwnProperty(v8_context, v8x::toString(v8_isolate, "postMessage"), v8_post, v8::DontEnum).Check();
+  v8_port->DefineOwnProperty(v8_context, v8x::toString(v8_isolate, "close"), v8_close, v8::DontEnum).Check();
+  v8_port->Set(v8_context, v8x::toString(v8_isolate, "onmessage"), v8::Null(v8_isolate)).Check();
+  v8_context->Global()->Set(v8_context, v8x::toString(v8_isolate, name), v8_port).Check();
+
+  auto& port = m_ports[port_id];
+  port.m_v8_port.Reset(v8_isolate, v8_port);
+  port.m_v8_port.SetWeak();
+  port.m_v8_port.SetWrapperClassId(v8x::kMessagePortHandle);
+  port.m_peer_mailbox = peer_mailbox;
+  port.m_peer_id = peer_id;
+}
+
+void JSMailbox::ClosePort(uint64_t port_id) {
+  TRACE("JSMailbox::ClosePort {} port_id={}", THIS, port_id);
+  // messages already queued for this port get dropped at dispatch
+  m_ports.erase(port_id);
+}
+
+void JSMailbox::PrunePorts() {
+  // expects the isolate lock to be held, forgets ports collected by GC
+  for (auto it = m_ports.begin(); it != m_ports.end();) {
+    it = it->second.m_v8_port.IsEmpty() ? m_ports.erase(it) : std::next(it);
+  }
+}
+
+bool JSMailbox::PostToPeer(v8x::LockedIsolatePtr& v8_isolate,
+                           uint64_t port_id,
+                           v8::Local<v8::Value> v8_value,
+                           v8::Local<v8::Value> v8_transfer_list) {
+  TRACE("JSMailbox::PostToPeer {} port_id={} v8_value={}", THIS, port_id, v8_value);
+  auto it = m_ports.find(port_id);
+  if (it == m_ports.end()) {
+    // posting to a closed port is a no-op, like in browsers
+    return true;
+  }
+
+  // serialization runs on the sender's thread, the receiver only deserializes
+  JSMessage message{it->second.m_peer_id, SerializedJSValue(), Clock::time_point()};
+  auto v8_context = v8_isolate->GetCurrentContext();
+  if (serializeJSValue(v8_isolate, v8_context, v8_value, v8_transfer_list, message.m_value).IsNothing()) {
+    return false;
+  }
+
+  if (auto peer_mailbox = it->second.m_peer_mailbox.lock()) {
+    message.m_posted_at = Clock::now();
+    peer_mailbox->Post(std::move(message));
+  }
+  return true;
+}
+
+void JSMailbox::Post(JSMessage message) {
+  TRACE("JSMailbox::Post {} port_id={} size={}", THIS, message.m_port_id, message.m_value.m_size);
+  if (m_closed.load(std::memory_order_acquire)) {
+    m_num_dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  m_num_posted.fetch_add(1, std::memory_order_relaxed);
+  m_queue.Push(std::move(message));
+  updateMax(m_max_depth, m_queue.Size());
+
+  // only the first message into an idle mailbox posts a task, the task dispatches everything queued until it runs
+  if (!m_scheduled.exchange(true, std::memory_order_acq_rel)) {
+    m_v8_task_runner->PostTask(std::make_unique<DispatchMessagesTask>(weak_from_this()));
+  }
+}
+
+void JSMailbox::Dispatch() {
+  TRACE("JSMailbox::Dispatch {} depth={}", THIS, m_queue.Size());
+  // called from a foreground task, the lock is already held by the thread pumping the message loop
+  auto v8_isolate = m_v8_isolate.lock();
+  auto v8_isolate_scope = v8::Isolate::Scope(v8_isolate);
+
+  // reset before draining, anything pushed from now on either gets drained below or schedules a new task
+  m_scheduled.exchange(false, std::memory_order_acq_rel);
+  m_num_dispatches.fetch_add(1, std::memory_order_relaxed);
+
+  while (auto message = m_queue.Pop()) {
+    RecordLatency(Clock::now() - message->m_posted_at);
+    if (m_closed.load(std::memory_order_acquire)) {
+      m_num_dropped.fetch_add(1, std::memory_order_relaxed);
+      continue;
+    }
+    Deliver(v8_isolate, *message);
+  }
+}
+
+void JSMailbox::Deliver(v8x::LockedIsolatePtr& v8_isolate, JSMessage& message) {
+  TRACE("JSMailbox::Deliver {} port_id={}", THIS, message.m_port_id);
+  auto it = m_ports.find(message.m_port_id);
+  if (it == m_ports.end()) {
+    m_num_dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  auto v8_scope = v8x::withScope(v8_isolate);
+  auto v8_port = it->second.m_v8_port.Get(v8_isolate);
+  if (v8_port.IsEmpty()) {
+    m_ports.erase(it);
+    m_num_dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  auto v8_context = v8_port->CreationContext();
+  auto v8_context_scope = v8x::withContext(v8_context);
+  // we are inside a platform task, nobody up the stack could handle a C++ exception, so no AutoTryCatch here
+  v8::TryCatch v8_try_catch(v8_isolate);
+
+  v8::Local<v8::Value> v8_handler;
+  if (!v8_port->Get(v8_context, v8x::toString(v8_isolate, "onmessage")).ToLocal(&v8_handler) ||
+      !v8_handler->IsFunction()) {
+    m_num_dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  v8::Local<v8::Value> v8_data;
+  if (deserializeJSValue(v8_isolate, v8_context, message.m_value).ToLocal(&v8_data)) {
+    auto v8_event = v8::Object::New(v8_isolate);
+    v8_event->Set(v8_context, v8x::toString(v8_isolate, "data"), v8_data).Check();
+    v8_event->Set(v8_context, v8x::toString(v8_isolate, "target"), v8_port).Check();
+    v8::Local<v8::Value> v8_args[] = {v8_event};
+    if (!v8_handler.As<v8::Function>()->Call(v8_context, v8_port, 1, v8_args).IsEmpty()) {
+      m_num_delivered.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+  }
+
+  m_num_errors.fetch_add(1, std::memory_order_relaxed);
+  if (v8_try_catch.HasCaught() && !v8_try_catch.HasTerminated()) {
+    SPDLOG_WARN("uncaught exception in onmessage handler: {}", v8x::toStdString(v8_isolate, v8_try_catch.Exception()));
+  }
+}
+
+void JSMailbox::RecordLatency(Clock::duration latency) {
+  auto latency_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count();
+  m_total_latency_ns.fetch_add(latency_ns, std::memory_order_relaxed);
+  updateMax(m_max_latency_ns, static_cast<int64_t>(latency_ns));
+
+  auto latency_ms = latency_ns / 1e6;
+  size_t bucket = 0;
+  while (bucket < std::size(kLatencyBucketsMs) && latency_ms > kLatencyBucketsMs[bucket]) {
+    bucket++;
+  }
+  m_latency_histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+void JSMailbox::Close() {
+  TRACE("JSMailbox::Close {}", THIS);
+  m_closed.store(true, std::memory_order_release);
+  auto v8_isolate = m_v8_isolate.lock();
+  m_ports.clear();
+  while (m_queue.Pop()) {
+    m_num_dropped.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+py::dict JSMailbox::GetStats() const {
+  TRACE("JSMailbox::GetStats {}", THIS);
+  auto num_delivered = m_num_delivered.load(std::memory_order_relaxed);
+  auto num_dropped = m_num_dropped.load(std::memory_order_relaxed);
+  auto num_errors = m_num_errors.load(std::memory_order_relaxed);
+  auto num_received = num_delivered + num_dropped + num_errors;
+
+  py::dict py_histogram;
+  for (size_t bucket = 0; bucket < kNumLatencyBuckets; bucket++) {
+    auto le = bucket < std::size(kLatencyBucketsMs) ? py::cast(kLatencyBucketsMs[bucket] / 1000)  //
+                                                    : py::object(py::str("+Inf"));
+    py_histogram[le] = m_latency_histogram[bucket].load(std::memory_order_relaxed);
+  }
+
+  py::dict py_latency;
+  auto total_latency = m_total_latency_ns.load(std::memory_order_relaxed) / 1e9;
+  py_latency["total"] = total_latency;
+  py_latency["mean"] = num_received ? total_latency / num_received : 0.0;
+  py_latency["max"] = m_max_latency_ns.load(std::memory_order_relaxed) / 1e9;
+  py_latency["histogram"] = py_histogram;
+
+  py::dict py_result;
+  py_result["depth"] = m_queue.Size();
+  py_result["max_depth"] = m_max_depth.load(std::memory_order_relaxed);
+  py_result["posted"] = m_num_posted.load(std::memory_order_relaxed);
+  py_result["delivered"] = num_delivered;
+  py_result["dropped"] = num_dropped;
+  py_result["errors"] = num_errors;
+  py_result["dispatches"] = m_num_dispatches.load(std::memory_order_relaxed);
+  py_result["latency"] = py_latency;
+  return py_result;
+}
+
+void connectContexts(const SharedJSContextPtr& context1, const SharedJSContextPtr& context2, const std::string& name) {
+  TRACE("connectContexts context1={} context2={} name={}", context1, context2, name);
+  if (!context1 || !context2) {
+    throw py::value_error("contexts must not be None");
+  }
+
+  auto id1 = g_next_port_id.fetch_add(1, std::memory_order_relaxed);
+  auto id2 = g_next_port_id.fetch_add(1, std::memory_order_relaxed);
+  auto mailbox1 = context1->GetIsolate()->Mailbox();
+  auto mailbox2 = context2->GetIsolate()->Mailbox();
+
+  // the isolates are locked one after another, never both at once
+  auto createPort = [&name](const SharedJSContextPtr& context, const std::shared_ptr<JSMailbox>& mailbox,
+                            uint64_t port_id, const std::shared_ptr<JSMailbox>& peer_mailbox, uint64_t peer_id) {
+    auto v8_isolate = context->GetIsolate()->ToV8();
+    auto v8_isolate_scope = v8::Isolate::Scope(v8_isolate);
+    auto v8_scope = v8x::withScope(v8_isolate);
+    auto v8_context = context->ToV8();
+    auto v8_context_scope = v8x::withContext(v8_context);
+    mailbox->CreatePort(v8_isolate, v8_context, name, port_id, peer_mailbox, peer_id);
+  };
+  createPort(context1, mailbox1, id1, mailbox2, id2);
+  createPort(context2, mailbox2, id2, mailbox1, id1);
+}
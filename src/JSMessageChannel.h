@@ -0,0 +1,101 @@
+#ifndef NAGA_JSMESSAGECHANNEL_H_
+#define NAGA_JSMESSAGECHANNEL_H_
+
+#include "Base.h"
+#include "JSStructuredClone.h"
+#include "V8XMPSCQueue.h"
+#include "V8XProtectedIsolate.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <unordered_map>
+
+// Message channels connect two contexts, possibly living in different isolates, with worker-style ports.
+// toolkit.connect(ctx1, ctx2, name) installs a port object under the given global name into both contexts:
+//
+//   port.postMessage(value, transfer)  - structured-clones value to the other side, see JSStructuredClone.h
+//   port.onmessage = (event) => {...}  - receives {data: value} on the other side
+//   port.close()                       - disconnects this end, further messages to it are dropped
+//
+// Every isolate has a JSMailbox with a lock-free MPSC queue. postMessage serializes the value on the sender's thread
+// and pushes it straight into the mailbox of the receiving isolate. The first push into an idle mailbox posts one
+// foreground task to the receiving isolate, which then dispatches everything queued so far. Foreground tasks run
+// on whichever thread pumps the receiver's message loop (JSPlatform.pump_message_loop), the sender never locks the
+// receiving isolate and no Python thread relays the messages.
+//
+// Ports are held weakly, a port object collected by GC stops receiving messages just like a closed one.
+
+struct JSMessage {
+  using Clock = std::chrono::steady_clock;
+
+  uint64_t m_port_id;
+  SerializedJSValue m_value;
+  Clock::time_point m_posted_at;
+};
+
+class JSMailbox : public std::enable_shared_from_this<JSMailbox> {
+ public:
+  using Clock = JSMessage::Clock;
+
+  // upper bounds of delivery latency histogram buckets in milliseconds, the last bucket is unbounded
+  static constexpr double kLatencyBucketsMs[] = {0.01, 0.05, 0.1, 0.5, 1, 5, 10, 50, 100};
+  static constexpr size_t kNumLatencyBuckets = std::size(kLatencyBucketsMs) + 1;
+
+ private:
+  struct Port {
+    v8::Global<v8::Object> m_v8_port;  // weak
+    std::weak_ptr<JSMailbox> m_peer_mailbox;
+    uint64_t m_peer_id;
+  };
+
+  v8x::ProtectedIsolatePtr m_v8_isolate;
+  std::shared_ptr<v8::TaskRunner> m_v8_task_runner;
+  v8x::MPSCQueue<JSMessage> m_queue;
+  std::atomic<bool> m_scheduled{false};
+  std::atomic<bool> m_closed{false};
+  std::unordered_map<uint64_t, Port> m_ports;  // accessed only under the isolate lock
+
+  // written by senders
+  std::atomic<uint64_t> m_num_posted{0};
+  std::atomic<size_t> m_max_depth{0};
+  // written by the dispatching thread, atomic only because GetStats may read them from elsewhere
+  std::atomic<uint64_t> m_num_delivered{0};
+  std::atomic<uint64_t> m_num_dropped{0};
+  std::atomic<uint64_t> m_num_errors{0};
+  std::atomic<uint64_t> m_num_dispatches{0};
+  std::atomic<int64_t> m_total_latency_ns{0};
+  std::atomic<int64_t> m_max_latency_ns{0};
+  std::array<std::atomic<uint64_t>, kNumLatencyBuckets> m_latency_histogram{};
+
+  void RecordLatency(Clock::duration latency);
+  void Deliver(v8x::LockedIsolatePtr& v8_isolate, JSMessage& message);
+  void PrunePorts();
+
+ public:
+  JSMailbox(v8x::ProtectedIsolatePtr v8_protected_isolate, std::shared_ptr<v8::TaskRunner> v8_task_runner);
+  ~JSMailbox();
+
+  void CreatePort(v8x::LockedIsolatePtr& v8_isolate,
+                  v8::Local<v8::Context> v8_context,
+                  const std::string& name,
+                  uint64_t port_id,
+                  const std::shared_ptr<JSMailbox>& peer_mailbox,
+                  uint64_t peer_id);
+  void ClosePort(uint64_t port_id);
+  bool PostToPeer(v8x::LockedIsolatePtr& v8_isolate,
+                  uint64_t port_id,
+                  v8::Local<v8::Value> v8_value,
+                  v8::Local<v8::Value> v8_transfer_list);
+
+  // may be called from any thread
+  void Post(JSMessage message);
+  void Dispatch();
+  void Close();
+
+  py::dict GetStats() const;
+};
+
+void connectContexts(const SharedJSContextPtr& context1, const SharedJSContextPtr& context2, const std::string& name);
+
+#endif
@@ -0,0 +1,92 @@
+#include "JSModule.h"
+#include "JSModuleMap.h"
+#include "JSIsolate.h"
+#include "JSIsolateStats.h"
+#include "JSException.h"
+#include "JSWatchdog.h"
+#include "PythonUtils.h"
+#include "PybindExtensions.h"
+#include "Wrapping.h"
+#include "Logging.h"
+#include "Printing.h"
+#include "V8XUtils.h"
+
+#define TRACE(...) \
+  LOGGER_INDENT;   \
+  SPDLOG_LOGGER_TRACE(getLogger(kJSModuleLogger), __VA_ARGS__)
+
+JSModule::JSModule(v8x::ProtectedIsolatePtr v8_protected_isolate, std::string name, v8::Local<v8::Module> v8_module)
+    : m_v8_isolate(v8_protected_isolate),
+      m_name(std::move(name)) {
+  auto v8_isolate = m_v8_isolate.lock();
+
+  m_v8_module.Reset(v8_isolate, v8_module);
+  m_v8_module.AnnotateStrongRetainer("Naga JSModule.m_v8_module");
+  m_v8_module.SetWrapperClassId(v8x::kJSModuleHandle);
+
+  TRACE("JSModule::JSModule {} v8_isolate={} name={} v8_module={}", THIS, P$(v8_isolate), m_name, v8_module);
+}
+
+JSModule::~JSModule() {
+  TRACE("JSModule::~JSModule {}", THIS);
+  m_v8_module.Reset();
+}
+
+v8::Local<v8::Module> JSModule::Module() const {
+  auto v8_isolate = m_v8_isolate.lock();
+  auto result = v8::Local<v8::Module>::New(v8_isolate, m_v8_module);
+  TRACE("JSModule::Module {} => {}", THIS, result);
+  return result;
+}
+
+const std::string& JSModule::GetName() const {
+  return m_name;
+}
+
+py::list JSModule::GetRequests() const {
+  TRACE("JSModule::GetRequests {}", THIS);
+  auto v8_isolate = m_v8_isolate.lock();
+  auto v8_scope = v8x::withScope(v8_isolate);
+  auto v8_module = Module();
+  py::list py_result;
+  for (int i = 0; i < v8_module->GetModuleRequestsLength(); i++) {
+    py_result.append(v8x::toStdString(v8_isolate, v8_module->GetModuleRequest(i)));
+  }
+  return py_result;
+}
+
+py::object JSModule::Evaluate(double timeout) const {
+  TRACE("JSModule::Evaluate {} timeout={}", THIS, timeout);
+  auto v8_isolate = m_v8_isolate.lock();
+  auto isolate = JSIsolate::FromV8(v8_isolate);
+  isolate->CheckOutOfMemory();
+  auto v8_scope = v8x::withScope(v8_isolate);
+  auto v8_context = v8x::getCurrentContext(v8_isolate);
+  auto v8_module = Module();
+
+  // module instances are bound to the context they were compiled for by the module map
+  if (isolate->Modules().GetName(v8_context, v8_module) != m_name) {
+    throw JSException(fmt::format("Module '{}' was compiled in another context", m_name));
+  }
+
+  // note the deadline must outlive the try catch
+  auto deadline = JSDeadline(v8_isolate, timeout);
+  auto v8_try_catch = v8x::withAutoTryCatch(v8_isolate);
+
+  v8::MaybeLocal<v8::Value> v8_maybe_namespace;
+  {
+    auto _ = pyu::withoutGIL();
+    auto start = JSIsolateStats::Clock::now();
+    v8_maybe_namespace = isolate->Modules().Evaluate(v8_isolate, v8_context, v8_module);
+    JSIsolateStats::FromV8(v8_isolate)->RecordExecute(JSIsolateStats::Clock::now() - start);
+  }
+
+  if (v8_maybe_namespace.IsEmpty()) {
+    return py::js_null();
+  }
+  return wrap(v8_isolate, v8_maybe_namespace.ToLocalChecked());
+}
+
+void JSModule::Dump(std::ostream& os) const {
+  fmt::print(os, "JSModule {} name={}", THIS, m_name);
+}
@@ -0,0 +1,25 @@
+#ifndef NAGA_JSMODULE_H_
+#define NAGA_JSMODULE_H_
+
+#include "Base.h"
+#include "V8XProtectedIsolate.h"
+
+class JSModule {
+  v8x::ProtectedIsolatePtr m_v8_isolate;
+  std::string m_name;
+  v8::Global<v8::Module> m_v8_module;
+
+ public:
+  JSModule(v8x::ProtectedIsolatePtr v8_isolate, std::string name, v8::Local<v8::Module> v8_module);
+  ~JSModule();
+
+  [[nodiscard]] v8::Local<v8::Module> Module() const;
+
+  [[nodiscard]] const std::string& GetName() const;
+  [[nodiscard]] py::list GetRequests() const;
+  py::object Evaluate(double timeout = 0) const;
+
+  void Dump(std::ostream& os) const;
+};
+
+#endif
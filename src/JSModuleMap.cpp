@@ -0,0 +1,352 @@
+#include "JSModuleMap.h"
+#include "JSContext.h"
+#include "JSIsolate.h"
+#include "JSIsolateStats.h"
+#include "JSException.h"
+#include "PythonObject.h"
+#include "PythonUtils.h"
+#include "Logging.h"
+#include "Printing.h"
+#include "V8XUtils.h"
+
+#include <filesystem>
+#include <fstream>
+
+#define TRACE(...) \
+  LOGGER_INDENT;   \
+  SPDLOG_LOGGER_TRACE(getLogger(kJSModuleLogger), __VA_ARGS__)
+
+static bool isRelativeSpecifier(const std::string& specifier) {
+  return specifier.rfind("./", 0) == 0 || specifier.rfind("../", 0) == 0;
+}
+
+std::string JSModuleResolver::Resolve(const std::string& specifier, const std::string& referrer) const {
+  if (!isRelativeSpecifier(specifier)) {
+    return specifier;
+  }
+  auto base = std::filesystem::path(referrer).parent_path();
+  return (base / specifier).lexically_normal().string();
+}
+
+std::string JSModuleResolver::Load(const std::string& name) const {
+  std::ifstream file(name, std::ios::binary);
+  if (!file) {
+    throw JSException(fmt::format("Cannot load module '{}'", name), PyExc_ImportError);
+  }
+  return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+JSModuleSource JSModuleResolver::LoadModule(v8x::LockedIsolatePtr& v8_isolate, const std::string& name) const {
+  auto source = Load(name);
+  return JSModuleSource{v8x::toString(v8_isolate, source), std::hash<std::string>{}(source), std::string_view()};
+}
+
+PythonModuleResolver::PythonModuleResolver(py::object py_resolve, py::object py_load)
+    : m_py_resolve(std::move(py_resolve)),
+      m_py_load(std::move(py_load)) {}
+
+PythonModuleResolver::~PythonModuleResolver() {
+  auto py_gil = pyu::withGIL();
+  m_py_resolve = py::object();
+  m_py_load = py::object();
+}
+
+std::string PythonModuleResolver::Resolve(const std::string& specifier, const std::string& referrer) const {
+  if (m_py_resolve.is_none()) {
+    return JSModuleResolver::Resolve(specifier, referrer);
+  }
+  auto py_gil = pyu::withGIL();
+  return py::cast<std::string>(m_py_resolve(specifier, referrer));
+}
+
+std::string PythonModuleResolver::Load(const std::string& name) const {
+  if (m_py_load.is_none()) {
+    return JSModuleResolver::Load(name);
+  }
+  auto py_gil = pyu::withGIL();
+  return py::cast<std::string>(m_py_load(name));
+}
+
+JSModuleMap::JSModuleMap(v8x::ProtectedIsolatePtr v8_isolate)
+    : m_v8_isolate(std::move(v8_isolate)),
+      m_resolver(std::make_unique<JSModuleResolver>()) {
+  TRACE("JSModuleMap::JSModuleMap {} v8_isolate={}", THIS, m_v8_isolate);
+}
+
+JSModuleMap::~JSModuleMap() {
+  TRACE("JSModuleMap::~JSModuleMap {}", THIS);
+}
+
+void JSModuleMap::SetResolver(std::unique_ptr<JSModuleResolver> resolver) {
+  TRACE("JSModuleMap::SetResolver {}", THIS);
+  auto v8_isolate = m_v8_isolate.lock();
+  m_resolver = resolver ? std::move(resolver) : std::make_unique<JSModuleResolver>();
+}
+
+const JSModuleResolver& JSModuleMap::Resolver() const {
+  return *m_resolver;
+}
+
+JSModuleMap::ContextModules& JSModuleMap::GetContextModules(v8::Local<v8::Context> v8_context) {
+  return m_contexts[JSContext::FromV8(v8_context).get()];
+}
+
+v8::MaybeLocal<v8::Module> JSModuleMap::Lookup(v8x::LockedIsolatePtr& v8_isolate,
+                                               v8::Local<v8::Context> v8_context,
+                                               const std::string& name) {
+  auto& context_modules = GetContextModules(v8_context);
+  auto it = context_modules.m_modules.find(name);
+  if (it == context_modules.m_modules.end()) {
+    return v8::MaybeLocal<v8::Module>();
+  }
+  return it->second.Get(v8_isolate);
+}
+
+v8::MaybeLocal<v8::Module> JSModuleMap::Compile(v8x::LockedIsolatePtr& v8_isolate,
+                                                v8::Local<v8::Context> v8_context,
+                                                const std::string& name,
+                                                const std::string& source) {
+  auto v8_scope = v8x::withEscapableScope(v8_isolate);
+  auto module_source =
+      JSModuleSource{v8x::toString(v8_isolate, source), std::hash<std::string>{}(source), std::string_view()};
+  v8::Local<v8::Module> v8_module;
+  if (!Compile(v8_isolate, v8_context, name, module_source).ToLocal(&v8_module)) {
+    return v8::MaybeLocal<v8::Module>();
+  }
+  return v8_scope.Escape(v8_module);
+}
+
+v8::MaybeLocal<v8::Module> JSModuleMap::Compile(v8x::LockedIsolatePtr& v8_isolate,
+                                                v8::Local<v8::Context> v8_context,
+                                                const std::string& name,
+                                                const JSModuleSource& source) {
+  TRACE("JSModuleMap::Compile {} name={} source={}", THIS, name, traceText(source.m_v8_source));
+  auto v8_scope = v8x::withEscapableScope(v8_isolate);
+  auto& context_modules = GetContextModules(v8_context);
+  auto has_resolver_cache = !source.m_code_cache.empty();
+
+  auto cache_it = m_code_caches.find(name);
+  if (cache_it != m_code_caches.end() &&
+      (has_resolver_cache || cache_it->second.m_source_hash != source.m_source_hash)) {
+    m_code_caches.erase(cache_it);
+    cache_it = m_code_caches.end();
+  }
+
+  // the source takes ownership of the cached data object, but not of the buffer it points to
+  v8::ScriptCompiler::CachedData* v8_cached_data = nullptr;
+  if (has_resolver_cache) {
+    v8_cached_data = new v8::ScriptCompiler::CachedData(reinterpret_cast<const uint8_t*>(source.m_code_cache.data()),
+                                                        static_cast<int>(source.m_code_cache.size()));
+  } else if (cache_it != m_code_caches.end()) {
+    auto& data = cache_it->second.m_data;
+    v8_cached_data = new v8::ScriptCompiler::CachedData(reinterpret_cast<const uint8_t*>(data.data()),
+                                                        static_cast<int>(data.size()));
+  }
+  auto v8_origin = v8x::createModuleOrigin(v8_isolate, v8x::toString(v8_isolate, name));
+  v8::ScriptCompiler::Source v8_source(source.m_v8_source, v8_origin, v8_cached_data);
+  auto v8_options = v8_cached_data ? v8::ScriptCompiler::kConsumeCodeCache : v8::ScriptCompiler::kNoCompileOptions;
+
+  auto start = JSIsolateStats::Clock::now();
+  auto v8_maybe_module = v8::ScriptCompiler::CompileModule(v8_isolate, &v8_source, v8_options);
+  JSIsolateStats::FromV8(v8_isolate)->RecordCompile(JSIsolateStats::Clock::now() - start);
+
+  v8::Local<v8::Module> v8_module;
+  if (!v8_maybe_module.ToLocal(&v8_module)) {
+    return v8::MaybeLocal<v8::Module>();
+  }
+  m_num_compiled++;
+
+  if (v8_cached_data) {
+    if (v8_source.GetCachedData()->rejected) {
+      // e.g. V8 flags changed since the cache was produced
+      m_num_cache_rejects++;
+      if (cache_it != m_code_caches.end()) {
+        m_code_caches.erase(cache_it);
+        cache_it = m_code_caches.end();
+      }
+    } else {
+      m_num_cache_hits++;
+    }
+  }
+  if (!has_resolver_cache && cache_it == m_code_caches.end()) {
+    std::unique_ptr<v8::ScriptCompiler::CachedData> v8_new_cached_data(
+        v8::ScriptCompiler::CreateCodeCache(v8_module->GetUnboundModuleScript()));
+    if (v8_new_cached_data) {
+      auto raw_data = reinterpret_cast<const char*>(v8_new_cached_data->data);
+      m_code_caches[name] = CodeCache{source.m_source_hash, std::string(raw_data, v8_new_cached_data->length)};
+    }
+  }
+
+  // a module compiled again under the same name replaces the previous one in this context
+  auto& v8_global_module = context_modules.m_modules[name];
+  if (!v8_global_module.IsEmpty()) {
+    auto range = context_modules.m_names_by_hash.equal_range(v8_global_module.Get(v8_isolate)->GetIdentityHash());
+    for (auto it = range.first; it != range.second; ++it) {
+      if (it->second == name) {
+        context_modules.m_names_by_hash.erase(it);
+        break;
+      }
+    }
+  }
+  v8_global_module.Reset(v8_isolate, v8_module);
+  v8_global_module.AnnotateStrongRetainer("Naga JSModuleMap.m_modules");
+  v8_global_module.SetWrapperClassId(v8x::kJSModuleHandle);
+  context_modules.m_names_by_hash.emplace(v8_module->GetIdentityHash(), name);
+
+  return v8_scope.Escape(v8_module);
+}
+
+v8::MaybeLocal<v8::Module> JSModuleMap::Fetch(v8x::LockedIsolatePtr& v8_isolate,
+                                              v8::Local<v8::Context> v8_context,
+                                              const std::string& specifier,
+                                              const std::string& referrer) {
+  TRACE("JSModuleMap::Fetch {} specifier={} referrer={}", THIS, specifier, referrer);
+  // we are called from V8 callbacks, C++ exceptions must not escape from here
+  try {
+    auto name = m_resolver->Resolve(specifier, referrer);
+    auto v8_maybe_module = Lookup(v8_isolate, v8_context, name);
+    if (!v8_maybe_module.IsEmpty()) {
+      return v8_maybe_module;
+    }
+    auto source = m_resolver->LoadModule(v8_isolate, name);
+    return Compile(v8_isolate, v8_context, name, source);
+  } catch (const py::error_already_set& py_ex) {
+    PythonObject::ThrowJSException(v8_isolate, py_ex);
+  } catch (const std::exception& ex) {
+    v8_isolate->ThrowException(v8::Exception::Error(v8x::toString(v8_isolate, ex.what())));
+  }
+  return v8::MaybeLocal<v8::Module>();
+}
+
+v8::MaybeLocal<v8::Value> JSModuleMap::Evaluate(v8x::LockedIsolatePtr& v8_isolate,
+                                                v8::Local<v8::Context> v8_context,
+                                                v8::Local<v8::Module> v8_module) {
+  TRACE("JSModuleMap::Evaluate {} v8_module={}", THIS, v8_module);
+  auto v8_scope = v8x::withEscapableScope(v8_isolate);
+  // both steps are no-ops for modules which got that far already, evaluating an errored module rethrows its error
+  if (v8_module->InstantiateModule(v8_context, ResolveCallback).IsNothing()) {
+    return v8::MaybeLocal<v8::Value>();
+  }
+  if (v8_module->Evaluate(v8_context).IsEmpty()) {
+    return v8::MaybeLocal<v8::Value>();
+  }
+  return v8_scope.Escape(v8_module->GetModuleNamespace());
+}
+
+v8::MaybeLocal<v8::Value> JSModuleMap::Import(v8x::LockedIsolatePtr& v8_isolate,
+                                              v8::Local<v8::Context> v8_context,
+                                              const std::string& specifier,
+                                              const std::string& referrer) {
+  TRACE("JSModuleMap::Import {} specifier={} referrer={}", THIS, specifier, referrer);
+  auto v8_scope = v8x::withEscapableScope(v8_isolate);
+  v8::Local<v8::Module> v8_module;
+  if (!Fetch(v8_isolate, v8_context, specifier, referrer).ToLocal(&v8_module)) {
+    return v8::MaybeLocal<v8::Value>();
+  }
+  v8::Local<v8::Value> v8_namespace;
+  if (!Evaluate(v8_isolate, v8_context, v8_module).ToLocal(&v8_namespace)) {
+    return v8::MaybeLocal<v8::Value>();
+  }
+  return v8_scope.Escape(v8_namespace);
+}
+
+std::string JSModuleMap::GetName(v8::Local<v8::Context> v8_context, v8::Local<v8::Module> v8_module) const {
+  const JSContext* context;
+  try {
+    context = JSContext::FromV8(v8_context).get();
+  } catch (const JSException&) {
+    return std::string();
+  }
+  auto context_it = m_contexts.find(context);
+  if (context_it == m_contexts.end()) {
+    return std::string();
+  }
+  auto& context_modules = context_it->second;
+  auto range = context_modules.m_names_by_hash.equal_range(v8_module->GetIdentityHash());
+  for (auto it = range.first; it != range.second; ++it) {
+    auto module_it = context_modules.m_modules.find(it->second);
+    if (module_it != context_modules.m_modules.end() && module_it->second == v8_module) {
+      return it->second;
+    }
+  }
+  return std::string();
+}
+
+void JSModuleMap::ForgetContext(const JSContext* context) {
+  TRACE("JSModuleMap::ForgetContext {} context={}", THIS, (void*)context);
+  auto v8_isolate = m_v8_isolate.lock();
+  m_contexts.erase(context);
+}
+
+v8::MaybeLocal<v8::Module> JSModuleMap::ResolveCallback(v8::Local<v8::Context> v8_context,
+                                                        v8::Local<v8::String> v8_specifier,
+                                                        v8::Local<v8::Module> v8_referrer) {
+  auto v8_isolate = v8x::lockIsolate(v8_context->GetIsolate());
+  auto& modules = JSIsolate::FromV8(v8_isolate)->Modules();
+  auto specifier = v8x::toStdString(v8_isolate, v8_specifier);
+  TRACE("JSModuleMap::ResolveCallback specifier={} v8_referrer={}", specifier, v8_referrer);
+  return modules.Fetch(v8_isolate, v8_context, specifier, modules.GetName(v8_context, v8_referrer));
+}
+
+v8::MaybeLocal<v8::Promise> JSModuleMap::ImportModuleDynamicallyCallback(v8::Local<v8::Context> v8_context,
+                                                                         v8::Local<v8::ScriptOrModule> v8_referrer,
+                                                                         v8::Local<v8::String> v8_specifier) {
+  auto v8_isolate = v8x::lockIsolate(v8_context->GetIsolate());
+  auto v8_scope = v8x::withEscapableScope(v8_isolate);
+  auto& modules = JSIsolate::FromV8(v8_isolate)->Modules();
+  auto specifier = v8x::toStdString(v8_isolate, v8_specifier);
+  auto v8_referrer_name = v8_referrer->GetResourceName();
+  auto referrer = v8_referrer_name->IsString() ? v8x::toStdString(v8_isolate, v8_referrer_name) : std::string();
+  TRACE("JSModuleMap::ImportModuleDynamicallyCallback specifier={} referrer={}", specifier, referrer);
+
+  v8::Local<v8::Promise::Resolver> v8_resolver;
+  if (!v8::Promise::Resolver::New(v8_context).ToLocal(&v8_resolver)) {
+    return v8::MaybeLocal<v8::Promise>();
+  }
+
+  v8::TryCatch v8_try_catch(v8_isolate);
+  v8::Local<v8::Value> v8_namespace;
+  if (modules.Import(v8_isolate, v8_context, specifier, referrer).ToLocal(&v8_namespace)) {
+    v8_resolver->Resolve(v8_context, v8_namespace).Check();
+  } else if (v8_try_catch.HasTerminated()) {
+    v8_try_catch.ReThrow();
+    return v8::MaybeLocal<v8::Promise>();
+  } else {
+    v8_resolver->Reject(v8_context, v8_try_catch.Exception()).Check();
+  }
+  return v8_scope.Escape(v8_resolver->GetPromise());
+}
+
+void JSModuleMap::InitializeImportMetaCallback(v8::Local<v8::Context> v8_context,
+                                               v8::Local<v8::Module> v8_module,
+                                               v8::Local<v8::Object> v8_meta) {
+  auto v8_isolate = v8x::lockIsolate(v8_context->GetIsolate());
+  auto v8_scope = v8x::withScope(v8_isolate);
+  auto name = JSIsolate::FromV8(v8_isolate)->Modules().GetName(v8_context, v8_module);
+  TRACE("JSModuleMap::InitializeImportMetaCallback name={}", name);
+  auto v8_url_key = v8x::toString(v8_isolate, "url");
+  v8_meta->CreateDataProperty(v8_context, v8_url_key, v8x::toString(v8_isolate, name)).Check();
+}
+
+py::dict JSModuleMap::GetStats() const {
+  TRACE("JSModuleMap::GetStats {}", THIS);
+  auto v8_isolate = m_v8_isolate.lock();
+  size_t num_modules = 0;
+  for (auto& [_, context_modules] : m_contexts) {
+    num_modules += context_modules.m_modules.size();
+  }
+  size_t code_cache_bytes = 0;
+  for (auto& [_, code_cache] : m_code_caches) {
+    code_cache_bytes += code_cache.m_data.size();
+  }
+
+  py::dict py_result;
+  py_result["contexts"] = m_contexts.size();
+  py_result["modules"] = num_modules;
+  py_result["compiled"] = m_num_compiled;
+  py_result["code_caches"] = m_code_caches.size();
+  py_result["code_cache_bytes"] = code_cache_bytes;
+  py_result["code_cache_hits"] = m_num_cache_hits;
+  py_result["code_cache_rejects"] = m_num_cache_rejects;
+  return py_result;
+}
@@ -0,0 +1,124 @@
+#ifndef NAGA_JSMODULEMAP_H_
+#define NAGA_JSMODULEMAP_H_
+
+#include "Base.h"
+#include "V8XProtectedIsolate.h"
+
+#include <string_view>
+#include <unordered_map>
+
+// ES modules are compiled with v8::ScriptCompiler::CompileModule and tracked by JSModuleMap, one per isolate.
+//
+// Import specifiers are turned into resolved names by a JSModuleResolver, which also loads their sources.
+// The default resolver treats names as file paths: "./x.js" and "../x.js" are relative to the importing module,
+// other specifiers are taken verbatim. JSIsolate.set_module_resolver can replace either step by a Python callable.
+//
+// A V8 module instance belongs to the context it was instantiated in, so the map keeps module instances per context
+// keyed by resolved name. Code caches are kept per isolate keyed by resolved name, a module compiled again in another
+// context consumes the cache of the first compilation instead of parsing its source again. V8 can produce module code
+// caches only before evaluation, so they cover the eagerly compiled functions.
+//
+// Static and dynamic imports (import()) go through the same map. Modules imported by name are evaluated
+// synchronously, V8 8.5 has no top-level await by default.
+
+struct JSModuleSource {
+  v8::Local<v8::String> m_v8_source;
+  size_t m_source_hash;
+  // a code cache owned by the resolver, the map keeps its own code caches for sources coming without one
+  std::string_view m_code_cache;
+};
+
+class JSModuleResolver {
+ public:
+  virtual ~JSModuleResolver() = default;
+
+  // may throw JSException or py::error_already_set, the map turns them into JS exceptions
+  virtual std::string Resolve(const std::string& specifier, const std::string& referrer) const;
+  virtual std::string Load(const std::string& name) const;
+  // resolvers keeping sources in memory override this to hand them over without copies, see JSBundle
+  virtual JSModuleSource LoadModule(v8x::LockedIsolatePtr& v8_isolate, const std::string& name) const;
+};
+
+class PythonModuleResolver : public JSModuleResolver {
+  py::object m_py_resolve;
+  py::object m_py_load;
+
+ public:
+  PythonModuleResolver(py::object py_resolve, py::object py_load);
+  ~PythonModuleResolver() override;
+
+  std::string Resolve(const std::string& specifier, const std::string& referrer) const override;
+  std::string Load(const std::string& name) const override;
+};
+
+class JSModuleMap {
+  struct CodeCache {
+    size_t m_source_hash;
+    std::string m_data;
+  };
+
+  struct ContextModules {
+    std::unordered_map<std::string, v8::Global<v8::Module>> m_modules;
+    std::unordered_multimap<int, std::string> m_names_by_hash;  // module identity hash => resolved name
+  };
+
+  v8x::ProtectedIsolatePtr m_v8_isolate;
+  std::unique_ptr<JSModuleResolver> m_resolver;
+  std::unordered_map<const JSContext*, ContextModules> m_contexts;
+  std::unordered_map<std::string, CodeCache> m_code_caches;
+
+  uint64_t m_num_compiled{0};
+  uint64_t m_num_cache_hits{0};
+  uint64_t m_num_cache_rejects{0};
+
+  ContextModules& GetContextModules(v8::Local<v8::Context> v8_context);
+  v8::MaybeLocal<v8::Module> Lookup(v8x::LockedIsolatePtr& v8_isolate,
+                                    v8::Local<v8::Context> v8_context,
+                                    const std::string& name);
+
+ public:
+  explicit JSModuleMap(v8x::ProtectedIsolatePtr v8_isolate);
+  ~JSModuleMap();
+
+  static v8::MaybeLocal<v8::Module> ResolveCallback(v8::Local<v8::Context> v8_context,
+                                                    v8::Local<v8::String> v8_specifier,
+                                                    v8::Local<v8::Module> v8_referrer);
+  static v8::MaybeLocal<v8::Promise> ImportModuleDynamicallyCallback(v8::Local<v8::Context> v8_context,
+                                                                     v8::Local<v8::ScriptOrModule> v8_referrer,
+                                                                     v8::Local<v8::String> v8_specifier);
+  static void InitializeImportMetaCallback(v8::Local<v8::Context> v8_context,
+                                           v8::Local<v8::Module> v8_module,
+                                           v8::Local<v8::Object> v8_meta);
+
+  void SetResolver(std::unique_ptr<JSModuleResolver> resolver);
+  const JSModuleResolver& Resolver() const;
+
+  // these follow V8 conventions, errors are reported as pending JS exceptions and empty results
+  v8::MaybeLocal<v8::Module> Compile(v8x::LockedIsolatePtr& v8_isolate,
+                                     v8::Local<v8::Context> v8_context,
+                                     const std::string& name,
+                                     const JSModuleSource& source);
+  v8::MaybeLocal<v8::Module> Compile(v8x::LockedIsolatePtr& v8_isolate,
+                                     v8::Local<v8::Context> v8_context,
+                                     const std::string& name,
+                                     const std::string& source);
+  v8::MaybeLocal<v8::Module> Fetch(v8x::LockedIsolatePtr& v8_isolate,
+                                   v8::Local<v8::Context> v8_context,
+                                   const std::string& specifier,
+                                   const std::string& referrer);
+  v8::MaybeLocal<v8::Value> Evaluate(v8x::LockedIsolatePtr& v8_isolate,
+                                     v8::Local<v8::Context> v8_context,
+                                     v8::Local<v8::Module> v8_module);
+  v8::MaybeLocal<v8::Value> Import(v8x::LockedIsolatePtr& v8_isolate,
+                                   v8::Local<v8::Context> v8_context,
+                                   const std::string& specifier,
+                                   const std::string& referrer);
+
+  // returns empty string for modules not compiled by this map in the given context
+  std::string GetName(v8::Local<v8::Context> v8_context, v8::Local<v8::Module> v8_module) const;
+  void ForgetContext(const JSContext* context);
+
+  py::dict GetStats() const;
+};
+
+#endif
@@ -2,6 +2,7 @@
 #include "JSObjectUtils.h"
 #include "Logging.h"
 #include "Printing.h"
+#include "V8XUtils.h"
 
 #define TRACE(...) \
   LOGGER_INDENT;   \
@@ -9,6 +10,7 @@
 
 JSObject::JSObject(v8::Local<v8::Object> v8_obj) : m_roles(Roles::Generic), m_v8_obj(v8x::getCurrentIsolate(), v8_obj) {
   m_v8_obj.AnnotateStrongRetainer("Naga JSObject");
+  m_v8_obj.SetWrapperClassId(v8x::kJSObjectHandle);
 
   // detect supported object roles
   if (v8_obj->IsFunction()) {
@@ -80,6 +80,7 @@ class JSObject : public std::enable_shared_from_this<JSObject> {
   py::object Call(const py::args& py_args, const py::kwargs& py_kwargs);
   py::object Apply(const py::object& py_self, const py::list& py_args, const py::dict& py_kwds);
   py::object Invoke(const py::list& py_args, const py::dict& py_kwds);
+  py::object CallWithTimeout(double timeout, const py::list& py_args, const py::dict& py_kwds);
 
   [[nodiscard]] std::string GetName() const;
   void SetName(const std::string& name);
@@ -317,6 +317,18 @@ py::object JSObject::Invoke(const py::list& py_args, const py::dict& py_kwds) {
   return py_result;
 }
 
+py::object JSObject::CallWithTimeout(double timeout, const py::list& py_args, const py::dict& py_kwds) {
+  py::object py_result;
+  if (HasRoleFunction()) {
+    py_result = JSObjectFunctionCall(Self(), py_args, py_kwds, std::nullopt, timeout);
+  } else {
+    throw JSException("Expected JSObject with Function role", PyExc_TypeError);
+  }
+
+  TRACE("JSObject::CallWithTimeout {} timeout={} => {}", THIS, timeout, py_result);
+  return py_result;
+}
+
 std::string JSObject::GetName() const {
   std::string result;
   if (HasRoleFunction()) {
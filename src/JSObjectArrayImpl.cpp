@@ -56,7 +56,7 @@ py::object JSObjectArrayGetItem(const JSObject& self, const py::object& py_key)
     auto py_int = py::cast<py::int_>(py_key);
     uint32_t index = py_int;
 
-    if (index >= JSObjectArrayLength(self)) {
+    if (index >= v8_this_array->Length()) {
       throw JSException("index of of range", PyExc_IndexError);
     }
 
@@ -223,7 +223,7 @@ bool JSObjectArrayContains(const JSObject& self, const py::object& py_key) {
   auto v8_try_catch = v8x::withAutoTryCatch(v8_isolate);
   auto v8_this_array = self.ToV8(v8_isolate).As<v8::Array>();
 
-  for (py::ssize_t i = 0; i < JSObjectArrayLength(self); i++) {
+  for (uint32_t i = 0; i < v8_this_array->Length(); i++) {
     auto v8_maybe_val = v8_this_array->Get(v8_context, i);
     if (v8_maybe_val.IsEmpty()) {
       continue;
@@ -93,7 +93,6 @@ static bool isSentinel(v8::Local<v8::Value> v8_val) {
   }
 
   auto v8_isolate = v8x::getCurrentIsolate();
-  auto v8_scope = v8x::withScope(v8_isolate);
   auto v8_res_sym = v8::Local<v8::Symbol>::Cast(v8_val);
   auto v8_sentinel_name_key = v8::String::NewFromUtf8(v8_isolate, sentinel_name).ToLocalChecked();
   auto v8_sentinel = v8_res_sym->For(v8_isolate, v8_sentinel_name_key);
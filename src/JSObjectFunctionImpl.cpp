@@ -2,6 +2,8 @@
 #include "PythonUtils.h"
 #include "Wrapping.h"
 #include "JSObject.h"
+#include "JSIsolate.h"
+#include "JSWatchdog.h"
 #include "Logging.h"
 #include "Printing.h"
 
@@ -12,11 +14,15 @@
 py::object JSObjectFunctionCall(const JSObject& self,
                                 const py::list& py_args,
                                 const py::dict& py_kwargs,
-                                std::optional<v8::Local<v8::Object>> opt_v8_this) {
-  TRACE("JSObjectFunctionCall {} py_args={} py_kwargs={}", SELF, py_args, py_kwargs);
+                                std::optional<v8::Local<v8::Object>> opt_v8_this,
+                                double timeout) {
+  TRACE("JSObjectFunctionCall {} py_args={} py_kwargs={} timeout={}", SELF, py_args, py_kwargs, timeout);
   auto v8_isolate = v8x::getCurrentIsolate();
+  JSIsolate::FromV8(v8_isolate)->CheckOutOfMemory();
   auto v8_scope = v8x::withScope(v8_isolate);
   auto v8_context = v8x::getCurrentContext(v8_isolate);
+  // note the deadline must outlive the try catch
+  auto deadline = JSDeadline(v8_isolate, timeout);
   auto v8_try_catch = v8x::withAutoTryCatch(v8_isolate);
   auto v8_fn = self.ToV8(v8_isolate).As<v8::Function>();
 
@@ -55,6 +61,10 @@ py::object JSObjectFunctionCall(const JSObject& self,
     }
   }
 
+  // a terminated call (timeout, heap limit) leaves no result, the try catch raises when it goes out of scope
+  if (v8_maybe_result.IsEmpty()) {
+    return py::js_null();
+  }
   return wrap(v8_isolate, v8_maybe_result.ToLocalChecked());
 }
 
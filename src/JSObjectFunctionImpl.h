@@ -6,7 +6,8 @@
 py::object JSObjectFunctionCall(const JSObject& self,
                                 const py::list& py_args,
                                 const py::dict& py_kwargs,
-                                std::optional<v8::Local<v8::Object>> opt_v8_this = std::nullopt);
+                                std::optional<v8::Local<v8::Object>> opt_v8_this = std::nullopt,
+                                double timeout = 0);
 py::object JSObjectFunctionApply(const JSObject& self,
                                  const py::object& py_self,
                                  const py::list& py_args,
@@ -14,7 +14,7 @@ static void ensureAttrExistsOrThrow(v8x::LockedIsolatePtr& v8_isolate,
                                     v8::Local<v8::String> v8_name) {
   TRACE("ensureAttrExistsOrThrow v8_name={} v8_this={}", v8_name, v8_this);
   assert(v8_isolate->InContext());
-  auto v8_scope = v8x::withScope(v8_isolate);
+  // our callers hold a handle scope
   auto v8_context = v8x::getCurrentContext(v8_isolate);
 
   auto hasName = v8_this->Has(v8_context, v8_name).FromMaybe(false);
@@ -1,6 +1,17 @@
 #include "JSPlatform.h"
+#include "JSIsolate.h"
+#include "V8XPlatform.h"
 #include "Logging.h"
 #include "Printing.h"
+#include "PythonUtils.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
 
 #define TRACE(...) \
   LOGGER_INDENT;   \
@@ -12,19 +23,58 @@ constexpr auto singleton_invariants = !std::is_constructible<JSPlatform>::value
                                       !std::is_swappable<JSPlatform>::value;                 //
 static_assert(singleton_invariants, "JSPlatform should be a singleton.");
 
+// polling interval of PumpMessageLoop waiting for work, it backs off while nothing gets posted
+static constexpr std::chrono::microseconds kPumpMinDelay{100};
+static constexpr std::chrono::microseconds kPumpMaxDelay{10000};
+
+static void validateCpuAffinity(const std::vector<int>& cpu_affinity) {
+#if defined(__linux__)
+  if (cpu_affinity.empty()) {
+    return;
+  }
+  // CPU_SET does no bounds checking, and the kernel silently ignores CPUs the process cannot run on
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  auto have_allowed = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+  for (auto cpu : cpu_affinity) {
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+      throw py::value_error(fmt::format("CPU {} in cpu_affinity is out of range [0, {}).", cpu, CPU_SETSIZE));
+    }
+    if (have_allowed && !CPU_ISSET(cpu, &allowed)) {
+      throw py::value_error(fmt::format("CPU {} in cpu_affinity is not online or not available to this process.", cpu));
+    }
+  }
+#endif
+}
+
 JSPlatform* JSPlatform::Instance() {
   static JSPlatform g_platform;
   TRACE("JSPlatform::Instance => {}", (void*)&g_platform);
   return &g_platform;
 }
 
-bool JSPlatform::Init(std::string argv) {
-  TRACE("JSPlatform::Init {} argv='{}'", THIS, argv);
+bool JSPlatform::Init(std::string argv,
+                      int worker_threads,
+                      std::vector<int> cpu_affinity,
+                      bool idle_tasks,
+                      int best_effort_limit,
+                      bool single_threaded) {
+  TRACE(
+      "JSPlatform::Init {} argv='{}' worker_threads={} cpu_affinity={} idle_tasks={} best_effort_limit={} "
+      "single_threaded={}",
+      THIS, argv, worker_threads, cpu_affinity.size(), idle_tasks, best_effort_limit, single_threaded);
   if (m_initialized) {
     TRACE("JSPlatform::Init {} => [already initialized]", THIS);
     return false;
   }
 
+  auto use_custom_platform = worker_threads > 0 || !cpu_affinity.empty() || best_effort_limit > 0;
+  if (single_threaded && use_custom_platform) {
+    // note V8 is not initialized yet, so we cannot use JSException here
+    throw py::value_error("Worker pool options cannot be combined with single_threaded platform.");
+  }
+  validateCpuAffinity(cpu_affinity);
+
 #ifndef NDEBUG
   v8::V8::SetFlagsFromString("--expose-gc --allow-natives-syntax --track-retaining-path");
 #endif
@@ -33,11 +83,91 @@ bool JSPlatform::Init(std::string argv) {
   v8::V8::InitializeICU();
   v8::V8::InitializeExternalStartupData(argv.c_str());
 
-  m_v8_platform = v8::platform::NewDefaultPlatform();
+  auto idle_task_support = idle_tasks ? v8::platform::IdleTaskSupport::kEnabled  //
+                                      : v8::platform::IdleTaskSupport::kDisabled;
+  if (single_threaded) {
+    // no background threads at all => the process can be safely forked after V8 initialization,
+    // V8 flags must be set before the platform gets initialized
+    v8::V8::SetFlagsFromString("--single-threaded");
+    m_v8_platform = v8::platform::NewSingleThreadedDefaultPlatform(idle_task_support);
+    m_v8_default_platform = m_v8_platform.get();
+  } else if (use_custom_platform) {
+    auto config = v8x::WorkerPoolConfig{worker_threads, std::move(cpu_affinity), best_effort_limit};
+    auto platform = std::make_unique<v8x::Platform>(std::move(config), idle_tasks);
+    m_custom_platform = platform.get();
+    m_v8_default_platform = platform->DefaultPlatform();
+    m_v8_platform = std::move(platform);
+  } else {
+    m_v8_platform = v8::platform::NewDefaultPlatform(0, idle_task_support);
+    m_v8_default_platform = m_v8_platform.get();
+  }
 
   v8::V8::InitializePlatform(m_v8_platform.get());
   v8::V8::Initialize();
 
+  m_single_threaded = single_threaded;
   m_initialized = true;
   return true;
-}
\ No newline at end of file
+}
+
+int JSPlatform::NumberOfWorkerThreads() const {
+  if (!m_initialized) {
+    return 0;
+  }
+  return m_v8_platform->NumberOfWorkerThreads();
+}
+
+void JSPlatform::CallOnWorkerThread(std::unique_ptr<v8::Task> task) const {
+  TRACE("JSPlatform::CallOnWorkerThread {} task={}", THIS, (void*)task.get());
+  assert(m_initialized && !m_single_threaded);
+  m_v8_platform->CallOnWorkerThread(std::move(task));
+}
+
+py::object JSPlatform::GetWorkerStats() const {
+  if (!m_custom_platform) {
+    return py::none();
+  }
+  return m_custom_platform->Workers().GetStats();
+}
+
+std::shared_ptr<v8::TaskRunner> JSPlatform::GetForegroundTaskRunner(v8::Isolate* v8_isolate) const {
+  assert(m_initialized);
+  return m_v8_default_platform->GetForegroundTaskRunner(v8_isolate);
+}
+
+bool JSPlatform::PumpMessageLoop(const SharedJSIsolatePtr& isolate, bool wait) const {
+  TRACE("JSPlatform::PumpMessageLoop {} isolate={} wait={}", THIS, (void*)isolate.get(), wait);
+  if (!m_initialized) {
+    throw JSException("Platform is not initialized.", PyExc_RuntimeError);
+  }
+  // tasks run JS (e.g. onmessage handlers) and waiting may take a while, other Python threads should not be blocked
+  auto _ = pyu::withoutGIL();
+  // kWaitForWork would block with the isolate lock held, and posting the awaited task may itself need that lock
+  // libplatform has no public way to wait for a task without running it, so we poll and drop the lock in between
+  // (unless the caller holds the lock already)
+  auto delay = kPumpMinDelay;
+  while (true) {
+    {
+      auto v8_isolate = isolate->ToV8();
+      auto behavior = v8::platform::MessageLoopBehavior::kDoNotWait;
+      if (v8::platform::PumpMessageLoop(m_v8_default_platform, v8_isolate, behavior)) {
+        return true;
+      }
+    }
+    if (!wait) {
+      return false;
+    }
+    std::this_thread::sleep_for(delay);
+    delay = std::min(delay * 2, kPumpMaxDelay);
+  }
+}
+
+void JSPlatform::RunIdleTasks(const SharedJSIsolatePtr& isolate, double idle_time_in_seconds) const {
+  TRACE("JSPlatform::RunIdleTasks {} isolate={} idle_time_in_seconds={}", THIS, (void*)isolate.get(),
+        idle_time_in_seconds);
+  if (!m_initialized) {
+    throw JSException("Platform is not initialized.", PyExc_RuntimeError);
+  }
+  auto v8_isolate = isolate->ToV8();
+  v8::platform::RunIdleTasks(m_v8_default_platform, v8_isolate, idle_time_in_seconds);
+}
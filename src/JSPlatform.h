@@ -3,10 +3,23 @@
 
 #include "Base.h"
 
+// JSPlatform owns the v8::Platform instance.
+//
+// By default we use V8's default platform. When worker options are passed to Init we install our v8x::Platform instead,
+// which runs background tasks (concurrent GC, off-thread compilation, ...) on a configurable v8x::WorkerPool.
+// In both cases m_v8_default_platform points to the default platform responsible for foreground and idle tasks.
+//
+// In single-threaded mode we use NewSingleThreadedDefaultPlatform and V8 runs with --single-threaded, so V8 starts
+// no background threads. This allows pre-fork servers to initialize V8 and warm up isolates in the master process and
+// let forked workers share those pages copy-on-write.
+
 class JSPlatform {
  private:
   bool m_initialized{false};
+  bool m_single_threaded{false};
   std::unique_ptr<v8::Platform> m_v8_platform;
+  v8::Platform* m_v8_default_platform{nullptr};
+  v8x::Platform* m_custom_platform{nullptr};
 
   // CPlatform is a singleton => make the constructor private, disable copy/move
  private:
@@ -21,7 +34,22 @@ class JSPlatform {
   static JSPlatform* Instance();
 
   bool Initialized() const { return m_initialized; }
-  bool Init(std::string argv);
+  bool Init(std::string argv,
+            int worker_threads = 0,
+            std::vector<int> cpu_affinity = {},
+            bool idle_tasks = false,
+            int best_effort_limit = 0,
+            bool single_threaded = false);
+  bool SingleThreaded() const { return m_single_threaded; }
+
+  int NumberOfWorkerThreads() const;
+  py::object GetWorkerStats() const;
+
+  std::shared_ptr<v8::TaskRunner> GetForegroundTaskRunner(v8::Isolate* v8_isolate) const;
+  // not available in single-threaded mode, callers run such tasks on their own thread instead
+  void CallOnWorkerThread(std::unique_ptr<v8::Task> task) const;
+  bool PumpMessageLoop(const SharedJSIsolatePtr& isolate, bool wait) const;
+  void RunIdleTasks(const SharedJSIsolatePtr& isolate, double idle_time_in_seconds) const;
 };
 
 #endif
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "JSEngine.h"
 #include "Logging.h"
 #include "Printing.h"
+#include "V8XUtils.h"
 
 #define TRACE(...) \
   LOGGER_INDENT;   \
@@ -20,6 +21,7 @@ JSScript::JSScript(v8x::ProtectedIsolatePtr v8_protected_isolate,
 
   m_v8_script.Reset(v8_isolate, v8_script);
   m_v8_script.AnnotateStrongRetainer("Naga JSScript.m_v8_script");
+  m_v8_script.SetWrapperClassId(v8x::kJSScriptHandle);
 
   TRACE("JSScript::JSScript {} v8_isolate={} engine={} v8_source={} v8_script={}", THIS, P$(v8_isolate), engine,
         traceMore(v8_source), v8_script);
@@ -54,11 +56,11 @@ std::string JSScript::GetSource() const {
   return result;
 }
 
-py::object JSScript::Run() const {
-  TRACE("JSScript::Run {}", THIS);
+py::object JSScript::Run(double timeout) const {
+  TRACE("JSScript::Run {} timeout={}", THIS, timeout);
   auto v8_isolate = m_v8_isolate.lock();
   auto v8_scope = v8x::withScope(v8_isolate);
-  auto result = m_engine.ExecuteScript(Script());
+  auto result = m_engine.ExecuteScript(Script(), timeout);
   TRACE("JSScript::Run {} => {}", THIS, result);
   return result;
 }
@@ -21,7 +21,7 @@ class JSScript {
   [[nodiscard]] v8::Local<v8::Script> Script() const;
 
   [[nodiscard]] std::string GetSource() const;
-  py::object Run() const;
+  py::object Run(double timeout = 0) const;
 
   void Dump(std::ostream& os) const;
 };
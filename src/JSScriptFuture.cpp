@@ -0,0 +1,117 @@
+#include "JSScriptFuture.h"
+#include "JSScriptStreamer.h"
+#include "JSEngine.h"
+#include "JSIsolate.h"
+#include "JSException.h"
+#include "PythonUtils.h"
+#include "Logging.h"
+#include "Printing.h"
+
+#define TRACE(...) \
+  LOGGER_INDENT;   \
+  SPDLOG_LOGGER_TRACE(getLogger(kJSScriptLogger), __VA_ARGS__)
+
+JSScriptFuture::JSScriptFuture(v8x::LockedIsolatePtr& v8_isolate,
+                               const JSEngine& engine,
+                               std::unique_ptr<JSScriptStreamer> streamer,
+                               std::string name,
+                               int line,
+                               int col)
+    : m_engine(engine),
+      m_isolate(JSIsolate::FromV8(v8_isolate)),
+      m_v8_isolate(v8_isolate),
+      m_name(std::move(name)),
+      m_line(line),
+      m_col(col),
+      m_streamer(std::move(streamer)) {
+  TRACE("JSScriptFuture::JSScriptFuture {} name={} line={} col={}", THIS, m_name, m_line, m_col);
+}
+
+JSScriptFuture::~JSScriptFuture() {
+  TRACE("JSScriptFuture::~JSScriptFuture {}", THIS);
+  if (m_streamer) {
+    auto _ = pyu::withoutGIL();
+    m_streamer.reset();
+  }
+}
+
+const std::string& JSScriptFuture::GetName() const {
+  return m_name;
+}
+
+std::shared_ptr<JSScriptStreamer> JSScriptFuture::GetStreamer() const {
+  std::lock_guard lock(m_mutex);
+  return m_streamer;
+}
+
+bool JSScriptFuture::Done() const {
+  // the streamer is gone once finalization has started, which happens only after the background work is done
+  auto streamer = GetStreamer();
+  auto result = !streamer || streamer->IsDone();
+  TRACE("JSScriptFuture::Done {} => {}", THIS, result);
+  return result;
+}
+
+bool JSScriptFuture::Wait(double timeout) const {
+  TRACE("JSScriptFuture::Wait {} timeout={}", THIS, timeout);
+  auto streamer = GetStreamer();
+  if (!streamer) {
+    return true;
+  }
+  auto _ = pyu::withoutGIL();
+  return streamer->Wait(timeout);
+}
+
+SharedJSScriptPtr JSScriptFuture::Result(double timeout) {
+  TRACE("JSScriptFuture::Result {} timeout={}", THIS, timeout);
+  if (!Wait(timeout)) {
+    throw JSException(fmt::format("Background compilation of '{}' did not finish in {}s", m_name, timeout),
+                      PyExc_TimeoutError);
+  }
+
+  // lock the isolate before taking the GIL back, the thread finalizing below holds the isolate lock while it waits
+  // for the GIL, so anybody blocking on the isolate lock with the GIL held would deadlock with it
+  auto v8_isolate = [this] {
+    auto _ = pyu::withoutGIL();
+    return m_v8_isolate.lock();
+  }();
+
+  // V8 finalizes a streamed source only once, the first caller takes the streamer and the others wait for it
+  std::shared_ptr<JSScriptStreamer> streamer;
+  {
+    auto _ = pyu::withoutGIL();
+    std::unique_lock lock(m_mutex);
+    m_finalized_cv.wait(lock, [this] { return !m_finalizing; });
+    if (m_streamer) {
+      m_finalizing = true;
+      streamer = std::move(m_streamer);
+    }
+  }
+  if (!streamer) {
+    std::lock_guard lock(m_mutex);
+    if (m_error) {
+      std::rethrow_exception(m_error);
+    }
+    return m_script;
+  }
+
+  SharedJSScriptPtr script;
+  std::exception_ptr error;
+  try {
+    script = m_engine.CompileStreamed(v8_isolate, *streamer, m_name, m_line, m_col);
+  } catch (...) {
+    error = std::current_exception();
+  }
+  {
+    std::lock_guard lock(m_mutex);
+    m_script = script;
+    m_error = error;
+    m_finalizing = false;
+  }
+  m_finalized_cv.notify_all();
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  return script;
+}
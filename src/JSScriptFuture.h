@@ -0,0 +1,52 @@
+#ifndef NAGA_JSSCRIPTFUTURE_H_
+#define NAGA_JSSCRIPTFUTURE_H_
+
+#include "Base.h"
+#include "V8XProtectedIsolate.h"
+
+#include <condition_variable>
+#include <mutex>
+
+// JSScriptFuture is returned by JSEngine.compile_async. The source is handed to a JSScriptStreamer at once, so V8
+// parses and compiles it on a platform worker thread while the caller goes on, possibly starting more compilations.
+//
+// result() waits for the background work without the GIL and finalizes the script on the calling thread,
+// which must be able to lock the isolate and have a current context. The outcome is remembered, later calls return
+// the same JSScript or raise the same error. When several threads call result() at once, the first one finalizes
+// and the others wait for its outcome. m_mutex guards only short sections, nobody waits for the GIL while holding it.
+//
+// Futures keep their isolate alive, dropping an unfinished future blocks until its worker task is done.
+
+class JSScriptFuture {
+  const JSEngine& m_engine;
+  SharedJSIsolatePtr m_isolate;
+  v8x::ProtectedIsolatePtr m_v8_isolate;
+  std::string m_name;
+  int m_line;
+  int m_col;
+
+  mutable std::mutex m_mutex;
+  std::condition_variable m_finalized_cv;
+  std::shared_ptr<JSScriptStreamer> m_streamer;
+  bool m_finalizing{false};
+  SharedJSScriptPtr m_script;
+  std::exception_ptr m_error;
+
+  std::shared_ptr<JSScriptStreamer> GetStreamer() const;
+
+ public:
+  JSScriptFuture(v8x::LockedIsolatePtr& v8_isolate,
+                 const JSEngine& engine,
+                 std::unique_ptr<JSScriptStreamer> streamer,
+                 std::string name,
+                 int line,
+                 int col);
+  ~JSScriptFuture();
+
+  [[nodiscard]] const std::string& GetName() const;
+  [[nodiscard]] bool Done() const;
+  bool Wait(double timeout = 0) const;
+  SharedJSScriptPtr Result(double timeout = 0);
+};
+
+#endif
@@ -0,0 +1,129 @@
+#include "JSScriptStreamer.h"
+#include "JSPlatform.h"
+#include "Logging.h"
+#include "Printing.h"
+
+#include <cstring>
+
+#define TRACE(...) \
+  LOGGER_INDENT;   \
+  SPDLOG_LOGGER_TRACE(getLogger(kJSScriptLogger), __VA_ARGS__)
+
+class JSScriptStreamer::SourceStream : public v8::ScriptCompiler::ExternalSourceStream {
+  JSScriptStreamer& m_streamer;
+
+ public:
+  explicit SourceStream(JSScriptStreamer& streamer) : m_streamer(streamer) {}
+
+  size_t GetMoreData(const uint8_t** src) override { return m_streamer.PopChunk(src); }
+};
+
+class JSScriptStreamer::StreamingTask : public v8::Task {
+  JSScriptStreamer& m_streamer;
+
+ public:
+  explicit StreamingTask(JSScriptStreamer& streamer) : m_streamer(streamer) {}
+
+  void Run() override { m_streamer.RunTask(); }
+};
+
+JSScriptStreamer::JSScriptStreamer(v8::Isolate* v8_isolate)
+    : m_v8_streamed_source(std::make_unique<SourceStream>(*this), v8::ScriptCompiler::StreamedSource::UTF8) {
+  TRACE("JSScriptStreamer::JSScriptStreamer {} v8_isolate={}", THIS, (void*)v8_isolate);
+  m_v8_task.reset(v8::ScriptCompiler::StartStreamingScript(v8_isolate, &m_v8_streamed_source));
+  auto platform = JSPlatform::Instance();
+  if (!platform->SingleThreaded()) {
+    m_task_posted = true;
+    platform->CallOnWorkerThread(std::make_unique<StreamingTask>(*this));
+  }
+}
+
+JSScriptStreamer::~JSScriptStreamer() {
+  TRACE("JSScriptStreamer::~JSScriptStreamer {}", THIS);
+  Finish();
+  Wait();
+}
+
+void JSScriptStreamer::Push(std::string_view chunk) {
+  TRACE("JSScriptStreamer::Push {} size={}", THIS, chunk.size());
+  if (chunk.empty()) {
+    return;
+  }
+  m_source.append(chunk);
+
+  // V8 takes ownership of the chunks it gets from GetMoreData and deletes them with delete[]
+  auto data = std::make_unique<uint8_t[]>(chunk.size());
+  std::memcpy(data.get(), chunk.data(), chunk.size());
+  {
+    std::lock_guard lock(m_mutex);
+    assert(!m_finished);
+    m_chunks.push_back({std::move(data), chunk.size()});
+  }
+  m_cv.notify_all();
+}
+
+void JSScriptStreamer::Finish() {
+  TRACE("JSScriptStreamer::Finish {}", THIS);
+  {
+    std::lock_guard lock(m_mutex);
+    m_finished = true;
+  }
+  m_cv.notify_all();
+}
+
+bool JSScriptStreamer::Wait(double timeout) {
+  TRACE("JSScriptStreamer::Wait {} timeout={}", THIS, timeout);
+  if (!m_task_posted) {
+    assert(m_finished);
+    if (!IsDone()) {
+      RunTask();
+    }
+    return true;
+  }
+  std::unique_lock lock(m_mutex);
+  auto task_done = [this] { return m_task_done; };
+  if (timeout <= 0) {
+    m_cv.wait(lock, task_done);
+    return true;
+  }
+  return m_cv.wait_for(lock, std::chrono::duration<double>(timeout), task_done);
+}
+
+bool JSScriptStreamer::IsDone() {
+  std::lock_guard lock(m_mutex);
+  return m_task_done;
+}
+
+size_t JSScriptStreamer::PopChunk(const uint8_t** src) {
+  std::unique_lock lock(m_mutex);
+  m_cv.wait(lock, [this] { return !m_chunks.empty() || m_finished; });
+  if (m_chunks.empty()) {
+    TRACE("JSScriptStreamer::PopChunk {} => [end of stream]", THIS);
+    return 0;
+  }
+  auto chunk = std::move(m_chunks.front());
+  m_chunks.pop_front();
+  TRACE("JSScriptStreamer::PopChunk {} => size={}", THIS, chunk.m_size);
+  *src = chunk.m_data.release();
+  return chunk.m_size;
+}
+
+void JSScriptStreamer::RunTask() {
+  TRACE("JSScriptStreamer::RunTask {}", THIS);
+  if (m_v8_task) {
+    m_v8_task->Run();
+  }
+  {
+    std::lock_guard lock(m_mutex);
+    m_task_done = true;
+  }
+  m_cv.notify_all();
+}
+
+v8::MaybeLocal<v8::Script> JSScriptStreamer::Compile(v8::Local<v8::Context> v8_context,
+                                                     v8::Local<v8::String> v8_source,
+                                                     const v8::ScriptOrigin& v8_origin) {
+  TRACE("JSScriptStreamer::Compile {} source_size={}", THIS, m_source.size());
+  assert(m_task_done);
+  return v8::ScriptCompiler::Compile(v8_context, &m_v8_streamed_source, v8_source, v8_origin);
+}
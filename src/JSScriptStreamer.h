@@ -0,0 +1,67 @@
+#ifndef NAGA_JSSCRIPTSTREAMER_H_
+#define NAGA_JSSCRIPTSTREAMER_H_
+
+#include "Base.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string_view>
+
+// JSScriptStreamer compiles a classic script with V8's streaming compiler while its source is still arriving.
+//
+// The owner pushes UTF-8 chunks as they come (split multi-byte characters are fine) and finishes the stream.
+// Meanwhile a ScriptStreamingTask running on a platform worker thread pulls the chunks and parses them, the parser
+// never touches the GIL or the isolate heap. Once Wait returns, Compile finalizes the script on the isolate thread.
+// In single-threaded mode there are no worker threads, the task runs inside Wait after the stream has been finished.
+//
+// V8 8.5 wants the complete source string for finalization, so the streamer also keeps a copy of all chunks.
+//
+// The destructor finishes the stream and waits for the task, the isolate must outlive the streamer.
+
+class JSScriptStreamer {
+  class SourceStream;
+  class StreamingTask;
+
+  struct Chunk {
+    std::unique_ptr<uint8_t[]> m_data;
+    size_t m_size;
+  };
+
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::deque<Chunk> m_chunks;
+  bool m_finished{false};
+  bool m_task_done{false};
+  bool m_task_posted{false};
+
+  std::string m_source;
+  v8::ScriptCompiler::StreamedSource m_v8_streamed_source;
+  std::unique_ptr<v8::ScriptCompiler::ScriptStreamingTask> m_v8_task;
+
+  size_t PopChunk(const uint8_t** src);
+  void RunTask();
+
+ public:
+  explicit JSScriptStreamer(v8::Isolate* v8_isolate);
+  ~JSScriptStreamer();
+
+  JSScriptStreamer(const JSScriptStreamer&) = delete;
+  JSScriptStreamer& operator=(const JSScriptStreamer&) = delete;
+
+  void Push(std::string_view chunk);
+  void Finish();
+  // blocks until the background parse is done or timeout (in seconds, 0 means none) expires, call it without the GIL
+  bool Wait(double timeout = 0);
+  [[nodiscard]] bool IsDone();
+
+  [[nodiscard]] const std::string& GetSource() const { return m_source; }
+
+  // follows V8 conventions, errors are reported as a pending JS exception and an empty result
+  v8::MaybeLocal<v8::Script> Compile(v8::Local<v8::Context> v8_context,
+                                     v8::Local<v8::String> v8_source,
+                                     const v8::ScriptOrigin& v8_origin);
+};
+
+#endif
@@ -0,0 +1,343 @@
+#include "JSSharedBuffer.h"
+#include "JSContext.h"
+#include "JSIsolate.h"
+#include "JSException.h"
+#include "Wrapping.h"
+#include "Logging.h"
+#include "Printing.h"
+#include "PythonUtils.h"
+#include "V8XUtils.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <limits>
+#include <list>
+#include <mutex>
+
+#define TRACE(...) \
+  LOGGER_INDENT;   \
+  SPDLOG_LOGGER_TRACE(getLogger(kJSSharedMemoryLogger), __VA_ARGS__)
+
+struct PythonBufferHolder {
+  Py_buffer m_view;
+};
+
+static int releasePythonBuffer(void* data) {
+  // called with the GIL held
+  auto holder = static_cast<PythonBufferHolder*>(data);
+  PyBuffer_Release(&holder->m_view);
+  delete holder;
+  return 0;
+}
+
+static void backingStoreDeleter(void* /* data */, size_t /* length */, void* deleter_data) {
+  TRACE("backingStoreDeleter deleter_data={}", deleter_data);
+  // V8 may sweep array buffers on a background thread, we must not touch Python objects without the GIL there
+  if (PyGILState_Check()) {
+    releasePythonBuffer(deleter_data);
+    return;
+  }
+  if (Py_AddPendingCall(releasePythonBuffer, deleter_data) != 0) {
+    SPDLOG_WARN("unable to schedule release of a Python buffer shared with V8, leaking it");
+  }
+}
+
+// Waiters are keyed by slot address, so they meet regardless of which isolate or which JSSharedBuffer (or plain
+// SharedArrayBuffer) they came through. A single process-wide mutex is fine, waits and notifies are rare compared to
+// plain atomic operations, which never touch it.
+
+struct PythonWaiter {
+  void* m_address;
+  std::condition_variable m_cv;
+  bool m_notified{false};
+};
+
+struct JSWaiter {
+  void* m_address;
+  v8::Isolate::AtomicsWaitWakeHandle* m_wake_handle;
+};
+
+static std::mutex g_waiters_mutex;
+static std::list<PythonWaiter*> g_python_waiters;
+static std::list<JSWaiter> g_js_waiters;
+
+static int notifyPythonWaiters(void* address, int count) {
+  // expects g_waiters_mutex to be held
+  auto woken = 0;
+  for (auto it = g_python_waiters.begin(); it != g_python_waiters.end() && woken < count;) {
+    auto waiter = *it;
+    if (waiter->m_address != address) {
+      ++it;
+      continue;
+    }
+    waiter->m_notified = true;
+    waiter->m_cv.notify_one();
+    it = g_python_waiters.erase(it);
+    woken++;
+  }
+  return woken;
+}
+
+static int notifyJSWaiters(void* address, int count) {
+  // expects g_waiters_mutex to be held
+  auto woken = 0;
+  for (auto it = g_js_waiters.begin(); it != g_js_waiters.end() && woken < count;) {
+    if (it->m_address != address) {
+      ++it;
+      continue;
+    }
+    it->m_wake_handle->Wake();
+    it = g_js_waiters.erase(it);
+    woken++;
+  }
+  return woken;
+}
+
+void JSSharedBuffer::AtomicsWaitCallback(v8::Isolate::AtomicsWaitEvent event,
+                                         v8::Local<v8::SharedArrayBuffer> v8_array_buffer,
+                                         size_t offset_in_bytes,
+                                         int64_t /* value */,
+                                         double /* timeout_in_ms */,
+                                         v8::Isolate::AtomicsWaitWakeHandle* wake_handle,
+                                         void* /* data */) {
+  auto address = static_cast<uint8_t*>(v8_array_buffer->GetBackingStore()->Data()) + offset_in_bytes;
+  TRACE("JSSharedBuffer::AtomicsWaitCallback event={} address={}", magic_enum::enum_name(event), (void*)address);
+  std::lock_guard<std::mutex> lock(g_waiters_mutex);
+  if (event == v8::Isolate::AtomicsWaitEvent::kStartWait) {
+    g_js_waiters.push_back(JSWaiter{address, wake_handle});
+    return;
+  }
+  // the wait is over for whatever reason, the wake handle is no longer valid
+  g_js_waiters.remove_if([wake_handle](const JSWaiter& waiter) { return waiter.m_wake_handle == wake_handle; });
+}
+
+static void atomicsNotifyCallback(const v8::FunctionCallbackInfo<v8::Value>& v8_info) {
+  TRACE("atomicsNotifyCallback v8_info={}", v8_info);
+  auto v8_isolate = v8x::lockIsolate(v8_info.GetIsolate());
+  auto v8_context = v8_isolate->GetCurrentContext();
+
+  // let the original Atomics.notify validate arguments and wake JS waiters
+  std::vector<v8::Local<v8::Value>> v8_args;
+  v8_args.reserve(v8_info.Length());
+  for (auto i = 0; i < v8_info.Length(); i++) {
+    v8_args.push_back(v8_info[i]);
+  }
+  auto v8_original = v8_info.Data().As<v8::Function>();
+  v8::Local<v8::Value> v8_result;
+  if (!v8_original->Call(v8_context, v8_info.This(), static_cast<int>(v8_args.size()), v8_args.data())
+           .ToLocal(&v8_result)) {
+    return;
+  }
+  v8_info.GetReturnValue().Set(v8_result);
+
+  // only Int32Array slots can have Python waiters
+  if (!v8_info[0]->IsInt32Array() || !v8_result->IsInt32()) {
+    return;
+  }
+  auto v8_array = v8_info[0].As<v8::Int32Array>();
+  int64_t index = 0;
+  if (!v8_info[1]->IntegerValue(v8_context).To(&index)) {
+    return;
+  }
+  auto count = std::numeric_limits<int>::max();
+  if (v8_info.Length() > 2 && !v8_info[2]->IsUndefined()) {
+    double raw_count = 0;
+    if (!v8_info[2]->NumberValue(v8_context).To(&raw_count)) {
+      return;
+    }
+    // like Atomics.notify itself: NaN counts as 0, the rest is clamped before the conversion
+    if (std::isnan(raw_count)) {
+      raw_count = 0;
+    }
+    raw_count = std::clamp(std::trunc(raw_count), 0.0, static_cast<double>(count));
+    count = static_cast<int>(raw_count);
+  }
+
+  auto js_woken = v8_result.As<v8::Int32>()->Value();
+  if (js_woken >= count) {
+    return;
+  }
+  auto address = static_cast<uint8_t*>(v8_array->Buffer()->GetBackingStore()->Data()) + v8_array->ByteOffset() +
+                 index * sizeof(int32_t);
+  int py_woken;
+  {
+    std::lock_guard<std::mutex> lock(g_waiters_mutex);
+    py_woken = notifyPythonWaiters(address, count - js_woken);
+  }
+  TRACE("atomicsNotifyCallback address={} js_woken={} py_woken={}", (void*)address, js_woken, py_woken);
+  v8_info.GetReturnValue().Set(js_woken + py_woken);
+}
+
+static void installAtomicsBridge(v8x::LockedIsolatePtr& v8_isolate, v8::Local<v8::Context> v8_context) {
+  TRACE("installAtomicsBridge v8_isolate={} v8_context={}", P$(v8_isolate), v8_context);
+  auto v8_global = v8_context->Global();
+  v8::Local<v8::Value> v8_atomics_value;
+  if (!v8_global->Get(v8_context, v8x::toString(v8_isolate, "Atomics")).ToLocal(&v8_atomics_value) ||
+      !v8_atomics_value->IsObject()) {
+    return;
+  }
+  auto v8_atomics = v8_atomics_value.As<v8::Object>();
+
+  // the bridge is installed once per context, no matter how many buffers get installed
+  auto v8_marker = v8::Private::ForApi(v8_isolate, v8x::toString(v8_isolate, "naga::AtomicsBridge"));
+  if (v8_atomics->HasPrivate(v8_context, v8_marker).FromMaybe(true)) {
+    return;
+  }
+
+  auto v8_notify_key = v8x::toString(v8_isolate, "notify");
+  v8::Local<v8::Value> v8_original;
+  if (!v8_atomics->Get(v8_context, v8_notify_key).ToLocal(&v8_original) || !v8_original->IsFunction()) {
+    return;
+  }
+  auto v8_fn = v8::Function::New(v8_context, atomicsNotifyCallback, v8_original, 3).ToLocalChecked();
+  v8_fn->SetName(v8_notify_key);
+  v8_atomics->DefineOwnProperty(v8_context, v8_notify_key, v8_fn, v8::DontEnum).Check();
+  v8_atomics->SetPrivate(v8_context, v8_marker, v8::True(v8_isolate)).Check();
+}
+
+JSSharedBuffer::JSSharedBuffer(const py::object& py_source) {
+  TRACE("JSSharedBuffer::JSSharedBuffer {} py_source={}", THIS, py_source);
+  m_py_owner = py_source;
+  if (py::isinstance<py::int_>(py_source)) {
+    // just a size, allocate zeroed memory owned by a bytearray
+    auto size = py_source.cast<Py_ssize_t>();
+    if (size < 0) {
+      throw py::value_error("size of shared buffer must not be negative");
+    }
+    m_py_owner = py::reinterpret_steal<py::object>(PyByteArray_FromStringAndSize(nullptr, size));
+    if (!m_py_owner) {
+      throw py::error_already_set();
+    }
+    std::memset(PyByteArray_AS_STRING(m_py_owner.ptr()), 0, size);
+  }
+
+  // the view pins the memory (e.g. an mmap cannot be closed or a bytearray resized) until V8 lets it go
+  auto holder = new PythonBufferHolder();
+  if (PyObject_GetBuffer(m_py_owner.ptr(), &holder->m_view, PyBUF_CONTIG) != 0) {
+    delete holder;
+    throw py::error_already_set();
+  }
+
+  auto backing_store = v8::SharedArrayBuffer::NewBackingStore(holder->m_view.buf, holder->m_view.len,
+                                                             backingStoreDeleter, holder);
+  m_backing_store = std::move(backing_store);
+}
+
+JSSharedBuffer::~JSSharedBuffer() {
+  TRACE("JSSharedBuffer::~JSSharedBuffer {}", THIS);
+}
+
+size_t JSSharedBuffer::Size() const {
+  return m_backing_store->ByteLength();
+}
+
+py::object JSSharedBuffer::GetOwner() const {
+  return m_py_owner;
+}
+
+py::object JSSharedBuffer::GetMemoryView() const {
+  auto py_result = py::memoryview(m_py_owner).attr("cast")("B");
+  TRACE("JSSharedBuffer::GetMemoryView {} => {}", THIS, py_result);
+  return py_result;
+}
+
+void JSSharedBuffer::Install(const SharedJSContextPtr& context, const std::string& name) const {
+  TRACE("JSSharedBuffer::Install {} context={} name={}", THIS, context, name);
+  if (!context) {
+    throw py::value_error("context must not be None");
+  }
+
+  // the context might live in another isolate than the current one
+  auto isolate = context->GetIsolate();
+  auto v8_isolate = isolate->ToV8();
+  auto v8_isolate_scope = v8::Isolate::Scope(v8_isolate);
+  auto v8_scope = v8x::withScope(v8_isolate);
+  auto v8_context = context->ToV8();
+  auto v8_context_scope = v8x::withContext(v8_context);
+
+  installAtomicsBridge(v8_isolate, v8_context);
+  auto v8_buffer = v8::SharedArrayBuffer::New(v8_isolate, m_backing_store);
+  v8_context->Global()->Set(v8_context, v8x::toString(v8_isolate, name), v8_buffer).Check();
+}
+
+py::object JSSharedBuffer::ToJS() const {
+  TRACE("JSSharedBuffer::ToJS {}", THIS);
+  auto v8_isolate = v8x::getCurrentIsolate();
+  auto v8_scope = v8x::withScope(v8_isolate);
+  auto v8_context = v8x::getCurrentContext(v8_isolate);
+
+  installAtomicsBridge(v8_isolate, v8_context);
+  auto v8_buffer = v8::SharedArrayBuffer::New(v8_isolate, m_backing_store);
+  return wrap(v8_isolate, v8_buffer.As<v8::Object>());
+}
+
+int32_t* JSSharedBuffer::SlotAddress(size_t index) const {
+  auto data = static_cast<uint8_t*>(m_backing_store->Data());
+  if (reinterpret_cast<uintptr_t>(data) % alignof(int32_t) != 0) {
+    throw JSException("shared buffer memory is not aligned for int32 access", PyExc_ValueError);
+  }
+  if (index >= Size() / sizeof(int32_t)) {
+    auto msg = fmt::format("int32 slot index {} out of range, shared buffer has {} bytes", index, Size());
+    throw JSException(msg, PyExc_IndexError);
+  }
+  return reinterpret_cast<int32_t*>(data) + index;
+}
+
+int32_t JSSharedBuffer::Load(size_t index) const {
+  return __atomic_load_n(SlotAddress(index), __ATOMIC_SEQ_CST);
+}
+
+void JSSharedBuffer::Store(size_t index, int32_t value) const {
+  __atomic_store_n(SlotAddress(index), value, __ATOMIC_SEQ_CST);
+}
+
+int32_t JSSharedBuffer::Add(size_t index, int32_t delta) const {
+  return __atomic_fetch_add(SlotAddress(index), delta, __ATOMIC_SEQ_CST);
+}
+
+int32_t JSSharedBuffer::CompareExchange(size_t index, int32_t expected, int32_t value) const {
+  // returns the previous value like Atomics.compareExchange
+  __atomic_compare_exchange_n(SlotAddress(index), &expected, value, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+  return expected;
+}
+
+std::string JSSharedBuffer::Wait(size_t index, int32_t value, double timeout) const {
+  TRACE("JSSharedBuffer::Wait {} index={} value={} timeout={}", THIS, index, value, timeout);
+  auto address = SlotAddress(index);
+  auto py_gil = pyu::withoutGIL();
+
+  std::unique_lock<std::mutex> lock(g_waiters_mutex);
+  // checking the value under the mutex makes sure we cannot miss a notify issued after a store
+  if (__atomic_load_n(address, __ATOMIC_SEQ_CST) != value) {
+    return "not-equal";
+  }
+
+  PythonWaiter waiter{address};
+  g_python_waiters.push_back(&waiter);
+  auto is_notified = [&waiter]() { return waiter.m_notified; };
+  if (timeout < 0 || std::isinf(timeout)) {
+    waiter.m_cv.wait(lock, is_notified);
+  } else {
+    waiter.m_cv.wait_for(lock, std::chrono::duration<double>(timeout), is_notified);
+  }
+
+  if (!waiter.m_notified) {
+    g_python_waiters.remove(&waiter);
+    return "timed-out";
+  }
+  return "ok";
+}
+
+int JSSharedBuffer::Notify(size_t index, int count) const {
+  TRACE("JSSharedBuffer::Notify {} index={} count={}", THIS, index, count);
+  auto address = SlotAddress(index);
+  if (count < 0) {
+    count = std::numeric_limits<int>::max();
+  }
+  std::lock_guard<std::mutex> lock(g_waiters_mutex);
+  auto woken = notifyPythonWaiters(address, count);
+  return woken + notifyJSWaiters(address, count - woken);
+}
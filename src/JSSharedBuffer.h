@@ -0,0 +1,56 @@
+#ifndef NAGA_JSSHAREDBUFFER_H_
+#define NAGA_JSSHAREDBUFFER_H_
+
+#include "Base.h"
+
+// JSSharedBuffer is a chunk of memory shared by Python and any number of JS contexts, possibly in different isolates.
+//
+// The memory is owned by a Python object implementing the buffer protocol (bytearray, mmap.mmap, numpy array, ...).
+// We hold a writable contiguous view of it while any SharedArrayBuffer may point to it, so for example an mmap cannot
+// be closed under JS feet. In JS land the memory is a SharedArrayBuffer over a shared v8::BackingStore, every context
+// sees the same bytes and nothing gets copied. In Python land it is available as a memoryview.
+//
+// The last SharedArrayBuffer can die on any V8 thread (array buffers are swept concurrently), possibly without the GIL.
+// In that case the Python view is released later via Py_AddPendingCall.
+//
+// Atomics.wait/notify are bridged with Python threads. Python can wait on and notify int32 slots with the semantics of
+// Atomics.wait/notify:
+//   - Notify from Python wakes JS threads blocked in Atomics.wait on the same slot. We learn about them via
+//     v8::Isolate::AtomicsWaitCallback and use their wake handles. V8 reports such wake-up as "timed-out", so JS code
+//     should re-check the value in a loop (which it should do anyway).
+//   - Contexts which got a buffer installed have Atomics.notify patched to wake Python waiters as well.
+
+class JSSharedBuffer {
+  py::object m_py_owner;
+  std::shared_ptr<v8::BackingStore> m_backing_store;
+
+  [[nodiscard]] int32_t* SlotAddress(size_t index) const;
+
+ public:
+  explicit JSSharedBuffer(const py::object& py_source);
+  ~JSSharedBuffer();
+
+  [[nodiscard]] size_t Size() const;
+  [[nodiscard]] py::object GetOwner() const;
+  [[nodiscard]] py::object GetMemoryView() const;
+
+  void Install(const SharedJSContextPtr& context, const std::string& name) const;
+  [[nodiscard]] py::object ToJS() const;
+
+  [[nodiscard]] int32_t Load(size_t index) const;
+  void Store(size_t index, int32_t value) const;
+  int32_t Add(size_t index, int32_t delta) const;
+  int32_t CompareExchange(size_t index, int32_t expected, int32_t value) const;
+  [[nodiscard]] std::string Wait(size_t index, int32_t value, double timeout) const;
+  int Notify(size_t index, int count) const;
+
+  static void AtomicsWaitCallback(v8::Isolate::AtomicsWaitEvent event,
+                                  v8::Local<v8::SharedArrayBuffer> v8_array_buffer,
+                                  size_t offset_in_bytes,
+                                  int64_t value,
+                                  double timeout_in_ms,
+                                  v8::Isolate::AtomicsWaitWakeHandle* wake_handle,
+                                  void* data);
+};
+
+#endif
@@ -0,0 +1,341 @@
+#include "JSStructuredClone.h"
+#include "JSContext.h"
+#include "JSIsolate.h"
+#include "JSException.h"
+#include "Wrapping.h"
+#include "Logging.h"
+#include "Printing.h"
+#include "V8XUtils.h"
+
+#include <cstring>
+
+#define TRACE(...) \
+  LOGGER_INDENT;   \
+  SPDLOG_LOGGER_TRACE(getLogger(kJSCloneLogger), __VA_ARGS__)
+
+static void throwDataCloneError(v8x::LockedIsolatePtr& v8_isolate, v8::Local<v8::String> v8_message) {
+  // browsers throw DOMException named DataCloneError, we mimic it with a plain error of that name
+  auto v8_context = v8_isolate->GetCurrentContext();
+  auto v8_error = v8::Exception::Error(v8_message).As<v8::Object>();
+  v8_error->Set(v8_context, v8x::toString(v8_isolate, "name"), v8x::toString(v8_isolate, "DataCloneError")).Check();
+  v8_isolate->ThrowException(v8_error);
+}
+
+class CloneSerializerDelegate : public v8::ValueSerializer::Delegate {
+  v8::Isolate* m_v8_isolate;
+
+ public:
+  explicit CloneSerializerDelegate(v8::Isolate* v8_isolate) : m_v8_isolate(v8_isolate) {}
+
+  void ThrowDataCloneError(v8::Local<v8::String> v8_message) override {
+    auto v8_isolate = v8x::lockIsolate(m_v8_isolate);
+    throwDataCloneError(v8_isolate, v8_message);
+  }
+};
+
+static bool collectTransferList(v8x::LockedIsolatePtr& v8_isolate,
+                                v8::Local<v8::Context> v8_context,
+                                v8::Local<v8::Value> v8_transfer_list,
+                                std::vector<v8::Local<v8::ArrayBuffer>>& v8_array_buffers) {
+  if (v8_transfer_list.IsEmpty() || v8_transfer_list->IsNullOrUndefined()) {
+    return true;
+  }
+  if (!v8_transfer_list->IsArray()) {
+    v8_isolate->ThrowException(v8::Exception::TypeError(v8x::toString(v8_isolate, "transfer list must be an array")));
+    return false;
+  }
+
+  auto v8_array = v8_transfer_list.As<v8::Array>();
+  auto length = v8_array->Length();
+  v8_array_buffers.reserve(length);
+  for (uint32_t i = 0; i < length; i++) {
+    v8::Local<v8::Value> v8_item;
+    if (!v8_array->Get(v8_context, i).ToLocal(&v8_item)) {
+      return false;
+    }
+    if (!v8_item->IsArrayBuffer()) {
+      throwDataCloneError(v8_isolate, v8x::toString(v8_isolate, "only ArrayBuffers can be transferred"));
+      return false;
+    }
+    auto v8_array_buffer = v8_item.As<v8::ArrayBuffer>();
+    if (!v8_array_buffer->IsDetachable()) {
+      throwDataCloneError(v8_isolate, v8x::toString(v8_isolate, "ArrayBuffer is not detachable"));
+      return false;
+    }
+    for (const auto& v8_seen : v8_array_buffers) {
+      if (v8_seen->StrictEquals(v8_array_buffer)) {
+        throwDataCloneError(v8_isolate, v8x::toString(v8_isolate, "ArrayBuffer is listed for transfer twice"));
+        return false;
+      }
+    }
+    v8_array_buffers.push_back(v8_array_buffer);
+  }
+  return true;
+}
+
+v8::Maybe<bool> serializeJSValue(v8x::LockedIsolatePtr& v8_isolate,
+                                 v8::Local<v8::Context> v8_context,
+                                 v8::Local<v8::Value> v8_value,
+                                 v8::Local<v8::Value> v8_transfer_list,
+                                 SerializedJSValue& serialized) {
+  TRACE("serializeJSValue v8_isolate={} v8_value={}", P$(v8_isolate), v8_value);
+  std::vector<v8::Local<v8::ArrayBuffer>> v8_array_buffers;
+  if (!collectTransferList(v8_isolate, v8_context, v8_transfer_list, v8_array_buffers)) {
+    return v8::Nothing<bool>();
+  }
+
+  CloneSerializerDelegate delegate(v8_isolate);
+  v8::ValueSerializer v8_serializer(v8_isolate, &delegate);
+  for (uint32_t i = 0; i < v8_array_buffers.size(); i++) {
+    v8_serializer.TransferArrayBuffer(i, v8_array_buffers[i]);
+  }
+
+  v8_serializer.WriteHeader();
+  if (v8_serializer.WriteValue(v8_context, v8_value).IsNothing()) {
+    return v8::Nothing<bool>();
+  }
+
+  // the backing stores keep the memory alive while the source buffers are detached
+  serialized.m_transferred_array_buffers.reserve(v8_array_buffers.size());
+  for (auto& v8_array_buffer : v8_array_buffers) {
+    serialized.m_transferred_array_buffers.push_back(v8_array_buffer->GetBackingStore());
+    v8_array_buffer->Detach();
+  }
+
+  // default Delegate::ReallocateBufferMemory uses realloc, so the buffer is ours to free
+  auto [data, size] = v8_serializer.Release();
+  serialized.m_data.reset(data);
+  serialized.m_size = size;
+  TRACE("serializeJSValue => size={} transferred={}", size, serialized.m_transferred_array_buffers.size());
+  return v8::Just(true);
+}
+
+v8::MaybeLocal<v8::Value> deserializeJSValue(v8x::LockedIsolatePtr& v8_isolate,
+                                             v8::Local<v8::Context> v8_context,
+                                             SerializedJSValue& serialized) {
+  TRACE("deserializeJSValue v8_isolate={} size={}", P$(v8_isolate), serialized.m_size);
+  v8::ValueDeserializer v8_deserializer(v8_isolate, serialized.m_data.get(), serialized.m_size);
+
+  // transferred backing stores are adopted by the new buffers as they are, without copying
+  auto& backing_stores = serialized.m_transferred_array_buffers;
+  for (uint32_t i = 0; i < backing_stores.size(); i++) {
+    auto v8_array_buffer = v8::ArrayBuffer::New(v8_isolate, std::move(backing_stores[i]));
+    v8_deserializer.TransferArrayBuffer(i, v8_array_buffer);
+  }
+  backing_stores.clear();
+
+  if (v8_deserializer.ReadHeader(v8_context).IsNothing()) {
+    return v8::MaybeLocal<v8::Value>();
+  }
+  return v8_deserializer.ReadValue(v8_context);
+}
+
+static void structuredCloneCallback(const v8::FunctionCallbackInfo<v8::Value>& v8_info) {
+  TRACE("structuredCloneCallback v8_info={}", v8_info);
+  auto v8_isolate = v8x::lockIsolate(v8_info.GetIsolate());
+  auto v8_context = v8_isolate->GetCurrentContext();
+
+  // structuredClone(value, {transfer: [...]})
+  v8::Local<v8::Value> v8_transfer_list;
+  if (v8_info.Length() > 1 && v8_info[1]->IsObject()) {
+    auto v8_transfer_key = v8x::toString(v8_isolate, "transfer");
+    if (!v8_info[1].As<v8::Object>()->Get(v8_context, v8_transfer_key).ToLocal(&v8_transfer_list)) {
+      return;
+    }
+  }
+
+  SerializedJSValue serialized;
+  if (serializeJSValue(v8_isolate, v8_context, v8_info[0], v8_transfer_list, serialized).IsNothing()) {
+    return;
+  }
+
+  v8::Local<v8::Value> v8_result;
+  if (deserializeJSValue(v8_isolate, v8_context, serialized).ToLocal(&v8_result)) {
+    v8_info.GetReturnValue().Set(v8_result);
+  }
+}
+
+void installStructuredClone(v8x::LockedIsolatePtr& v8_isolate, v8::Local<v8::Context> v8_context) {
+  TRACE("installStructuredClone v8_isolate={} v8_context={}", P$(v8_isolate), v8_context);
+  auto v8_fn = v8::Function::New(v8_context, structuredCloneCallback, v8::Local<v8::Value>(), 1).ToLocalChecked();
+  auto v8_name = v8x::toString(v8_isolate, "structuredClone");
+  v8_fn->SetName(v8_name);
+  // same attributes as other functions installed on the global object by V8
+  v8_context->Global()->DefineOwnProperty(v8_context, v8_name, v8_fn, v8::DontEnum).Check();
+}
+
+py::object transferJSValue(const py::object& py_value,
+                           const SharedJSContextPtr& target_context,
+                           const py::list& py_transfer_list) {
+  TRACE("transferJSValue py_value={} target_context={} py_transfer_list={}", py_value, target_context,
+        py_transfer_list);
+  if (!target_context) {
+    throw py::value_error("target context must not be None");
+  }
+
+  SerializedJSValue serialized;
+  {
+    auto v8_isolate = v8x::getCurrentIsolate();
+    auto v8_scope = v8x::withScope(v8_isolate);
+    auto v8_context = v8x::getCurrentContext(v8_isolate);
+    auto v8_try_catch = v8x::withAutoTryCatch(v8_isolate);
+
+    auto v8_value = wrap(py_value);
+    auto v8_transfer_list = v8::Array::New(v8_isolate, static_cast<int>(py_transfer_list.size()));
+    for (size_t i = 0; i < py_transfer_list.size(); i++) {
+      v8_transfer_list->Set(v8_context, static_cast<uint32_t>(i), wrap(py_transfer_list[i])).Check();
+    }
+
+    if (serializeJSValue(v8_isolate, v8_context, v8_value, v8_transfer_list, serialized).IsNothing()) {
+      v8x::checkTryCatch(v8_isolate, v8_try_catch);
+    }
+  }
+
+  // the target context might live in another isolate, we have to lock and enter it for the rest of the work
+  auto target_isolate = target_context->GetIsolate();
+  auto v8_isolate = target_isolate->ToV8();
+  auto v8_isolate_scope = v8::Isolate::Scope(v8_isolate);
+  auto v8_scope = v8x::withScope(v8_isolate);
+  auto v8_context = target_context->ToV8();
+  auto v8_context_scope = v8x::withContext(v8_context);
+  auto v8_try_catch = v8x::withAutoTryCatch(v8_isolate);
+
+  v8::Local<v8::Value> v8_result;
+  if (!deserializeJSValue(v8_isolate, v8_context, serialized).ToLocal(&v8_result)) {
+    v8x::checkTryCatch(v8_isolate, v8_try_catch);
+    throw JSException(v8_isolate, "Unexpected: deserialization failed without an exception");
+  }
+
+  auto py_result = wrap(v8_isolate, v8_result);
+  TRACE("transferJSValue => {}", py_result);
+  return py_result;
+}
+
+static constexpr int kMaxPlainDepth = 256;
+
+static void throwTooDeep() {
+  throw JSException("Value is too deeply nested or cyclic", PyExc_ValueError);
+}
+
+static v8::Local<v8::Value> toNativeJS(v8x::LockedIsolatePtr& v8_isolate,
+                                       v8::Local<v8::Context> v8_context,
+                                       py::handle py_value,
+                                       int depth) {
+  // wrap() would turn Python containers into proxies, which ValueSerializer refuses as host objects
+  if (depth > kMaxPlainDepth) {
+    throwTooDeep();
+  }
+  if (py::isinstance<py::dict>(py_value)) {
+    auto v8_object = v8::Object::New(v8_isolate);
+    for (auto [py_key, py_item] : py::reinterpret_borrow<py::dict>(py_value)) {
+      auto v8_key = v8x::toString(v8_isolate, py::str(py_key));
+      auto v8_item = toNativeJS(v8_isolate, v8_context, py_item, depth + 1);
+      v8_object->Set(v8_context, v8_key, v8_item).Check();
+    }
+    return v8_object;
+  }
+  if (py::isinstance<py::list>(py_value) || py::isinstance<py::tuple>(py_value)) {
+    auto py_sequence = py::reinterpret_borrow<py::sequence>(py_value);
+    auto v8_array = v8::Array::New(v8_isolate, static_cast<int>(py_sequence.size()));
+    for (size_t i = 0; i < py_sequence.size(); i++) {
+      auto v8_item = toNativeJS(v8_isolate, v8_context, py_sequence[i], depth + 1);
+      v8_array->Set(v8_context, static_cast<uint32_t>(i), v8_item).Check();
+    }
+    return v8_array;
+  }
+  if (PyByteArray_Check(py_value.ptr()) || PyBytes_Check(py_value.ptr()) || PyMemoryView_Check(py_value.ptr())) {
+    auto py_buffer = py::reinterpret_borrow<py::buffer>(py_value).request();
+    auto size = static_cast<size_t>(py_buffer.size * py_buffer.itemsize);
+    auto v8_array_buffer = v8::ArrayBuffer::New(v8_isolate, size);
+    std::memcpy(v8_array_buffer->GetBackingStore()->Data(), py_buffer.ptr, size);
+    return v8_array_buffer;
+  }
+  return wrap(py_value);
+}
+
+static py::object toPlainPython(v8x::LockedIsolatePtr& v8_isolate,
+                                v8::Local<v8::Context> v8_context,
+                                v8::Local<v8::Value> v8_value,
+                                int depth) {
+  if (depth > kMaxPlainDepth) {
+    throwTooDeep();
+  }
+  if (v8_value->IsArray()) {
+    auto v8_array = v8_value.As<v8::Array>();
+    py::list py_result(v8_array->Length());
+    for (uint32_t i = 0; i < v8_array->Length(); i++) {
+      py_result[i] = toPlainPython(v8_isolate, v8_context, v8_array->Get(v8_context, i).ToLocalChecked(), depth + 1);
+    }
+    return std::move(py_result);
+  }
+  if (v8_value->IsArrayBuffer()) {
+    auto v8_backing_store = v8_value.As<v8::ArrayBuffer>()->GetBackingStore();
+    return py::bytes(static_cast<const char*>(v8_backing_store->Data()), v8_backing_store->ByteLength());
+  }
+  if (v8_value->IsArrayBufferView()) {
+    auto v8_view = v8_value.As<v8::ArrayBufferView>();
+    std::string data(v8_view->ByteLength(), '\0');
+    v8_view->CopyContents(data.data(), data.size());
+    return py::bytes(data);
+  }
+  // plain objects become dicts, everything else (dates, maps, sets, boxed primitives, ...) gets wrapped as usual
+  if (v8_value->IsObject() && !v8_value->IsFunction() && !v8_value->IsDate() && !v8_value->IsMap() &&
+      !v8_value->IsSet() && !v8_value->IsRegExp() && !v8_value->IsNativeError() && !v8_value->IsNumberObject() &&
+      !v8_value->IsStringObject() && !v8_value->IsBooleanObject() && !v8_value->IsBigIntObject()) {
+    auto v8_object = v8_value.As<v8::Object>();
+    auto v8_keys = v8_object->GetOwnPropertyNames(v8_context).ToLocalChecked();
+    py::dict py_result;
+    for (uint32_t i = 0; i < v8_keys->Length(); i++) {
+      auto v8_key = v8_keys->Get(v8_context, i).ToLocalChecked();
+      auto v8_item = v8_object->Get(v8_context, v8_key).ToLocalChecked();
+      py_result[py::str(v8x::toStdString(v8_isolate, v8_key))] =
+          toPlainPython(v8_isolate, v8_context, v8_item, depth + 1);
+    }
+    return std::move(py_result);
+  }
+  return wrap(v8_isolate, v8_value);
+}
+
+py::bytes serializeToBytes(const py::object& py_value) {
+  TRACE("serializeToBytes py_value={}", py_value);
+  auto v8_isolate = v8x::getCurrentIsolate();
+  auto v8_scope = v8x::withScope(v8_isolate);
+  auto v8_context = v8x::getCurrentContext(v8_isolate);
+  auto v8_try_catch = v8x::withAutoTryCatch(v8_isolate);
+
+  auto v8_value = toNativeJS(v8_isolate, v8_context, py_value, 0);
+  SerializedJSValue serialized;
+  if (serializeJSValue(v8_isolate, v8_context, v8_value, v8::Local<v8::Value>(), serialized).IsNothing()) {
+    v8x::checkTryCatch(v8_isolate, v8_try_catch);
+    throw JSException(v8_isolate, "Unexpected: serialization failed without an exception");
+  }
+  return py::bytes(reinterpret_cast<const char*>(serialized.m_data.get()), serialized.m_size);
+}
+
+py::object deserializeFromBytes(const py::buffer& py_data, bool plain) {
+  TRACE("deserializeFromBytes plain={}", plain);
+  auto py_buffer = py_data.request();
+  auto v8_isolate = v8x::getCurrentIsolate();
+  auto v8_scope = v8x::withScope(v8_isolate);
+  auto v8_context = v8x::getCurrentContext(v8_isolate);
+  auto v8_try_catch = v8x::withAutoTryCatch(v8_isolate);
+
+  // the deserializer reads straight from the Python buffer, no copy needed
+  v8::ValueDeserializer v8_deserializer(v8_isolate, static_cast<const uint8_t*>(py_buffer.ptr),
+                                        static_cast<size_t>(py_buffer.size * py_buffer.itemsize));
+  v8::Local<v8::Value> v8_result;
+  {
+    // malformed data is an argument error, not a JS error
+    v8::TryCatch v8_read_try_catch(v8_isolate);
+    if (v8_deserializer.ReadHeader(v8_context).IsNothing() ||
+        !v8_deserializer.ReadValue(v8_context).ToLocal(&v8_result)) {
+      auto reason = v8_read_try_catch.HasCaught() ? v8x::toStdString(v8_isolate, v8_read_try_catch.Exception())
+                                                  : std::string("invalid data");
+      throw JSException(fmt::format("Unable to deserialize value: {}", reason), PyExc_ValueError);
+    }
+  }
+
+  auto py_result = plain ? toPlainPython(v8_isolate, v8_context, v8_result, 0) : wrap(v8_isolate, v8_result);
+  TRACE("deserializeFromBytes => {}", py_result);
+  return py_result;
+}
@@ -0,0 +1,45 @@
+#ifndef NAGA_JSSTRUCTUREDCLONE_H_
+#define NAGA_JSSTRUCTUREDCLONE_H_
+
+#include "Base.h"
+
+// Structured clone copies JS values between contexts, possibly living in different isolates, using v8::ValueSerializer
+// (the same algorithm browsers use for postMessage). Values never pass through Python on the way.
+//
+// ArrayBuffers listed for transfer are not copied. Their backing stores are taken over by the destination and
+// the source buffers get detached. Objects which cannot be cloned (functions, our Python object wrappers, etc.) raise
+// DataCloneError-like JS errors.
+//
+// toolkit.transfer() locks the target isolate while the source isolate stays locked by the caller. Two threads
+// transferring in opposite directions between the same pair of isolates would deadlock, so don't do that.
+
+struct SerializedJSValue {
+  using Buffer = std::unique_ptr<uint8_t, decltype(&free)>;
+
+  Buffer m_data{nullptr, &free};
+  size_t m_size{0};
+  std::vector<std::shared_ptr<v8::BackingStore>> m_transferred_array_buffers;
+};
+
+v8::Maybe<bool> serializeJSValue(v8x::LockedIsolatePtr& v8_isolate,
+                                 v8::Local<v8::Context> v8_context,
+                                 v8::Local<v8::Value> v8_value,
+                                 v8::Local<v8::Value> v8_transfer_list,
+                                 SerializedJSValue& serialized);
+v8::MaybeLocal<v8::Value> deserializeJSValue(v8x::LockedIsolatePtr& v8_isolate,
+                                             v8::Local<v8::Context> v8_context,
+                                             SerializedJSValue& serialized);
+
+void installStructuredClone(v8x::LockedIsolatePtr& v8_isolate, v8::Local<v8::Context> v8_context);
+
+// toolkit.serialize/deserialize expose the wire format for transports of our own (e.g. naga.farm). Python dicts, lists
+// and bytes are deep-converted to plain JS objects, arrays and ArrayBuffers first. Deserialization with plain=True
+// converts back, otherwise the result gets wrapped as usual.
+py::bytes serializeToBytes(const py::object& py_value);
+py::object deserializeFromBytes(const py::buffer& py_data, bool plain);
+
+py::object transferJSValue(const py::object& py_value,
+                           const SharedJSContextPtr& target_context,
+                           const py::list& py_transfer_list);
+
+#endif
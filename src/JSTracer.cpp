@@ -5,6 +5,7 @@
 #include "PythonUtils.h"
 #include "JSEternals.h"
 #include "V8XLockedIsolate.h"
+#include "V8XUtils.h"
 
 #define TRACE(...) \
   LOGGER_INDENT;   \
@@ -120,6 +121,7 @@ void JSTracer::TraceWrapper(TracedRawObject* raw_object, v8::Local<v8::Object> v
   recordTracedWrapper(v8_wrapper, raw_object);
   auto insert_point =
       m_wrappers.insert(std::make_pair(raw_object, TracerRecord{V8Wrapper(v8_isolate, v8_wrapper), nullptr}));
+  insert_point.first->second.m_v8_wrapper.SetWrapperClassId(v8x::kTracerWrapperHandle);
 
   // start in live mode and we know we don't have to do any cleanup
   SwitchToLiveMode(insert_point.first, false);
@@ -218,6 +220,19 @@ void JSTracer::WeakRefCallback(WeakRefRawObject* raw_weak_ref) {
   DeleteRecord(lookup->second);
 }
 
+const TrackedWrappers& JSTracer::Wrappers() const {
+  return m_wrappers;
+}
+
+size_t JSTracer::NumberOfLiveRecords() const {
+  return m_wrappers.size() - m_weak_refs.size();
+}
+
+size_t JSTracer::NumberOfZombieRecords() const {
+  // each zombie holds exactly one weak ref
+  return m_weak_refs.size();
+}
+
 void JSTracer::SwitchToZombieMode(TrackedWrappers::iterator tracer_lookup) {
   auto raw_object = tracer_lookup->first;
   TRACE("CTracer::SwitchToZombieMode {} raw_object={}", THIS, raw_object);
@@ -97,6 +97,9 @@ class JSTracer {
   v8::Local<v8::Object> LookupWrapper(v8x::LockedIsolatePtr& v8_isolate, TracedRawObject* raw_object);
   void AssociatedWrapperObjectIsAboutToDie(TracedRawObject* raw_object);
   void WeakRefCallback(WeakRefRawObject* raw_weak_ref);
+  const TrackedWrappers& Wrappers() const;
+  size_t NumberOfLiveRecords() const;
+  size_t NumberOfZombieRecords() const;
 
  protected:
   void DeleteRecord(TracedRawObject* dead_raw_object);
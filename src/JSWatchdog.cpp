@@ -0,0 +1,128 @@
+#include "JSWatchdog.h"
+#include "JSIsolate.h"
+#include "JSIsolateRegistry.h"
+#include "Logging.h"
+#include "Printing.h"
+
+#include <algorithm>
+
+#define TRACE(...) \
+  LOGGER_INDENT;   \
+  SPDLOG_LOGGER_TRACE(getLogger(kJSWatchdogLogger), __VA_ARGS__)
+
+// enforce singleton contract
+constexpr auto singleton_invariants = !std::is_constructible<JSWatchdog>::value &&           //
+                                      !std::is_assignable<JSWatchdog, JSWatchdog>::value &&  //
+                                      !std::is_swappable<JSWatchdog>::value;                 //
+static_assert(singleton_invariants, "JSWatchdog should be a singleton.");
+
+JSWatchdog* JSWatchdog::Instance() {
+  // the watchdog thread is detached and runs until the process exits
+  // we intentionally leak the instance so it does not get destroyed under the running thread during static destruction
+  static auto g_watchdog = new JSWatchdog();
+  return g_watchdog;
+}
+
+// below this size compacting the heap is not worth it
+constexpr size_t kMinTimersToCompact = 64;
+
+bool JSWatchdog::IsLater(const Timer& a, const Timer& b) {
+  return a.m_deadline > b.m_deadline;
+}
+
+JSWatchdog::TimerId JSWatchdog::Arm(JSIsolate* isolate, double timeout_in_seconds) {
+  auto timeout = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(timeout_in_seconds));
+  auto deadline = Clock::now() + timeout;
+
+  bool earliest;
+  TimerId timer_id;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_thread_started) {
+      std::thread(&JSWatchdog::ThreadMain, this).detach();
+      m_thread_started = true;
+    }
+    timer_id = ++m_last_timer_id;
+    m_armed_timers.emplace(timer_id, isolate);
+    m_timers.push_back(Timer{deadline, timer_id});
+    std::push_heap(m_timers.begin(), m_timers.end(), IsLater);
+    earliest = m_timers.front().m_id == timer_id;
+  }
+  // wake up the watchdog only if it sleeps past our deadline
+  if (earliest) {
+    m_cv.notify_one();
+  }
+
+  TRACE("JSWatchdog::Arm {} isolate={} timeout_in_seconds={} => {}", THIS, (void*)isolate, timeout_in_seconds,
+        timer_id);
+  return timer_id;
+}
+
+bool JSWatchdog::Disarm(TimerId timer_id) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  // expired timers are removed from m_armed_timers by the watchdog thread
+  auto expired = m_armed_timers.erase(timer_id) == 0;
+  if (m_timers.size() > kMinTimersToCompact && m_timers.size() > 2 * m_armed_timers.size()) {
+    CompactTimers();
+  }
+  TRACE("JSWatchdog::Disarm {} timer_id={} => {}", THIS, timer_id, expired);
+  return expired;
+}
+
+void JSWatchdog::CompactTimers() {
+  // call with m_mutex held, the heap at least halves, so the cost is amortized over the disarms which filled it
+  TRACE("JSWatchdog::CompactTimers {} timers={} armed={}", THIS, m_timers.size(), m_armed_timers.size());
+  auto disarmed = [this](const Timer& timer) { return m_armed_timers.find(timer.m_id) == m_armed_timers.end(); };
+  m_timers.erase(std::remove_if(m_timers.begin(), m_timers.end(), disarmed), m_timers.end());
+  std::make_heap(m_timers.begin(), m_timers.end(), IsLater);
+}
+
+void JSWatchdog::ThreadMain() {
+  TRACE("JSWatchdog::ThreadMain {} [STARTED]", THIS);
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true) {
+    if (m_timers.empty()) {
+      m_cv.wait(lock);
+      continue;
+    }
+
+    // copy the timer, the heap may be reallocated or compacted while wait_until releases the lock
+    auto timer = m_timers.front();
+    if (timer.m_deadline > Clock::now()) {
+      m_cv.wait_until(lock, timer.m_deadline);
+      continue;
+    }
+
+    auto timer_id = timer.m_id;
+    std::pop_heap(m_timers.begin(), m_timers.end(), IsLater);
+    m_timers.pop_back();
+
+    auto it = m_armed_timers.find(timer_id);
+    if (it == m_armed_timers.end()) {
+      // already disarmed
+      continue;
+    }
+    TRACE("JSWatchdog::ThreadMain {} timer_id={} [EXPIRED] isolate={}", THIS, timer_id, (void*)it->second);
+    // the owner of the timer waits for m_mutex in Disarm before it can let the isolate go
+    it->second->TerminateOnTimeout();
+    m_armed_timers.erase(it);
+  }
+}
+
+JSDeadline::JSDeadline(v8::Isolate* v8_isolate, double timeout_in_seconds) {
+  if (timeout_in_seconds <= 0) {
+    return;
+  }
+  m_isolate = lookupRegisteredIsolate(v8_isolate);
+  assert(m_isolate);
+  m_timer_id = JSWatchdog::Instance()->Arm(m_isolate, timeout_in_seconds);
+}
+
+JSDeadline::~JSDeadline() {
+  if (!m_isolate) {
+    return;
+  }
+  if (JSWatchdog::Instance()->Disarm(m_timer_id)) {
+    m_isolate->CancelTerminationOnTimeout();
+  }
+}
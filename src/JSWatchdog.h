@@ -0,0 +1,77 @@
+#ifndef NAGA_JSWATCHDOG_H_
+#define NAGA_JSWATCHDOG_H_
+
+#include "Base.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+// JSWatchdog enforces evaluation deadlines for all isolates from a single background thread.
+//
+// Timers live in a heap ordered by deadline. Arming and disarming a timer is a short critical section, so deadlines
+// are cheap enough to be used on every call. Disarmed timers are not removed from the heap right away, the watchdog
+// thread simply skips them when they come up. Once they outnumber the armed ones, Disarm compacts the heap, so its
+// size stays proportional to the number of armed timers rather than call rate times timeout.
+//
+// When a timer expires the watchdog calls JSIsolate::TerminateOnTimeout which calls v8::Isolate::TerminateExecution
+// (one of the few V8 APIs which can be called from any thread without the isolate lock).
+// The thread is started lazily on first use, so single-threaded platform users pay nothing unless they use timeouts.
+
+class JSWatchdog {
+ public:
+  using TimerId = uint64_t;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Timer {
+    Clock::time_point m_deadline;
+    TimerId m_id;
+  };
+
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::vector<Timer> m_timers;  // heap, earliest deadline at front
+  std::unordered_map<TimerId, JSIsolate*> m_armed_timers;
+  TimerId m_last_timer_id{0};
+  bool m_thread_started{false};
+
+  // JSWatchdog is a singleton => make the constructor private, disable copy/move
+  JSWatchdog() = default;
+
+  static bool IsLater(const Timer& a, const Timer& b);
+  void CompactTimers();
+  void ThreadMain();
+
+ public:
+  JSWatchdog(const JSWatchdog&) = delete;
+  JSWatchdog& operator=(const JSWatchdog&) = delete;
+  JSWatchdog(JSWatchdog&&) = delete;
+  JSWatchdog& operator=(JSWatchdog&&) = delete;
+
+  static JSWatchdog* Instance();
+
+  TimerId Arm(JSIsolate* isolate, double timeout_in_seconds);
+  // returns true if the timer has already expired (and the isolate got terminated)
+  bool Disarm(TimerId timer_id);
+};
+
+// JSDeadline arms a watchdog timer for the duration of its scope, zero or negative timeout means no deadline.
+// It has to outlive the v8::TryCatch guarding the call, because at the end of scope it cancels the termination
+// to keep the isolate usable after the TryCatch has reported the timeout.
+class JSDeadline {
+  JSIsolate* m_isolate{nullptr};
+  JSWatchdog::TimerId m_timer_id{0};
+
+ public:
+  JSDeadline(v8::Isolate* v8_isolate, double timeout_in_seconds);
+  ~JSDeadline();
+
+  JSDeadline(const JSDeadline&) = delete;
+  JSDeadline& operator=(const JSDeadline&) = delete;
+};
+
+#endif
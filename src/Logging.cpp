@@ -4,14 +4,19 @@
 #include "spdlog/sinks/rotating_file_sink.h"
 #include "spdlog/cfg/env.h"
 
-size_t LoggerIndent::m_indent = 0;
+#include <atomic>
+
+thread_local size_t LoggerIndent::m_indent = 0;
 
 constexpr size_t log_message_padding_width = 280;
 
 static std::shared_ptr<spdlog::logger> g_loggers[kNumLoggers];
-static InceptionLevel g_inceptionLevel = 0;
-static HandleScopeLevel g_totalHandleScopeLevel = 0;
-static std::unordered_map<v8::Isolate*, HandleScopeLevel> g_isolateHandleScopeLevels;
+
+#if defined(NAGA_ENABLE_TRACING)
+
+static thread_local InceptionLevel g_inceptionLevel = 0;
+static thread_local HandleScopeLevel g_totalHandleScopeLevel = 0;
+static thread_local std::unordered_map<v8::Isolate*, HandleScopeLevel> g_isolateHandleScopeLevels;
 
 void increaseCurrentInceptionLevel() {
   g_inceptionLevel++;
@@ -26,24 +31,6 @@ InceptionLevel getCurrentInceptionLevel() {
   return g_inceptionLevel;
 }
 
-class inception_formatter final : public spdlog::custom_flag_formatter {
- public:
-  void format(const spdlog::details::log_msg& msg, const std::tm&, spdlog::memory_buf_t& dest) override {
-    auto inceptionLevel = getCurrentInceptionLevel();
-    auto str = fmt::format("{}", inceptionLevel);
-    // we want to print only the last digit of inceptionLevel
-    if (str.size() > 0) {
-      auto end = str.data() + str.size();
-      auto prev = end - 1;
-      dest.append(prev, end);
-    }
-  }
-
-  [[nodiscard]] std::unique_ptr<custom_flag_formatter> clone() const override {
-    return spdlog::details::make_unique<inception_formatter>();
-  }
-};
-
 void increaseCurrentHandleScopeLevel(v8::Isolate* v8_isolate) {
   g_totalHandleScopeLevel++;
   g_isolateHandleScopeLevels[v8_isolate]++;
@@ -58,13 +45,34 @@ void decreaseCurrentHandleScopeLevel(v8::Isolate* v8_isolate) {
 }
 
 HandleScopeLevel getCurrentHandleScopeLevel(v8::Isolate* v8_isolate) {
-  return g_isolateHandleScopeLevels[v8_isolate];
+  auto it = g_isolateHandleScopeLevels.find(v8_isolate);
+  return it == g_isolateHandleScopeLevels.end() ? 0 : it->second;
 }
 
 HandleScopeLevel getTotalHandleScopeLevel() {
   return g_totalHandleScopeLevel;
 }
 
+#endif
+
+class inception_formatter final : public spdlog::custom_flag_formatter {
+ public:
+  void format(const spdlog::details::log_msg& msg, const std::tm&, spdlog::memory_buf_t& dest) override {
+    auto inceptionLevel = getCurrentInceptionLevel();
+    auto str = fmt::format("{}", inceptionLevel);
+    // we want to print only the last digit of inceptionLevel
+    if (str.size() > 0) {
+      auto end = str.data() + str.size();
+      auto prev = end - 1;
+      dest.append(prev, end);
+    }
+  }
+
+  [[nodiscard]] std::unique_ptr<custom_flag_formatter> clone() const override {
+    return spdlog::details::make_unique<inception_formatter>();
+  }
+};
+
 class handle_scope_formatter final : public spdlog::custom_flag_formatter {
  public:
   void format(const spdlog::details::log_msg& msg, const std::tm&, spdlog::memory_buf_t& dest) override {
@@ -209,6 +217,14 @@ static void initLoggers() {
   g_loggers[kPythonModuleLogger] = std::make_shared<spdlog::logger>("naga_pml", logger_file_sink);
   g_loggers[kHandleScopeLogger] = std::make_shared<spdlog::logger>("naga_hsl", logger_file_sink);
   g_loggers[kIsolateLockingLogger] = std::make_shared<spdlog::logger>("naga_ill", logger_file_sink);
+  g_loggers[kPythonCoroutineLogger] = std::make_shared<spdlog::logger>("naga_pyc", logger_file_sink);
+  g_loggers[kJSWatchdogLogger] = std::make_shared<spdlog::logger>("naga_wdg", logger_file_sink);
+  g_loggers[kJSProfilerLogger] = std::make_shared<spdlog::logger>("naga_prf", logger_file_sink);
+  g_loggers[kJSCloneLogger] = std::make_shared<spdlog::logger>("naga_cln", logger_file_sink);
+  g_loggers[kJSSharedMemoryLogger] = std::make_shared<spdlog::logger>("naga_shm", logger_file_sink);
+  g_loggers[kJSMessageChannelLogger] = std::make_shared<spdlog::logger>("naga_msg", logger_file_sink);
+  g_loggers[kJSModuleLogger] = std::make_shared<spdlog::logger>("naga_mod", logger_file_sink);
+  g_loggers[kJSBundleLogger] = std::make_shared<spdlog::logger>("naga_bnd", logger_file_sink);
 
   for (auto& logger : g_loggers) {
     setupLogger(logger);
@@ -254,6 +270,6 @@ LoggerPtr getLogger(Loggers which) {
 }
 
 size_t giveNextMoreID() {
-  static size_t g_more_id = 0;
+  static std::atomic<size_t> g_more_id = 0;
   return ++g_more_id;
 }
\ No newline at end of file
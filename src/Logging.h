@@ -33,6 +33,14 @@ enum Loggers {
   kPythonModuleLogger,
   kHandleScopeLogger,
   kIsolateLockingLogger,
+  kPythonCoroutineLogger,
+  kJSWatchdogLogger,
+  kJSProfilerLogger,
+  kJSCloneLogger,
+  kJSSharedMemoryLogger,
+  kJSMessageChannelLogger,
+  kJSModuleLogger,
+  kJSBundleLogger,
   kNumLoggers
 };
 
@@ -42,19 +50,45 @@ LoggerPtr getLogger(Loggers which);
 size_t giveNextMoreID();
 
 using InceptionLevel = size_t;
+using HandleScopeLevel = size_t;
+
+// Tracing bookkeeping below is only compiled in when NAGA_ENABLE_TRACING is defined (see naga_enable_tracing in
+// gn/BUILD.gn). Otherwise all of it collapses to no-ops and TRACE() calls cost nothing when trace logging is compiled
+// out as well. The state is kept per thread, so concurrent isolates do not race on it.
+
+#if defined(NAGA_ENABLE_TRACING)
+
 void increaseCurrentInceptionLevel();
 void decreaseCurrentInceptionLevel();
 InceptionLevel getCurrentInceptionLevel();
 
-using HandleScopeLevel = size_t;
 void increaseCurrentHandleScopeLevel(v8::Isolate* v8_isolate);
 void decreaseCurrentHandleScopeLevel(v8::Isolate* v8_isolate);
 HandleScopeLevel getCurrentHandleScopeLevel(v8::Isolate* v8_isolate);
 HandleScopeLevel getTotalHandleScopeLevel();
 
+#else
+
+inline void increaseCurrentInceptionLevel() {}
+inline void decreaseCurrentInceptionLevel() {}
+inline InceptionLevel getCurrentInceptionLevel() {
+  return 0;
+}
+
+inline void increaseCurrentHandleScopeLevel(v8::Isolate*) {}
+inline void decreaseCurrentHandleScopeLevel(v8::Isolate*) {}
+inline HandleScopeLevel getCurrentHandleScopeLevel(v8::Isolate*) {
+  return 0;
+}
+inline HandleScopeLevel getTotalHandleScopeLevel() {
+  return 0;
+}
+
+#endif
+
 class LoggerIndent {
  public:
-  static size_t m_indent;
+  static thread_local size_t m_indent;
 
   LoggerIndent() { IncreaseIndent(); }
   ~LoggerIndent() { DecreaseIndent(); }
@@ -66,9 +100,15 @@ class LoggerIndent {
 
 #define LOGGER_CONCAT_(x, y) x##y
 #define LOGGER_CONCAT(x, y) LOGGER_CONCAT_(x, y)
+#if defined(NAGA_ENABLE_TRACING)
 #define LOGGER_INDENT LoggerIndent LOGGER_CONCAT(logger_indent_, __COUNTER__)
 #define LOGGER_INDENT_INCREASE LoggerIndent::IncreaseIndent()
 #define LOGGER_INDENT_DECREASE LoggerIndent::DecreaseIndent()
+#else
+#define LOGGER_INDENT ((void)0)
+#define LOGGER_INDENT_INCREASE ((void)0)
+#define LOGGER_INDENT_DECREASE ((void)0)
+#endif
 
 // for tracing from headers mainly
 #define HTRACE(logger, ...) \
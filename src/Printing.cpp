@@ -2,6 +2,7 @@
 #include "JSContext.h"
 #include "JSEngine.h"
 #include "JSScript.h"
+#include "JSModule.h"
 #include "JSException.h"
 #include "JSObject.h"
 #include "JSStackTrace.h"
@@ -50,6 +51,11 @@ std::ostream& operator<<(std::ostream& os, const JSScript& v) {
   return os;
 }
 
+std::ostream& operator<<(std::ostream& os, const JSModule& v) {
+  v.Dump(os);
+  return os;
+}
+
 std::ostream& operator<<(std::ostream& os, const JSStackFrame& v) {
   v.Dump(os);
   return os;
@@ -128,6 +134,10 @@ std::ostream& operator<<(std::ostream& os, const Local<Script>& v) {
   return printLocalChecked(os, v, "v8::Script");
 }
 
+std::ostream& operator<<(std::ostream& os, const Local<Module>& v) {
+  return printLocalChecked(os, v, "v8::Module");
+}
+
 std::ostream& operator<<(std::ostream& os, const Local<ObjectTemplate>& v) {
   return printLocalChecked(os, v, "v8::ObjectTemplate");
 }
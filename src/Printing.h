@@ -35,6 +35,7 @@ std::ostream& operator<<(std::ostream& os, const JSObject& v);
 std::ostream& operator<<(std::ostream& os, const JSContext& v);
 std::ostream& operator<<(std::ostream& os, const JSEngine& v);
 std::ostream& operator<<(std::ostream& os, const JSScript& v);
+std::ostream& operator<<(std::ostream& os, const JSModule& v);
 std::ostream& operator<<(std::ostream& os, const JSStackFrame& v);
 std::ostream& operator<<(std::ostream& os, PyObject* v);
 std::ostream& operator<<(std::ostream& os, PyTypeObject* v);
@@ -68,6 +69,7 @@ std::ostream& operator<<(std::ostream& os, const TryCatch& v);
 std::ostream& operator<<(std::ostream& os, const Local<Private>& v);
 std::ostream& operator<<(std::ostream& os, const Local<Context>& v);
 std::ostream& operator<<(std::ostream& os, const Local<Script>& v);
+std::ostream& operator<<(std::ostream& os, const Local<Module>& v);
 std::ostream& operator<<(std::ostream& os, const Local<ObjectTemplate>& v);
 std::ostream& operator<<(std::ostream& os, const Local<Message>& v);
 std::ostream& operator<<(std::ostream& os, const Local<StackFrame>& v);
@@ -0,0 +1,129 @@
+#include "PythonCoroutine.h"
+#include "PythonObject.h"
+#include "JSIsolate.h"
+#include "JSException.h"
+#include "Wrapping.h"
+#include "Logging.h"
+#include "Printing.h"
+#include "PythonUtils.h"
+#include "V8XUtils.h"
+
+#define TRACE(...) \
+  LOGGER_INDENT;   \
+  SPDLOG_LOGGER_TRACE(getLogger(kPythonCoroutineLogger), __VA_ARGS__)
+
+// this is the state shared between the call site and the done callback
+// it holds the isolate strongly, so the isolate cannot go away while a coroutine is still pending
+struct PendingCoroutine {
+  SharedJSIsolatePtr m_isolate;
+  v8x::ProtectedIsolatePtr m_v8_isolate;
+  v8::Global<v8::Promise::Resolver> m_v8_resolver;
+  v8::Global<v8::Context> m_v8_context;
+
+  PendingCoroutine(SharedJSIsolatePtr isolate,
+                   v8x::LockedIsolatePtr& v8_isolate,
+                   v8::Local<v8::Promise::Resolver> v8_resolver,
+                   v8::Local<v8::Context> v8_context)
+      : m_isolate(std::move(isolate)),
+        m_v8_isolate(v8_isolate) {
+    m_v8_resolver.Reset(v8_isolate, v8_resolver);
+    m_v8_resolver.AnnotateStrongRetainer("Naga PendingCoroutine.m_v8_resolver");
+    m_v8_context.Reset(v8_isolate, v8_context);
+    m_v8_context.AnnotateStrongRetainer("Naga PendingCoroutine.m_v8_context");
+  }
+
+  ~PendingCoroutine() {
+    if (m_v8_resolver.IsEmpty() && m_v8_context.IsEmpty()) {
+      return;
+    }
+    // the coroutine was never settled (e.g. the event loop got closed), we still have to release our handles
+    // we usually get here when Python releases the done callback, so like settleCoroutine we must not wait for
+    // the isolate lock with the GIL held (isolate lock first, GIL second)
+    std::optional<py::gil_scoped_release> py_no_gil;
+    if (PyGILState_Check()) {
+      py_no_gil.emplace();
+    }
+    v8::Locker v8_locker(m_v8_isolate.giveMeRawIsolateAndTrustMe());
+    m_v8_resolver.Reset();
+    m_v8_context.Reset();
+  }
+};
+
+using SharedPendingCoroutinePtr = std::shared_ptr<PendingCoroutine>;
+
+static void settleCoroutine(const SharedPendingCoroutinePtr& pending, const py::object& py_future) {
+  TRACE("settleCoroutine pending={} py_future={}", (void*)pending.get(), py_future);
+
+  // we are called by the event loop with the GIL held
+  // to keep lock ordering consistent with the rest of our code (isolate lock first, GIL second)
+  // we release the GIL while waiting for the isolate lock
+  std::optional<v8::Locker> v8_locker;
+  {
+    auto _ = pyu::withoutGIL();
+    v8_locker.emplace(pending->m_v8_isolate.giveMeRawIsolateAndTrustMe());
+  }
+
+  auto v8_isolate = pending->m_isolate->ToV8();
+  auto v8_isolate_scope = v8::Isolate::Scope(v8_isolate);
+  auto v8_scope = v8x::withScope(v8_isolate);
+  auto v8_context = pending->m_v8_context.Get(v8_isolate);
+  auto v8_context_scope = v8x::withContext(v8_context);
+  auto v8_resolver = pending->m_v8_resolver.Get(v8_isolate);
+
+  try {
+    auto py_result = py_future.attr("result")();
+    v8_resolver->Resolve(v8_context, wrap(py_result)).Check();
+  } catch (const py::error_already_set& py_ex) {
+    auto v8_error = PythonObject::CreateJSError(v8_isolate, py_ex);
+    v8_resolver->Reject(v8_context, v8_error).Check();
+  }
+
+  pending->m_v8_resolver.Reset();
+  pending->m_v8_context.Reset();
+
+  // there is no JS running at this point, so nobody else would run reactions attached to the promise
+  v8_isolate->PerformMicrotaskCheckpoint();
+}
+
+bool isPythonCoroutine(py::handle py_obj) {
+  // note this call does not require GIL
+  return PyCoro_CheckExact(py_obj.ptr());
+}
+
+v8::Local<v8::Value> wrapCoroutine(v8x::LockedIsolatePtr& v8_isolate, const py::object& py_coro) {
+  TRACE("wrapCoroutine v8_isolate={} py_coro={}", P$(v8_isolate), py_coro);
+  auto v8_scope = v8x::withEscapableScope(v8_isolate);
+  auto v8_context = v8x::getCurrentContext(v8_isolate);
+  auto v8_resolver = v8::Promise::Resolver::New(v8_context).ToLocalChecked();
+
+  auto isolate = JSIsolate::FromV8(v8_isolate);
+  auto pending = std::make_shared<PendingCoroutine>(isolate, v8_isolate, v8_resolver, v8_context);
+
+  auto py_gil = pyu::withGIL();
+  auto py_asyncio = py::module::import("asyncio");
+  auto py_loop = isolate->GetEventLoop();
+  if (py_loop.is_none()) {
+    // asyncio.get_event_loop() is deprecated outside of a running loop, we don't want to create loops implicitly
+    try {
+      py_loop = py_asyncio.attr("get_running_loop")();
+    } catch (const py::error_already_set& py_ex) {
+      if (!py_ex.matches(PyExc_RuntimeError)) {
+        throw;
+      }
+      // avoid the "coroutine was never awaited" warning
+      py_coro.attr("close")();
+      throw JSException("Cannot run a Python coroutine called from JS, there is no running event loop "
+                        "and JSIsolate.event_loop is not set",
+                        PyExc_RuntimeError);
+    }
+  }
+
+  // run_coroutine_threadsafe works from any thread, including the event loop thread itself
+  auto py_future = py_asyncio.attr("run_coroutine_threadsafe")(py_coro, py_loop);
+  auto py_done_callback = py::cpp_function([pending](const py::object& py_future) {  //
+    settleCoroutine(pending, py_future);
+  });
+  py_future.attr("add_done_callback")(py_done_callback);
+
+  return v8_scope.Escape(v8_resolver->GetPromise());
+}
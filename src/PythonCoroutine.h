@@ -0,0 +1,22 @@
+#ifndef NAGA_PYTHONCOROUTINE_H_
+#define NAGA_PYTHONCOROUTINE_H_
+
+#include "Base.h"
+
+// When JS calls a Python coroutine function (async def) we don't want to hand a raw coroutine wrapper to JS land.
+// Instead we schedule the coroutine on the asyncio event loop associated with the isolate and return a JS promise.
+//
+// The promise gets settled from the future's done callback which runs on the event loop thread. That thread might not
+// be the one which made the call, so we have to lock and enter the isolate there, enter the original context and run
+// microtasks ourselves (nobody else would do it, because no JS code is running at that point).
+//
+// The loop is JSIsolate.event_loop or, when that is not set, the running loop of the calling thread. Without either
+// the call fails, we don't create event loops behind the caller's back.
+//
+// Please note that the event loop must be able to lock the isolate. The default isolate is kept locked by the main
+// thread, so in that case the event loop should be run by the main thread as well.
+
+bool isPythonCoroutine(py::handle py_obj);
+v8::Local<v8::Value> wrapCoroutine(v8x::LockedIsolatePtr& v8_isolate, const py::object& py_coro);
+
+#endif
@@ -3,6 +3,9 @@
 #include "JSIsolate.h"
 #include "JSEngine.h"
 #include "JSScript.h"
+#include "JSScriptFuture.h"
+#include "JSModule.h"
+#include "JSBundle.h"
 #include "JSContext.h"
 #include "JSNull.h"
 #include "JSUndefined.h"
@@ -13,6 +16,9 @@
 #include "JSStackTraceIterator.h"
 #include "JSStackFrame.h"
 #include "JSException.h"
+#include "JSMessageChannel.h"
+#include "JSSharedBuffer.h"
+#include "JSStructuredClone.h"
 #include "Aux.h"
 #include "PybindNagaClass.h"
 #include "PybindNagaModule.h"
@@ -47,6 +53,10 @@ void exposeAux(py::module py_module) {
       .def("v8_request_gc_for_testing", &v8RequestGarbageCollectionForTesting)    //
       .def("test_encountering_foreign_isolate", &testEncounteringForeignIsolate)  //
       .def("test_encountering_foreign_context", &testEncounteringForeignContext)  //
+      .def("build_info", &buildInfo)                                              //
+      .def("tracer_stats", &tracerStats)                                          //
+      .def("hospital_stats", &hospitalStats)                                      //
+      .def("handle_stats", &handleStats)                                          //
       ;
 }
 
@@ -88,6 +98,12 @@ void exposeToolkit(py::module py_module) {
            py::arg("args") = py::list(),                                                //
            py::arg("kwds") = py::dict(),                                                //
            "Performs a binding method call using the parameters.")                      //
+      .def("call_with_timeout", ForwardTo<&JSObject::CallWithTimeout>{},                //
+           py::arg("this"),                                                             //
+           py::arg("timeout"),                                                          //
+           py::arg("args") = py::list(),                                                //
+           py::arg("kwds") = py::dict(),                                                //
+           "Performs a function call, TimeoutError is raised after timeout seconds.")   //
       .def("clone", ForwardTo<&JSObject::Clone>{},                                      //
            py::arg("this"),                                                             //
            "Clone the object.")                                                         //
@@ -99,6 +115,26 @@ void exposeToolkit(py::module py_module) {
       .def("has_role_array", ForwardTo<&JSObject::HasRoleArray>{})                      //
       .def("has_role_function", ForwardTo<&JSObject::HasRoleFunction>{})                //
       .def("has_role_cljs", ForwardTo<&JSObject::HasRoleCLJS>{})                        //
+      .def("transfer", &transferJSValue,                                                //
+           py::arg("value"),                                                            //
+           py::arg("target_context"),                                                   //
+           py::arg("transfer") = py::list(),                                            //
+           "Structured-clones a JS value into a context of any isolate. "               //
+           "ArrayBuffers listed in transfer are moved without copying.")                //
+      .def("serialize", &serializeToBytes,                                              //
+           py::arg("value"),                                                            //
+           "Serializes a value with V8's ValueSerializer in the current context.")      //
+      .def("deserialize", &deserializeFromBytes,                                        //
+           py::arg("data"),                                                             //
+           py::arg("plain") = false,                                                    //
+           "Deserializes a value in the current context. With plain=True, "             //
+           "arrays, plain objects and ArrayBuffers become lists, dicts and bytes.")     //
+      .def("connect", &connectContexts,                                                 //
+           py::arg("context1"),                                                         //
+           py::arg("context2"),                                                         //
+           py::arg("name") = "port",                                                    //
+           "Connects two contexts of any isolates with a message channel. "             //
+           "Each gets a port with postMessage/onmessage installed as global name.")     //
       ;
 }
 
@@ -161,7 +197,32 @@ void exposeJSPlatform(py::module py_module) {
                       "Returns true if the init was already called on platform.")  //
       .def_method("init", &JSPlatform::Init,                                       //
                   py::arg("argv") = std::string(),                                 //
-                  "Initializes the platform")                                      //
+                  py::arg("worker_threads") = 0,                                   //
+                  py::arg("cpu_affinity") = std::vector<int>(),                    //
+                  py::arg("idle_tasks") = false,                                   //
+                  py::arg("best_effort_limit") = 0,                                //
+                  py::arg("single_threaded") = false,                              //
+                  "Initializes the platform. "                                     //
+                  "Passing worker_threads, cpu_affinity or best_effort_limit "     //
+                  "installs naga's worker pool with per-priority task queues. "    //
+                  "Unknown CPUs in cpu_affinity raise ValueError. "                //
+                  "With single_threaded V8 starts no background threads, "         //
+                  "so the process can be forked after initialization.")            //
+      .def_property_r("single_threaded", &JSPlatform::SingleThreaded,             //
+                      "Returns true if the platform runs in single-threaded mode.")  //
+      .def_property_r("worker_threads", &JSPlatform::NumberOfWorkerThreads,        //
+                      "Returns the number of V8 background worker threads.")       //
+      .def_property_r("worker_stats", &JSPlatform::GetWorkerStats,                 //
+                      "Returns worker pool stats or None with default platform.")  //
+      .def_method("pump_message_loop", &JSPlatform::PumpMessageLoop,               //
+                  py::arg("isolate"),                                              //
+                  py::arg("wait") = false,                                         //
+                  "Runs pending foreground tasks of the isolate. "                 //
+                  "Returns true if a task was executed.")                          //
+      .def_method("run_idle_tasks", &JSPlatform::RunIdleTasks,                     //
+                  py::arg("isolate"),                                              //
+                  py::arg("idle_time_in_seconds"),                                 //
+                  "Runs pending idle tasks of the isolate for at most given time.")  //
       ;
 }
 
@@ -169,7 +230,10 @@ void exposeJSIsolate(py::module py_module) {
   TRACE("exposeJSIsolate py_module={}", py_module);
   auto doc = "JSIsolate is an isolated instance of the V8 engine.";
   py::naga_class<JSIsolate, SharedJSIsolatePtr>(py_module, "JSIsolate", doc)  //
-      .def_ctor(py::init<>())                                                 //
+      .def_ctor(py::init<size_t, size_t, size_t>(),                           //
+                py::arg("max_old_space") = 0,                                 //
+                py::arg("max_young_space") = 0,                               //
+                py::arg("initial_heap") = 0)                                  //
                                                                               //
       .def_property_rs(
           "current", StaticCall<&JSIsolate::GetCurrent>{},                                                    //
@@ -211,6 +275,69 @@ void exposeJSIsolate(py::module py_module) {
       .def_property_r("locked", &JSIsolate::Locked)                                           //
       .def_property_r("lock_level", &JSIsolate::LockLevel,                                    //
                       "Returns how many times lock was called without pair unlock.")          //
+      .def_property("event_loop", &JSIsolate::GetEventLoop, &JSIsolate::SetEventLoop,         //
+                    "The asyncio event loop used to run Python coroutines called from JS. "   //
+                    "When None, the running loop of the calling thread is used.")             //
+      .def_method("enable_time_slicing", &JSIsolate::EnableTimeSlicing,                       //
+                  py::arg("quantum") = 0.01,                                                  //
+                  "Lets threads waiting for this isolate preempt a thread running JS "        //
+                  "for longer than quantum seconds. Waiting threads are served in FIFO order.")  //
+      .def_method("disable_time_slicing", &JSIsolate::DisableTimeSlicing)                     //
+      .def_property_r("time_slicing_enabled", &JSIsolate::TimeSlicingEnabled)                 //
+      .def_property_r("time_slicing_stats", &JSIsolate::GetTimeSlicingStats,                  //
+                      "Returns wait time and handoff metrics of the time-slicing scheduler.")  //
+      .def_method("enable_boundary_profiler", &JSIsolate::EnableBoundaryProfiler,             //
+                  py::arg("sample_every") = 64,                                               //
+                  "Starts counting JS/Python conversions and callbacks per kind, "            //
+                  "timing every sample_every-th of them.")                                    //
+      .def_method("disable_boundary_profiler", &JSIsolate::DisableBoundaryProfiler)           //
+      .def_method("boundary_profile", &JSIsolate::GetBoundaryProfile,                         //
+                  "Returns counts and latency histograms per conversion and callback kind.")  //
+      .def_method("boundary_profile_folded", &JSIsolate::GetBoundaryProfileFolded,            //
+                  "Returns estimated times of nested boundary crossings as folded stacks.")   //
+      .def_method("start_cpu_profile", &JSIsolate::StartCpuProfile,                           //
+                  py::arg("name") = std::string(),                                            //
+                  py::arg("sampling_interval_us") = 1000,                                     //
+                  "Starts recording a CPU profile of JS code running in this isolate.")      //
+      .def_method("stop_cpu_profile", &JSIsolate::StopCpuProfile,                             //
+                  py::arg("name") = std::string(),                                            //
+                  py::arg("format") = "cpuprofile",                                           //
+                  py::arg("path") = std::string(),                                            //
+                  "Stops recording the CPU profile and returns it as .cpuprofile JSON "       //
+                  "or folded stacks (format='folded'). When path is given it is also written there.")  //
+      .def_method("write_heap_snapshot", &JSIsolate::WriteHeapSnapshot,                       //
+                  py::arg("path"),                                                            //
+                  "Takes a heap snapshot and streams it into a .heapsnapshot file at path. "  //
+                  "See naga.toolkit.diff_heap_snapshots.")                                    //
+      .def_method("start_sampling_heap_profiler", &JSIsolate::StartSamplingHeapProfiler,      //
+                  py::arg("sample_interval") = 32768,                                         //
+                  py::arg("stack_depth") = 16,                                                //
+                  py::arg("include_collected") = false,                                       //
+                  "Starts sampling roughly one allocation per sample_interval bytes.")        //
+      .def_method("allocation_report", &JSIsolate::GetAllocationReport,                       //
+                  "Returns sampled allocations grouped per call site, "                       //
+                  "with host (Naga conversions) and script origins told apart. "              //
+                  "Sites are attributed to their nearest user script frame (script_frame), "  //
+                  "allocations in builtins count for the script calling them.")               //
+      .def_method("stop_sampling_heap_profiler", &JSIsolate::StopSamplingHeapProfiler,        //
+                  "Stops the sampling heap profiler and returns the final allocation report.")  //
+      .def_method("stats", &JSIsolate::GetStats,                                              //
+                  "Returns heap statistics, GC pause histograms, compile/execute times "      //
+                  "and JS/Python conversion counts of this isolate.")                         //
+      .def_method("message_stats", &JSIsolate::GetMessageStats,                               //
+                  "Returns queue depth, delivery counts and latency histogram "               //
+                  "of messages posted to this isolate via message channels.")                 //
+      .def_method("set_module_resolver", &JSIsolate::SetModuleResolver,                       //
+                  py::arg("resolve") = py::none(),                                            //
+                  py::arg("load") = py::none(),                                               //
+                  "Sets resolve(specifier, referrer) -> name and load(name) -> source "       //
+                  "used for ES module imports, None keeps the file system default.")          //
+      .def_method("module_stats", &JSIsolate::GetModuleStats,                                 //
+                  "Returns module map size and code cache counters of this isolate.")         //
+      .def_method("function_cache_stats", &JSIsolate::GetFunctionCacheStats,                  //
+                  "Returns code cache counters of JSEngine.compile_function.")                //
+      .def_property_r("out_of_memory", &JSIsolate::OutOfMemory,                               //
+                      "Returns true if the isolate reached its heap limit and should be disposed.")  //
       ;
 }
 
@@ -328,6 +455,48 @@ void exposeJSEngine(py::module py_module) {
                   py::arg("name") = std::wstring(),                                                      //
                   py::arg("line") = -1,                                                                  //
                   py::arg("col") = -1)                                                                   //
+                                                                                                         //
+      .def_method("compile_stream", &JSEngine::CompileStream,                                            //
+                  py::arg("source"),                                                                     //
+                  py::arg("name") = std::string(),                                                       //
+                  py::arg("line") = -1,                                                                  //
+                  py::arg("col") = -1,                                                                   //
+                  "Compile a script read from a file-like object or an iterable of str/bytes chunks, "   //
+                  "V8 parses on a worker thread while the source is being read.")                        //
+                                                                                                         //
+      .def_method("compile_async", &JSEngine::CompileAsync,                                              //
+                  py::arg("source"),                                                                     //
+                  py::arg("name") = std::string(),                                                       //
+                  py::arg("line") = -1,                                                                  //
+                  py::arg("col") = -1,                                                                   //
+                  py::keep_alive<0, 1>(),                                                                //
+                  "Start compiling a script on a V8 worker thread and return a JSScriptFuture.")         //
+                                                                                                         //
+      .def_method("compile_bundled", &JSEngine::CompileBundled,                                          //
+                  py::arg("bundle"),                                                                     //
+                  py::arg("name"),                                                                       //
+                  "Compile a script stored in a bundle, using its code cache.")                          //
+                                                                                                         //
+      .def_method("compile_function", &JSEngine::CompileFunction,                                        //
+                  py::arg("body"),                                                                       //
+                  py::arg("params") = std::vector<std::string>(),                                        //
+                  py::arg("context_extensions") = py::list(),                                            //
+                  py::arg("name") = std::string(),                                                       //
+                  "Compile a function from its body and parameter names without running a script, "      //
+                  "context extensions are objects whose properties the body sees as variables.")         //
+                                                                                                         //
+      .def_method("compile_module", &JSEngine::CompileModule,                                            //
+                  py::arg("source"),                                                                     //
+                  py::arg("name"),                                                                       //
+                  "Compile an ES module and register it under the given resolved name "                  //
+                  "in the module map of the current context.")                                           //
+                                                                                                         //
+      .def_method("import_module", &JSEngine::ImportModule,                                              //
+                  py::arg("specifier"),                                                                  //
+                  py::arg("referrer") = std::string(),                                                   //
+                  py::arg("timeout") = 0.0,                                                              //
+                  "Resolve, load, link and evaluate an ES module in the current context "                //
+                  "and return its namespace object.")                                                    //
       ;
 }
 
@@ -339,10 +508,80 @@ void exposeJSScript(py::module py_module) {
                       "the source code")                                   //
                                                                            //
       .def_method("run", &JSScript::Run,                                   //
+                  py::arg("timeout") = 0.0,                                //
                   "Execute the compiled code.")                            //
       ;
 }
 
+void exposeJSScriptFuture(py::module py_module) {
+  TRACE("exposeJSScriptFuture py_module={}", py_module);
+  auto doc = "JSScriptFuture is a script being compiled in the background, see JSEngine.compile_async.";
+  py::naga_class<JSScriptFuture, SharedJSScriptFuturePtr>(py_module, "JSScriptFuture", doc)  //
+      .def_property_r("name", &JSScriptFuture::GetName,                                      //
+                      "the script name")                                                     //
+                                                                                             //
+      .def_method("done", &JSScriptFuture::Done,                                             //
+                  "Return True when the background work has finished.")                      //
+                                                                                             //
+      .def_method("wait", &JSScriptFuture::Wait,                                             //
+                  py::arg("timeout") = 0.0,                                                  //
+                  "Wait for the background work, returns False when the timeout expired.")   //
+                                                                                             //
+      .def_method("result", &JSScriptFuture::Result,                                         //
+                  py::arg("timeout") = 0.0,                                                  //
+                  "Wait for the background work and finalize the script "                    //
+                  "in the current context, returns the JSScript.")                           //
+      ;
+}
+
+void exposeJSModule(py::module py_module) {
+  TRACE("exposeJSModule py_module={}", py_module);
+  auto doc = "JSModule is a compiled ES module.";
+  py::naga_class<JSModule, SharedJSModulePtr>(py_module, "JSModule", doc)  //
+      .def_property_r("name", &JSModule::GetName,                          //
+                      "the resolved name")                                 //
+                                                                           //
+      .def_property_r("requests", &JSModule::GetRequests,                  //
+                      "specifiers of the static imports")                  //
+                                                                           //
+      .def_method("evaluate", &JSModule::Evaluate,                         //
+                  py::arg("timeout") = 0.0,                                //
+                  "Link and evaluate the module, returns its namespace.")  //
+      ;
+}
+
+void exposeJSBundle(py::module py_module) {
+  TRACE("exposeJSBundle py_module={}", py_module);
+  auto doc = "JSBundle is a memory-mapped archive of scripts and modules with their code caches.";
+  py::naga_class<JSBundle, SharedJSBundlePtr>(py_module, "JSBundle", doc)                                 //
+      .def_ctor(py::init<std::string>(),                                                                  //
+                py::arg("path"),                                                                          //
+                "Opens a bundle file.")                                                                   //
+                                                                                                          //
+      .def_method_s("build", &JSBundle::Build,                                                            //
+                    py::arg("path"),                                                                      //
+                    py::arg("scripts") = py::dict(),                                                      //
+                    py::arg("modules") = py::dict(),                                                      //
+                    "Compiles scripts and modules given as dicts name => source in the current context "  //
+                    "and writes them with their code caches and the resolved module graph to path.")      //
+                                                                                                          //
+      .def_property_r("path", &JSBundle::GetPath,                                                         //
+                      "Path of the bundle file.")                                                         //
+      .def_property_r("v8_version", &JSBundle::GetV8Version,                                              //
+                      "V8 version which produced the code caches.")                                       //
+      .def_property_r("names", &JSBundle::GetNames,                                                       //
+                      "Sorted names of all scripts and modules.")                                         //
+                                                                                                          //
+      .def_method("requests", &JSBundle::GetRequests,                                                     //
+                  py::arg("name"),                                                                        //
+                  "Returns the module graph edges of a module, import specifier => resolved name.")       //
+      .def_method("install", &JSBundle::Install,                                                          //
+                  "Serves ES module imports of the current isolate from this bundle.")                    //
+      .def_method("stats", &JSBundle::GetStats,                                                           //
+                  "Returns entry counts, sizes and the number of sources handed to V8.")                  //
+      ;
+}
+
 void exposeJSContext(py::module py_module) {
   TRACE("exposeJSContext py_module={}", py_module);
   py::naga_class<JSContext, SharedJSContextPtr>(py_module, "JSContext", "JSContext is an execution context.")  //
@@ -360,12 +599,14 @@ void exposeJSContext(py::module py_module) {
                     py::arg("source"),                                                                         //
                     py::arg("name") = std::string(),                                                           //
                     py::arg("line") = -1,                                                                      //
-                    py::arg("col") = -1)                                                                       //
+                    py::arg("col") = -1,                                                                       //
+                    py::arg("timeout") = 0.0)                                                                  //
       .def_method_s("eval", &JSContext::EvaluateW,                                                             //
                     py::arg("source"),                                                                         //
                     py::arg("name") = std::wstring(),                                                          //
                     py::arg("line") = -1,                                                                      //
-                    py::arg("col") = -1)                                                                       //
+                    py::arg("col") = -1,                                                                       //
+                    py::arg("timeout") = 0.0)                                                                  //
                                                                                                                //
       .def_method("enter", &JSContext::Enter,                                                                  //
                   "Enter this context. "                                                                       //
@@ -376,4 +617,57 @@ void exposeJSContext(py::module py_module) {
                   "Exiting the current context restores the context "                                          //
                   "that was in place when entering the current context.")                                      //
       ;
-}
\ No newline at end of file
+}
+
+void exposeJSSharedBuffer(py::module py_module) {
+  TRACE("exposeJSSharedBuffer py_module={}", py_module);
+  auto doc = "JSSharedBuffer is memory shared by Python and JS contexts of any isolate as SharedArrayBuffer.";
+  py::naga_class<JSSharedBuffer, SharedJSSharedBufferPtr>(py_module, "JSSharedBuffer", doc)              //
+      .def_ctor(py::init<py::object>(),                                                                  //
+                py::arg("source"),                                                                       //
+                "Wraps an object supporting the buffer protocol (e.g. bytearray or mmap) "               //
+                "or allocates a zeroed buffer when given an int size.")                                  //
+                                                                                                         //
+      .def_property_r("size", &JSSharedBuffer::Size,                                                     //
+                      "Size of the buffer in bytes.")                                                    //
+      .def_property_r("owner", &JSSharedBuffer::GetOwner,                                                //
+                      "Python object owning the memory.")                                                //
+      .def_property_r("memory", &JSSharedBuffer::GetMemoryView,                                          //
+                      "Byte memoryview of the shared memory.")                                           //
+                                                                                                         //
+      .def_method("install", &JSSharedBuffer::Install,                                                   //
+                  py::arg("context"),                                                                    //
+                  py::arg("name"),                                                                       //
+                  "Installs a SharedArrayBuffer over this memory as a global variable of the context. "  //
+                  "The context may belong to any isolate.")                                              //
+      .def_method("to_js", &JSSharedBuffer::ToJS,                                                        //
+                  "Returns a SharedArrayBuffer over this memory for the current context.")               //
+                                                                                                         //
+      .def_method("load", &JSSharedBuffer::Load,                                                         //
+                  py::arg("index"),                                                                      //
+                  "Atomically loads the int32 slot at index.")                                           //
+      .def_method("store", &JSSharedBuffer::Store,                                                       //
+                  py::arg("index"),                                                                      //
+                  py::arg("value"),                                                                      //
+                  "Atomically stores value into the int32 slot at index.")                               //
+      .def_method("add", &JSSharedBuffer::Add,                                                           //
+                  py::arg("index"),                                                                      //
+                  py::arg("delta"),                                                                      //
+                  "Atomically adds delta to the int32 slot at index, returns the previous value.")       //
+      .def_method("compare_exchange", &JSSharedBuffer::CompareExchange,                                  //
+                  py::arg("index"),                                                                      //
+                  py::arg("expected"),                                                                   //
+                  py::arg("value"),                                                                      //
+                  "Like Atomics.compareExchange on the int32 slot at index.")                            //
+      .def_method("wait", &JSSharedBuffer::Wait,                                                         //
+                  py::arg("index"),                                                                      //
+                  py::arg("value"),                                                                      //
+                  py::arg("timeout") = -1.0,                                                             //
+                  "Like Atomics.wait on the int32 slot at index, timeout in seconds. "                   //
+                  "Releases the GIL while waiting.")                                                     //
+      .def_method("notify", &JSSharedBuffer::Notify,                                                     //
+                  py::arg("index"),                                                                      //
+                  py::arg("count") = -1,                                                                 //
+                  "Like Atomics.notify, wakes Python and JS waiters on the int32 slot at index.")        //
+      ;
+}
@@ -17,6 +17,10 @@ void exposeJSStackFrame(py::module py_module);
 void exposeJSStackTrace(py::module py_module);
 void exposeJSEngine(py::module py_module);
 void exposeJSScript(py::module py_module);
+void exposeJSScriptFuture(py::module py_module);
+void exposeJSModule(py::module py_module);
+void exposeJSBundle(py::module py_module);
 void exposeJSContext(py::module py_module);
+void exposeJSSharedBuffer(py::module py_module);
 
 #endif
\ No newline at end of file
@@ -31,7 +31,11 @@ PYBIND11_MODULE(naga_native, py_module) {
   exposeJSStackTrace(py_module);
   exposeJSException(py_module);
   exposeJSContext(py_module);
+  exposeJSSharedBuffer(py_module);
   exposeJSScript(py_module);
+  exposeJSScriptFuture(py_module);
+  exposeJSModule(py_module);
+  exposeJSBundle(py_module);
   exposeJSEngine(py_module);
 
   g_naga_native_module = py_module;
@@ -27,6 +27,7 @@ class PythonObject {
   static v8::Local<v8::ObjectTemplate> CreateJSWrapperTemplate(v8x::LockedIsolatePtr& v8_isolate);
   static v8::Local<v8::ObjectTemplate> GetOrCreateCachedJSWrapperTemplate(v8x::LockedIsolatePtr& v8_isolate);
 
+  static v8::Local<v8::Value> CreateJSError(v8x::LockedIsolatePtr& v8_isolate, const py::error_already_set& py_ex);
   static void ThrowJSException(v8x::LockedIsolatePtr& v8_isolate,
                                const py::error_already_set& py_ex = py::error_already_set());
 };
@@ -1,7 +1,9 @@
 #include "PythonObject.h"
 #include "PythonExceptions.h"
+#include "PythonCoroutine.h"
 #include "JSTracer.h"
 #include "Wrapping.h"
+#include "JSBoundaryProfiler.h"
 #include "Logging.h"
 #include "PythonUtils.h"
 #include "Utils.h"
@@ -28,13 +30,14 @@ void PythonObject::CallWrapperAsFunction(const v8::FunctionCallbackInfo<v8::Valu
 
 void PythonObject::CallPythonCallable(const py::object& py_fn, const v8::FunctionCallbackInfo<v8::Value>& v8_info) {
   TRACE("CPythonObject::CallPythonCallable py_fn={} v8_info={}", S$(py_fn.ptr()), v8_info);
+  auto boundary = JSBoundaryScope(v8_info.GetIsolate(), JSBoundaryProfiler::kCallPythonCallable);
   assert(PyCallable_Check(py_fn.ptr()));
   auto v8_isolate = v8x::lockIsolate(v8_info.GetIsolate());
   auto v8_scope = v8x::withScope(v8_isolate);
 
   auto py_gil = pyu::withGIL();
   auto v8_result = withPythonErrorInterception(v8_isolate, [&] {
-    return wrap([&]() {
+    auto py_result = [&]() {
       switch (v8_info.Length()) {
         case 0:                                        //
           return py_fn();                              //
@@ -108,7 +111,13 @@ void PythonObject::CallPythonCallable(const py::object& py_fn, const v8::Functio
           v8_isolate->ThrowException(v8::Exception::Error(v8_msg));
           return py::js_undefined().cast<py::object>();
       }
-    }());
+    }();
+
+    // calling a coroutine function gives us a coroutine object, JS land gets a promise instead
+    if (isPythonCoroutine(py_result)) {
+      return wrapCoroutine(v8_isolate, py_result);
+    }
+    return wrap(py_result);
   });
 
   auto v8_final_result = VALUE_OR_LAZY(v8_result, v8::Undefined(v8_isolate));
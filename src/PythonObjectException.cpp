@@ -121,10 +121,11 @@ static void attachPythonInfoToV8Error(v8x::LockedIsolatePtr& v8_isolate,
   });
 }
 
-void PythonObject::ThrowJSException(v8x::LockedIsolatePtr& v8_isolate, const py::error_already_set& py_ex) {
-  TRACE("CPythonObject::ThrowJSException");
+v8::Local<v8::Value> PythonObject::CreateJSError(v8x::LockedIsolatePtr& v8_isolate,
+                                                 const py::error_already_set& py_ex) {
+  TRACE("CPythonObject::CreateJSError");
   auto py_gil = pyu::withGIL();
-  auto v8_scope = v8x::withScope(v8_isolate);
+  auto v8_scope = v8x::withEscapableScope(v8_isolate);
 
   // note we don't need to call PyErr_NormalizeException
   // py::error_already_set in its constructor called py::detail::error_string() which did the normalization
@@ -137,5 +138,11 @@ void PythonObject::ThrowJSException(v8x::LockedIsolatePtr& v8_isolate, const py:
     attachPythonInfoToV8Error(v8_isolate, v8_error_object, py_ex.type(), py_ex.value());
   }
 
-  v8_isolate->ThrowException(v8_error);
+  return v8_scope.Escape(v8_error);
+}
+
+void PythonObject::ThrowJSException(v8x::LockedIsolatePtr& v8_isolate, const py::error_already_set& py_ex) {
+  TRACE("CPythonObject::ThrowJSException");
+  auto v8_scope = v8x::withScope(v8_isolate);
+  v8_isolate->ThrowException(CreateJSError(v8_isolate, py_ex));
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "PythonObject.h"
 #include "PythonExceptions.h"
 #include "Wrapping.h"
+#include "JSBoundaryProfiler.h"
 #include "Logging.h"
 #include "PythonUtils.h"
 #include "Printing.h"
@@ -13,6 +14,7 @@
 
 void PythonObject::IndexedGetter(uint32_t index, const v8::PropertyCallbackInfo<v8::Value>& v8_info) {
   TRACE("CPythonObject::IndexedGetter index={} v8_info={}", index, v8_info);
+  auto boundary = JSBoundaryScope(v8_info.GetIsolate(), JSBoundaryProfiler::kIndexedGetter);
   auto v8_isolate = v8x::lockIsolate(v8_info.GetIsolate());
   auto v8_scope = v8x::withScope(v8_isolate);
 
@@ -61,6 +63,7 @@ void PythonObject::IndexedSetter(uint32_t index,
                                  v8::Local<v8::Value> v8_value,
                                  const v8::PropertyCallbackInfo<v8::Value>& v8_info) {
   TRACE("CPythonObject::IndexedSetter index={} v8_value={} v8_info={}", index, v8_value, v8_info);
+  auto boundary = JSBoundaryScope(v8_info.GetIsolate(), JSBoundaryProfiler::kIndexedSetter);
   auto v8_isolate = v8x::lockIsolate(v8_info.GetIsolate());
   auto v8_scope = v8x::withScope(v8_isolate);
 
@@ -95,6 +98,7 @@ void PythonObject::IndexedSetter(uint32_t index,
 
 void PythonObject::IndexedQuery(uint32_t index, const v8::PropertyCallbackInfo<v8::Integer>& v8_info) {
   TRACE("CPythonObject::IndexedQuery index={} v8_info={}", index, v8_info);
+  auto boundary = JSBoundaryScope(v8_info.GetIsolate(), JSBoundaryProfiler::kIndexedQuery);
   auto v8_isolate = v8x::lockIsolate(v8_info.GetIsolate());
   auto v8_scope = v8x::withScope(v8_isolate);
 
@@ -136,6 +140,7 @@ void PythonObject::IndexedQuery(uint32_t index, const v8::PropertyCallbackInfo<v
 
 void PythonObject::IndexedDeleter(uint32_t index, const v8::PropertyCallbackInfo<v8::Boolean>& v8_info) {
   TRACE("CPythonObject::IndexedDeleter index={} v8_info={}", index, v8_info);
+  auto boundary = JSBoundaryScope(v8_info.GetIsolate(), JSBoundaryProfiler::kIndexedDeleter);
   auto v8_isolate = v8x::lockIsolate(v8_info.GetIsolate());
   auto v8_scope = v8x::withScope(v8_isolate);
 
@@ -163,6 +168,7 @@ void PythonObject::IndexedDeleter(uint32_t index, const v8::PropertyCallbackInfo
 
 void PythonObject::IndexedEnumerator(const v8::PropertyCallbackInfo<v8::Array>& v8_info) {
   TRACE("CPythonObject::IndexedEnumerator v8_info={}", v8_info);
+  auto boundary = JSBoundaryScope(v8_info.GetIsolate(), JSBoundaryProfiler::kIndexedEnumerator);
   auto v8_isolate = v8x::lockIsolate(v8_info.GetIsolate());
   auto v8_scope = v8x::withScope(v8_isolate);
 
@@ -2,6 +2,7 @@
 #include "JSException.h"
 #include "PythonExceptions.h"
 #include "JSTracer.h"
+#include "JSBoundaryProfiler.h"
 #include "Wrapping.h"
 #include "Logging.h"
 #include "Printing.h"
@@ -42,6 +43,7 @@ void toStringImpl(const v8::PropertyCallbackInfo<v8::Value>& v8_info) {
 
 void PythonObject::NamedGetter(v8::Local<v8::Name> v8_name, const v8::PropertyCallbackInfo<v8::Value>& v8_info) {
   TRACE("CPythonObject::NamedGetter v8_name={} v8_info={}", v8_name, v8_info);
+  auto boundary = JSBoundaryScope(v8_info.GetIsolate(), JSBoundaryProfiler::kNamedGetter);
   auto v8_isolate = v8x::lockIsolate(v8_info.GetIsolate());
   if (v8_name->IsSymbol()) {
     if (v8_name->StrictEquals(v8::Symbol::GetToStringTag(v8_isolate))) {
@@ -107,6 +109,7 @@ void PythonObject::NamedSetter(v8::Local<v8::Name> v8_name,
                                v8::Local<v8::Value> v8_value,
                                const v8::PropertyCallbackInfo<v8::Value>& v8_info) {
   TRACE("CPythonObject::NamedSetter v8_name={} v8_value={} v8_info={}", v8_name, v8_value, v8_info);
+  auto boundary = JSBoundaryScope(v8_info.GetIsolate(), JSBoundaryProfiler::kNamedSetter);
   auto v8_isolate = v8x::lockIsolate(v8_info.GetIsolate());
   if (v8_name->IsSymbol()) {
     // ignore symbols for now, see https://github.com/area1/stpyv8/issues/8
@@ -140,6 +143,7 @@ void PythonObject::NamedSetter(v8::Local<v8::Name> v8_name,
 
 void PythonObject::NamedQuery(v8::Local<v8::Name> v8_name, const v8::PropertyCallbackInfo<v8::Integer>& v8_info) {
   TRACE("CPythonObject::NamedQuery v8_name={} v8_info={}", v8_name, v8_info);
+  auto boundary = JSBoundaryScope(v8_info.GetIsolate(), JSBoundaryProfiler::kNamedQuery);
   auto v8_isolate = v8x::lockIsolate(v8_info.GetIsolate());
   if (v8_name->IsSymbol()) {
     // ignore symbols for now, see https://github.com/area1/stpyv8/issues/8
@@ -170,6 +174,7 @@ void PythonObject::NamedQuery(v8::Local<v8::Name> v8_name, const v8::PropertyCal
 
 void PythonObject::NamedDeleter(v8::Local<v8::Name> v8_name, const v8::PropertyCallbackInfo<v8::Boolean>& v8_info) {
   TRACE("CPythonObject::NamedQuery v8_name={} v8_info={}", v8_name, v8_info);
+  auto boundary = JSBoundaryScope(v8_info.GetIsolate(), JSBoundaryProfiler::kNamedDeleter);
   auto v8_isolate = v8x::lockIsolate(v8_info.GetIsolate());
   if (v8_name->IsSymbol()) {
     // ignore symbols for now, see https://github.com/area1/stpyv8/issues/8
@@ -216,6 +221,7 @@ void PythonObject::NamedDeleter(v8::Local<v8::Name> v8_name, const v8::PropertyC
 
 void PythonObject::NamedEnumerator(const v8::PropertyCallbackInfo<v8::Array>& v8_info) {
   TRACE("CPythonObject::NamedEnumerator v8_info={}", v8_info);
+  auto boundary = JSBoundaryScope(v8_info.GetIsolate(), JSBoundaryProfiler::kNamedEnumerator);
   auto v8_isolate = v8x::lockIsolate(v8_info.GetIsolate());
 
   auto v8_result = withPythonErrorInterception(v8_isolate, [&]() {
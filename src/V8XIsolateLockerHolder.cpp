@@ -8,7 +8,9 @@
 
 namespace v8x {
 
-IsolateLockerHolder::IsolateLockerHolder(v8::Isolate* v8_isolate) : m_v8_isolate(v8_isolate) {
+IsolateLockerHolder::IsolateLockerHolder(v8::Isolate* v8_isolate)
+    : m_v8_isolate(v8_isolate),
+      m_time_slicer(v8_isolate) {
   TRACE("IsolateLocker::IsolateLocker {} v8_isolate={}", THIS, P$(m_v8_isolate));
 }
 
@@ -17,31 +19,66 @@ IsolateLockerHolder::~IsolateLockerHolder() {
 }
 
 SharedIsolateLockerPtr IsolateLockerHolder::CreateOrShareLocker() {
-  // if locker already exists, just share it
-  if (auto shared_locker = m_v8_weak_locker.lock()) {
-    TRACE("IsolateLocker::CreateOrShareLocker {} v8_isolate={} sharing existing locker {}", THIS, P$(m_v8_isolate),
-          (void*)shared_locker.get());
-    return shared_locker;
-  } else {
-    // else create new locker inplace and share it
-    auto v8_locker_ptr = new (m_v8_locker_storage.data()) LockerType(m_v8_isolate);
-    auto new_shared_locker = SharedIsolateLockerPtr(v8_locker_ptr, DeleteInplaceLocker);
-    TRACE("IsolateLocker::CreateOrShareLocker {} v8_isolate={} creating new locker {}", THIS, P$(m_v8_isolate),
-          (void*)new_shared_locker.get());
-    m_v8_weak_locker = new_shared_locker;
-    return new_shared_locker;
+  auto this_thread = std::this_thread::get_id();
+  auto already_locked = v8::Locker::IsLocked(m_v8_isolate);
+
+  // if this thread already has a locker, just share it
+  if (already_locked && m_v8_weak_locker_thread == this_thread) {
+    if (auto shared_locker = m_v8_weak_locker.lock()) {
+      TRACE("IsolateLocker::CreateOrShareLocker {} v8_isolate={} sharing existing locker {}", THIS, P$(m_v8_isolate),
+            (void*)shared_locker.get());
+      return shared_locker;
+    }
+  }
+
+  // else create a new locker and share it
+  // nested lockers (this thread holds the lock via a locker created elsewhere) do not take part in time-slicing
+  auto time_sliced = !already_locked && m_time_slicer.Acquire();
+  auto v8_locker_ptr = NewLocker();
+  if (time_sliced) {
+    // the slice starts now that we hold the isolate lock
+    m_time_slicer.Started();
   }
+  auto new_shared_locker = SharedIsolateLockerPtr(v8_locker_ptr, [this, time_sliced](v8::Locker* p) {
+    DeleteLocker(static_cast<LockerType*>(p));
+    if (time_sliced) {
+      m_time_slicer.Release();
+    }
+  });
+  TRACE("IsolateLocker::CreateOrShareLocker {} v8_isolate={} creating new locker {}", THIS, P$(m_v8_isolate),
+        (void*)new_shared_locker.get());
+  // we hold the isolate lock at this point
+  m_v8_weak_locker = new_shared_locker;
+  m_v8_weak_locker_thread = this_thread;
+  return new_shared_locker;
 }
 
-void IsolateLockerHolder::DeleteInplaceLocker(LockerType* p) {
-  TRACE("IsolateLockerHolder::DeleteInplaceLocker locker={}", (void*)p);
-  // just call the destructor
-  // deallocation is not needed because we keep the buffer for future usage
-  p->~LockerType();
+IsolateLockerHolder::LockerType* IsolateLockerHolder::NewLocker() {
+  auto expected = false;
+  if (m_v8_locker_storage_taken.compare_exchange_strong(expected, true)) {
+    return new (m_v8_locker_storage.data()) LockerType(m_v8_isolate);
+  }
+  return new LockerType(m_v8_isolate);
+}
+
+void IsolateLockerHolder::DeleteLocker(LockerType* p) {
+  TRACE("IsolateLockerHolder::DeleteLocker locker={}", (void*)p);
+  if (static_cast<void*>(p) == m_v8_locker_storage.data()) {
+    // just call the destructor
+    // deallocation is not needed because we keep the buffer for future usage
+    p->~LockerType();
+    m_v8_locker_storage_taken = false;
+  } else {
+    delete p;
+  }
 }
 
 LockedIsolatePtr IsolateLockerHolder::GetLockedIsolate() {
   return LockedIsolatePtr(m_v8_isolate, CreateOrShareLocker());
 }
 
-}  // namespace v8x
\ No newline at end of file
+TimeSlicer& IsolateLockerHolder::GetTimeSlicer() {
+  return m_time_slicer;
+}
+
+}  // namespace v8x
@@ -3,16 +3,31 @@
 
 #include "Base.h"
 #include "V8XObservedLocker.h"
+#include "V8XTimeSlicer.h"
+
+#include <atomic>
+#include <thread>
 
 namespace v8x {
 
+// IsolateLockerHolder hands out shared lockers for the isolate.
+//
+// A thread already holding the isolate lock gets its existing locker shared. Other threads create their own top-level
+// locker. We keep one inplace storage to avoid heap allocation in the common case, it is claimed atomically, lockers
+// created while it is taken (e.g. by another thread which yielded the isolate via v8::Unlocker) live on the heap.
+// m_v8_weak_locker and m_v8_weak_locker_thread are only touched by the thread which currently holds the isolate lock.
+
 class IsolateLockerHolder {
   using LockerType = ObservedLocker;
   v8::Isolate* m_v8_isolate;
   WeakIsolateLockerPtr m_v8_weak_locker;
+  std::thread::id m_v8_weak_locker_thread;
+  std::atomic<bool> m_v8_locker_storage_taken{false};
   alignas(LockerType) std::array<std::byte, sizeof(LockerType)> m_v8_locker_storage;
+  TimeSlicer m_time_slicer;
 
-  static void DeleteInplaceLocker(LockerType* p);
+  LockerType* NewLocker();
+  void DeleteLocker(LockerType* p);
 
  public:
   explicit IsolateLockerHolder(v8::Isolate* v8_isolate);
@@ -20,8 +35,10 @@ class IsolateLockerHolder {
 
   SharedIsolateLockerPtr CreateOrShareLocker();
   LockedIsolatePtr GetLockedIsolate();
+
+  TimeSlicer& GetTimeSlicer();
 };
 
 }  // namespace v8x
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,68 @@
+#ifndef NAGA_V8XMPSCQUEUE_H_
+#define NAGA_V8XMPSCQUEUE_H_
+
+#include "Base.h"
+
+#include <atomic>
+#include <optional>
+
+namespace v8x {
+
+// MPSCQueue is an unbounded lock-free queue for many producers and a single consumer (Vyukov's node-based design).
+//
+// Push is wait-free: one atomic exchange plus one store. Pop never blocks but may transiently see the queue as empty
+// while a producer is between its exchange and store. Consumers must be prepared to be poked again later, which
+// JSMailbox does by scheduling a new dispatch task after every push into an unscheduled mailbox.
+
+template <typename T>
+class MPSCQueue {
+  struct Node {
+    std::atomic<Node*> m_next{nullptr};
+    std::optional<T> m_value;
+  };
+
+  alignas(64) std::atomic<Node*> m_head;  // producers
+  alignas(64) Node* m_tail;               // consumer
+  std::atomic<size_t> m_size{0};
+
+ public:
+  MPSCQueue() : m_head(new Node()), m_tail(m_head.load()) {}
+  ~MPSCQueue() {
+    while (Pop()) {
+    }
+    delete m_tail;
+  }
+  MPSCQueue(const MPSCQueue&) = delete;
+  MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+  // may be called from any thread
+  void Push(T value) {
+    auto node = new Node();
+    node->m_value.emplace(std::move(value));
+    m_size.fetch_add(1, std::memory_order_relaxed);
+    auto prev = m_head.exchange(node, std::memory_order_acq_rel);
+    prev->m_next.store(node, std::memory_order_release);
+  }
+
+  // must be called by one thread at a time
+  std::optional<T> Pop() {
+    auto tail = m_tail;
+    auto next = tail->m_next.load(std::memory_order_acquire);
+    if (!next) {
+      return std::nullopt;
+    }
+    m_tail = next;
+    std::optional<T> value(std::move(next->m_value));
+    next->m_value.reset();
+    delete tail;
+    m_size.fetch_sub(1, std::memory_order_relaxed);
+    return value;
+  }
+
+  // approximate when producers are active
+  size_t Size() const { return m_size.load(std::memory_order_relaxed); }
+};
+
+}  // namespace v8x
+
+#endif
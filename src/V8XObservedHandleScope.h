@@ -4,10 +4,14 @@
 #include "Base.h"
 #include "Logging.h"
 #include "V8XLockedIsolate.h"
-#include "V8XProtectedIsolate.h"
 
 namespace v8x {
 
+// Observed scopes trace scope nesting and the number of released handles, and keep handle scope levels
+// for hasScope() asserts. Without NAGA_ENABLE_TRACING they are plain V8 handle scopes.
+
+#if defined(NAGA_ENABLE_TRACING)
+
 class ObservedHandleScope : public v8::HandleScope {
   int m_start_num_handles;
 
@@ -20,7 +24,8 @@ class ObservedHandleScope : public v8::HandleScope {
     increaseCurrentHandleScopeLevel(v8_isolate);
   }
   ~ObservedHandleScope() {
-    auto v8_isolate = ProtectedIsolatePtr(this->GetIsolate()).lock();
+    // the isolate is still locked by whoever opened this scope, no need to lock it again
+    auto v8_isolate = this->GetIsolate();
     decreaseCurrentHandleScopeLevel(v8_isolate);
     LOGGER_INDENT_DECREASE;
     HTRACE(kHandleScopeLogger, "}} ~HandleScope (releasing {} handles)", [&] {
@@ -43,7 +48,7 @@ class ObservedEscapableHandleScope : public v8::EscapableHandleScope {
     increaseCurrentHandleScopeLevel(v8_isolate);
   }
   ~ObservedEscapableHandleScope() {
-    auto v8_isolate = ProtectedIsolatePtr(this->GetIsolate()).lock();
+    auto v8_isolate = this->GetIsolate();
     decreaseCurrentHandleScopeLevel(v8_isolate);
     LOGGER_INDENT_DECREASE;
     HTRACE(kHandleScopeLogger, "}} ~EscapableHandleScope (releasing {} handles)", [&] {
@@ -54,6 +59,13 @@ class ObservedEscapableHandleScope : public v8::EscapableHandleScope {
   }
 };
 
+#else
+
+using ObservedHandleScope = v8::HandleScope;
+using ObservedEscapableHandleScope = v8::EscapableHandleScope;
+
+#endif
+
 }  // namespace v8x
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,91 @@
+#include "V8XPlatform.h"
+#include "Logging.h"
+#include "Printing.h"
+
+#define TRACE(...) \
+  LOGGER_INDENT;   \
+  SPDLOG_LOGGER_TRACE(getLogger(kJSPlatformLogger), __VA_ARGS__)
+
+namespace v8x {
+
+static v8::platform::IdleTaskSupport idleTaskSupport(bool enabled) {
+  return enabled ? v8::platform::IdleTaskSupport::kEnabled : v8::platform::IdleTaskSupport::kDisabled;
+}
+
+Platform::Platform(WorkerPoolConfig config, bool idle_tasks)
+    : m_v8_default_platform(v8::platform::NewDefaultPlatform(1, idleTaskSupport(idle_tasks))),
+      m_worker_pool(std::make_unique<WorkerPool>(std::move(config))),
+      m_idle_tasks(idle_tasks) {
+  TRACE("Platform::Platform {} idle_tasks={}", THIS, idle_tasks);
+}
+
+Platform::~Platform() {
+  TRACE("Platform::~Platform {}", THIS);
+  m_worker_pool->Terminate();
+}
+
+v8::Platform* Platform::DefaultPlatform() const {
+  return m_v8_default_platform.get();
+}
+
+WorkerPool& Platform::Workers() const {
+  return *m_worker_pool;
+}
+
+int Platform::NumberOfWorkerThreads() {
+  return m_worker_pool->NumberOfWorkers();
+}
+
+std::shared_ptr<v8::TaskRunner> Platform::GetForegroundTaskRunner(v8::Isolate* v8_isolate) {
+  return m_v8_default_platform->GetForegroundTaskRunner(v8_isolate);
+}
+
+void Platform::CallOnWorkerThread(std::unique_ptr<v8::Task> task) {
+  m_worker_pool->PostTask(v8::TaskPriority::kUserVisible, std::move(task));
+}
+
+void Platform::CallBlockingTaskOnWorkerThread(std::unique_ptr<v8::Task> task) {
+  m_worker_pool->PostTask(v8::TaskPriority::kUserBlocking, std::move(task));
+}
+
+void Platform::CallLowPriorityTaskOnWorkerThread(std::unique_ptr<v8::Task> task) {
+  m_worker_pool->PostTask(v8::TaskPriority::kBestEffort, std::move(task));
+}
+
+void Platform::CallDelayedOnWorkerThread(std::unique_ptr<v8::Task> task, double delay_in_seconds) {
+  m_worker_pool->PostDelayedTask(std::move(task), delay_in_seconds);
+}
+
+bool Platform::IdleTasksEnabled(v8::Isolate* /* v8_isolate */) {
+  return m_idle_tasks;
+}
+
+std::unique_ptr<v8::JobHandle> Platform::PostJob(v8::TaskPriority priority, std::unique_ptr<v8::JobTask> job_task) {
+  return m_v8_default_platform->PostJob(priority, std::move(job_task));
+}
+
+double Platform::MonotonicallyIncreasingTime() {
+  return m_v8_default_platform->MonotonicallyIncreasingTime();
+}
+
+double Platform::CurrentClockTimeMillis() {
+  return m_v8_default_platform->CurrentClockTimeMillis();
+}
+
+v8::TracingController* Platform::GetTracingController() {
+  return m_v8_default_platform->GetTracingController();
+}
+
+v8::PageAllocator* Platform::GetPageAllocator() {
+  return m_v8_default_platform->GetPageAllocator();
+}
+
+void Platform::OnCriticalMemoryPressure() {
+  m_v8_default_platform->OnCriticalMemoryPressure();
+}
+
+v8::Platform::StackTracePrinter Platform::GetStackTracePrinter() {
+  return m_v8_default_platform->GetStackTracePrinter();
+}
+
+}  // namespace v8x
@@ -0,0 +1,47 @@
+#ifndef NAGA_V8XPLATFORM_H_
+#define NAGA_V8XPLATFORM_H_
+
+#include "Base.h"
+#include "V8XWorkerPool.h"
+
+namespace v8x {
+
+// Platform is our implementation of v8::Platform which runs V8 background tasks on our own WorkerPool.
+//
+// Everything which is not about worker threads (foreground task runners, tracing, page allocator, ...) is delegated
+// to the V8's default platform. The default platform is created with a single worker thread which is then used only
+// by V8 jobs (PostJob) - the 8.5 API does not give us a way to run jobs on top of a foreign pool.
+// Foreground tasks still need to be pumped via v8::platform::PumpMessageLoop on DefaultPlatform().
+
+class Platform : public v8::Platform {
+  std::unique_ptr<v8::Platform> m_v8_default_platform;
+  std::unique_ptr<WorkerPool> m_worker_pool;
+  bool m_idle_tasks;
+
+ public:
+  Platform(WorkerPoolConfig config, bool idle_tasks);
+  ~Platform() override;
+
+  v8::Platform* DefaultPlatform() const;
+  WorkerPool& Workers() const;
+
+  // v8::Platform
+  int NumberOfWorkerThreads() override;
+  std::shared_ptr<v8::TaskRunner> GetForegroundTaskRunner(v8::Isolate* v8_isolate) override;
+  void CallOnWorkerThread(std::unique_ptr<v8::Task> task) override;
+  void CallBlockingTaskOnWorkerThread(std::unique_ptr<v8::Task> task) override;
+  void CallLowPriorityTaskOnWorkerThread(std::unique_ptr<v8::Task> task) override;
+  void CallDelayedOnWorkerThread(std::unique_ptr<v8::Task> task, double delay_in_seconds) override;
+  bool IdleTasksEnabled(v8::Isolate* v8_isolate) override;
+  std::unique_ptr<v8::JobHandle> PostJob(v8::TaskPriority priority, std::unique_ptr<v8::JobTask> job_task) override;
+  double MonotonicallyIncreasingTime() override;
+  double CurrentClockTimeMillis() override;
+  v8::TracingController* GetTracingController() override;
+  v8::PageAllocator* GetPageAllocator() override;
+  void OnCriticalMemoryPressure() override;
+  StackTracePrinter GetStackTracePrinter() override;
+};
+
+}  // namespace v8x
+
+#endif
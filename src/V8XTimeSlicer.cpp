@@ -0,0 +1,193 @@
+#include "V8XTimeSlicer.h"
+#include "Logging.h"
+#include "Printing.h"
+
+#include <algorithm>
+
+#define TRACE(...) \
+  LOGGER_INDENT;   \
+  SPDLOG_LOGGER_TRACE(getLogger(kIsolateLockingLogger), __VA_ARGS__)
+
+namespace v8x {
+
+static double toSeconds(std::chrono::steady_clock::duration duration) {
+  return std::chrono::duration<double>(duration).count();
+}
+
+TimeSlicer::TimeSlicer(v8::Isolate* v8_isolate) : m_v8_isolate(v8_isolate) {
+  TRACE("TimeSlicer::TimeSlicer {} v8_isolate={}", THIS, P$(v8_isolate));
+}
+
+void TimeSlicer::Enable(double quantum_in_seconds) {
+  TRACE("TimeSlicer::Enable {} quantum_in_seconds={}", THIS, quantum_in_seconds);
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_quantum = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(quantum_in_seconds));
+  m_enabled = true;
+}
+
+void TimeSlicer::Disable() {
+  TRACE("TimeSlicer::Disable {}", THIS);
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_enabled = false;
+  }
+  // current waiters will still be served in order, but nobody gets preempted anymore
+  m_cv.notify_all();
+}
+
+bool TimeSlicer::Enabled() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_enabled;
+}
+
+bool TimeSlicer::Acquire() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (!m_enabled) {
+    return false;
+  }
+  AcquireLocked(lock);
+  return true;
+}
+
+void TimeSlicer::AcquireLocked(std::unique_lock<std::mutex>& lock) {
+  m_num_acquires++;
+  if (!m_held && m_waiters.empty()) {
+    m_held = true;
+    return;
+  }
+
+  auto ticket = ++m_last_ticket;
+  m_waiters.push_back(ticket);
+  m_num_waits++;
+  TRACE("TimeSlicer::AcquireLocked {} waiting with ticket={} waiters={}", THIS, ticket, m_waiters.size());
+
+  // the holder might need GIL to make progress (e.g. calling Python from JS)
+  std::optional<py::gil_scoped_release> py_gil_release;
+  if (PyGILState_Check()) {
+    lock.unlock();
+    py_gil_release.emplace();
+    lock.lock();
+  }
+
+  auto wait_start = Clock::now();
+  while (m_held || m_waiters.front() != ticket) {
+    if (!m_held || m_owner == std::thread::id()) {
+      // the lock is free but somebody else is first in line,
+      // or the next in line is still waiting for its v8::Locker and there is nobody to interrupt
+      m_cv.wait(lock);
+      continue;
+    }
+    auto slice_end = m_slice_start + m_quantum;
+    if (Clock::now() < slice_end) {
+      m_cv.wait_until(lock, slice_end);
+      continue;
+    }
+    if (m_enabled && !m_interrupt_requested) {
+      m_interrupt_requested = true;
+      m_v8_isolate->RequestInterrupt(InterruptCallback, this);
+    }
+    // the holder yields when JS code hits the interrupt or when it releases the lock, whatever comes first
+    m_cv.wait(lock);
+  }
+
+  m_waiters.pop_front();
+  m_held = true;
+
+  auto waited = Clock::now() - wait_start;
+  m_total_wait += waited;
+  m_max_wait = std::max(m_max_wait, waited);
+
+  lock.unlock();
+  py_gil_release.reset();
+  lock.lock();
+}
+
+void TimeSlicer::Started() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    StartedLocked();
+  }
+  // waiters can start measuring our quantum now
+  m_cv.notify_all();
+}
+
+void TimeSlicer::StartedLocked() {
+  // the caller holds the isolate lock now
+  assert(m_held && m_owner == std::thread::id());
+  m_owner = std::this_thread::get_id();
+  m_slice_start = Clock::now();
+}
+
+void TimeSlicer::Release() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // only the thread owning the slice may give it away
+    assert(m_owner == std::this_thread::get_id());
+    if (m_owner != std::this_thread::get_id()) {
+      return;
+    }
+    ReleaseLocked();
+  }
+  m_cv.notify_all();
+}
+
+void TimeSlicer::ReleaseLocked() {
+  assert(m_held);
+  m_held = false;
+  m_owner = std::thread::id();
+  if (!m_waiters.empty()) {
+    m_num_handoffs++;
+  }
+}
+
+void TimeSlicer::InterruptCallback(v8::Isolate* v8_isolate, void* data) {
+  auto time_slicer = static_cast<TimeSlicer*>(data);
+  assert(time_slicer->m_v8_isolate == v8_isolate);
+  time_slicer->Yield();
+}
+
+void TimeSlicer::Yield() {
+  // we are on the thread holding the isolate lock, in the middle of JS execution
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_interrupt_requested = false;
+  // the interrupt may hit a thread holding the isolate without a slice, e.g. a nested or non-sliced locker
+  if (!m_held || m_owner != std::this_thread::get_id()) {
+    return;
+  }
+  if (m_waiters.empty() || Clock::now() < m_slice_start + m_quantum) {
+    return;
+  }
+
+  TRACE("TimeSlicer::Yield {} waiters={}", THIS, m_waiters.size());
+  m_num_yields++;
+  ReleaseLocked();
+  lock.unlock();
+
+  {
+    v8::Unlocker v8_unlocker(m_v8_isolate);
+    m_cv.notify_all();
+    lock.lock();
+    // we queue up behind the current waiters
+    AcquireLocked(lock);
+    lock.unlock();
+    // v8_unlocker relocks the isolate here, nobody else is allowed to take it now
+  }
+  Started();
+}
+
+py::dict TimeSlicer::GetStats() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  py::dict py_result;
+  py_result["enabled"] = m_enabled;
+  py_result["quantum"] = toSeconds(m_quantum);
+  py_result["waiters"] = m_waiters.size();
+  py_result["acquires"] = m_num_acquires;
+  py_result["waits"] = m_num_waits;
+  py_result["handoffs"] = m_num_handoffs;
+  py_result["yields"] = m_num_yields;
+  py_result["total_wait_time"] = toSeconds(m_total_wait);
+  py_result["max_wait_time"] = toSeconds(m_max_wait);
+  return py_result;
+}
+
+}  // namespace v8x
@@ -0,0 +1,76 @@
+#ifndef NAGA_V8XTIMESLICER_H_
+#define NAGA_V8XTIMESLICER_H_
+
+#include "Base.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace v8x {
+
+// TimeSlicer implements opt-in cooperative time-slicing between threads sharing one isolate.
+//
+// Without it a thread running a long script keeps the v8::Locker until the script finishes and other threads starve.
+// When enabled, threads acquiring the isolate lock take a ticket and are served in FIFO order. A waiting thread which
+// sees that the current holder has exceeded its quantum asks V8 to interrupt the holder (Isolate::RequestInterrupt).
+// In the interrupt the holder yields the isolate via v8::Unlocker and queues up behind the waiters.
+//
+// Please note that interrupts are only delivered while JS code is running. A thread holding the lock while doing
+// something else (e.g. sitting in Python code) cannot be preempted.
+//
+// Acquire/Release are called by IsolateLockerHolder around top-level lockers only, nested lockers are not affected.
+// Acquire only hands out the turn, the slice starts in Started once the caller has obtained its v8::Locker. Until then
+// the isolate may still be held by a thread which does not take part in time-slicing, and nobody gets interrupted.
+// The slice is owned by the thread which started it, only that thread yields or releases it.
+
+class TimeSlicer {
+  using Clock = std::chrono::steady_clock;
+  using Ticket = uint64_t;
+
+  v8::Isolate* m_v8_isolate;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  bool m_enabled{false};
+  Clock::duration m_quantum{};
+  bool m_held{false};       // a turn was handed out, the slice might not have started yet
+  std::thread::id m_owner;  // the thread holding the isolate lock within its slice, if started
+  bool m_interrupt_requested{false};
+  Clock::time_point m_slice_start;
+  std::deque<Ticket> m_waiters;
+  Ticket m_last_ticket{0};
+
+  // metrics
+  uint64_t m_num_acquires{0};
+  uint64_t m_num_waits{0};
+  uint64_t m_num_handoffs{0};
+  uint64_t m_num_yields{0};
+  Clock::duration m_total_wait{};
+  Clock::duration m_max_wait{};
+
+  static void InterruptCallback(v8::Isolate* v8_isolate, void* data);
+  void AcquireLocked(std::unique_lock<std::mutex>& lock);
+  void StartedLocked();
+  void ReleaseLocked();
+  void Yield();
+
+ public:
+  explicit TimeSlicer(v8::Isolate* v8_isolate);
+
+  void Enable(double quantum_in_seconds);
+  void Disable();
+  bool Enabled();
+
+  // returns true if the caller took part in scheduling and has to call Release later
+  bool Acquire();
+  void Started();
+  void Release();
+
+  py::dict GetStats();
+};
+
+}  // namespace v8x
+
+#endif
@@ -123,16 +123,13 @@ v8::Local<v8::Context> getCurrentContextUnchecked(LockedIsolatePtr& v8_isolate)
   return v8_isolate->GetCurrentContext();
 }
 
-ObservedHandleScope withScope(LockedIsolatePtr& v8_isolate) {
-  return ObservedHandleScope(v8_isolate);
-}
-
-ObservedEscapableHandleScope withEscapableScope(LockedIsolatePtr& v8_isolate) {
-  return ObservedEscapableHandleScope(v8_isolate);
-}
-
 bool hasScope(LockedIsolatePtr& v8_isolate) {
+#if defined(NAGA_ENABLE_TRACING)
   return getCurrentHandleScopeLevel(v8_isolate) > 0;
+#else
+  // handle scope levels are not tracked in this build
+  return true;
+#endif
 }
 
 v8::TryCatch withTryCatch(LockedIsolatePtr& v8_isolate) {
@@ -143,8 +140,9 @@ void checkTryCatch(LockedIsolatePtr& v8_isolate, TryCatchPtr v8_try_catch) {
   JSException::CheckTryCatch(v8_isolate, v8_try_catch);
 }
 
-ProtectedIsolatePtr createIsolate() {
+ProtectedIsolatePtr createIsolate(const v8::ResourceConstraints& v8_constraints) {
   v8::Isolate::CreateParams v8_create_params;
+  v8_create_params.constraints = v8_constraints;
   v8_create_params.array_buffer_allocator = v8::ArrayBuffer::Allocator::NewDefaultAllocator();
   auto v8_isolate = v8::Isolate::New(v8_create_params);
   assert(v8_isolate);
@@ -161,6 +159,12 @@ v8::ScriptOrigin createScriptOrigin(v8::Local<v8::Value> v8_name,
   return v8::ScriptOrigin(v8_name, v8_line, v8_col);
 }
 
+v8::ScriptOrigin createModuleOrigin(LockedIsolatePtr& v8_isolate, v8::Local<v8::Value> v8_name) {
+  return v8::ScriptOrigin(v8_name, v8::Local<v8::Integer>(), v8::Local<v8::Integer>(), v8::Local<v8::Boolean>(),
+                          v8::Local<v8::Integer>(), v8::Local<v8::Value>(), v8::False(v8_isolate),
+                          v8::False(v8_isolate), v8::True(v8_isolate));
+}
+
 v8::Eternal<v8::Private> createEternalPrivateAPI(LockedIsolatePtr& v8_isolate, const char* name) {
   auto v8_key = v8::String::NewFromUtf8(v8_isolate, name).ToLocalChecked();
   auto v8_private_api = v8::Private::ForApi(v8_isolate, v8_key);
@@ -175,4 +179,24 @@ v8::Eternal<v8::String> createEternalString(LockedIsolatePtr& v8_isolate, const
   return v8::Eternal<v8::String>(v8_isolate, toString(v8_isolate, s));
 }
 
+class GlobalHandleCounter : public v8::PersistentHandleVisitor {
+  GlobalHandleCounts& m_counts;
+
+ public:
+  explicit GlobalHandleCounter(GlobalHandleCounts& counts) : m_counts(counts) {}
+
+  void VisitPersistentHandle(v8::Persistent<v8::Value>* /* value */, uint16_t class_id) override {
+    if (class_id < kNumGlobalHandleClasses) {
+      m_counts[class_id]++;
+    }
+  }
+};
+
+GlobalHandleCounts countGlobalHandles(LockedIsolatePtr& v8_isolate) {
+  GlobalHandleCounts counts{};
+  GlobalHandleCounter counter(counts);
+  v8_isolate->VisitHandlesWithClassIds(&counter);
+  return counts;
+}
+
 }  // namespace v8x
\ No newline at end of file
@@ -8,6 +8,8 @@
 #include "V8XLockedIsolate.h"
 #include "V8XProtectedIsolate.h"
 
+#include <array>
+
 namespace v8x {
 
 v8::Local<v8::String> pythonBytesObjectToString(LockedIsolatePtr& v8_isolate, PyObject* raw_bytes_obj);
@@ -30,8 +32,12 @@ v8::Isolate* getCurrentIsolateUnchecked();
 v8::Local<v8::Context> getCurrentContext(LockedIsolatePtr& v8_isolate);
 v8::Local<v8::Context> getCurrentContextUnchecked(LockedIsolatePtr& v8_isolate);
 v8::Context::Scope withContext(v8::Local<v8::Context> v8_context);
-ObservedHandleScope withScope(LockedIsolatePtr& v8_isolate);
-ObservedEscapableHandleScope withEscapableScope(LockedIsolatePtr& v8_isolate);
+inline ObservedHandleScope withScope(LockedIsolatePtr& v8_isolate) {
+  return ObservedHandleScope(v8_isolate);
+}
+inline ObservedEscapableHandleScope withEscapableScope(LockedIsolatePtr& v8_isolate) {
+  return ObservedEscapableHandleScope(v8_isolate);
+}
 bool hasScope(LockedIsolatePtr& v8_isolate);
 v8::TryCatch withTryCatch(LockedIsolatePtr& v8_isolate);
 void checkTryCatch(LockedIsolatePtr& v8_isolate, TryCatchPtr v8_try_catch);
@@ -44,14 +50,33 @@ inline void checkTryCatch(LockedIsolatePtr& v8_isolate, v8::TryCatch& v8_try_cat
 inline AutoTryCatch withAutoTryCatch(LockedIsolatePtr& v8_isolate) {
   return AutoTryCatch{v8_isolate};
 }
-ProtectedIsolatePtr createIsolate();
+ProtectedIsolatePtr createIsolate(const v8::ResourceConstraints& v8_constraints = v8::ResourceConstraints());
 v8::ScriptOrigin createScriptOrigin(v8::Local<v8::Value> v8_name,
                                     v8::Local<v8::Integer> v8_line,
                                     v8::Local<v8::Integer> v8_col);
+v8::ScriptOrigin createModuleOrigin(LockedIsolatePtr& v8_isolate, v8::Local<v8::Value> v8_name);
 v8::Eternal<v8::Private> createEternalPrivateAPI(LockedIsolatePtr& v8_isolate, const char* name);
 
 LockedIsolatePtr lockIsolate(v8::Isolate* v8_isolate);
 
+// we tag our v8::Global handles with wrapper class ids, so leak accounting can count them per kind
+// see countGlobalHandles, untagged handles (V8 internals, other embedders) are not visited
+enum GlobalHandleClass : uint16_t {
+  kUntaggedHandle = 0,
+  kJSObjectHandle,
+  kJSContextHandle,
+  kJSScriptHandle,
+  kJSModuleHandle,
+  kJSExceptionHandle,
+  kTracerWrapperHandle,
+  kHospitalPatientHandle,
+  kMessagePortHandle,
+  kNumGlobalHandleClasses
+};
+using GlobalHandleCounts = std::array<size_t, kNumGlobalHandleClasses>;
+
+GlobalHandleCounts countGlobalHandles(LockedIsolatePtr& v8_isolate);
+
 }  // namespace v8x
 
 #endif
\ No newline at end of file
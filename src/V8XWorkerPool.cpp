@@ -0,0 +1,231 @@
+#include "V8XWorkerPool.h"
+#include "Logging.h"
+#include "Printing.h"
+
+#include <algorithm>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#define TRACE(...) \
+  LOGGER_INDENT;   \
+  SPDLOG_LOGGER_TRACE(getLogger(kJSPlatformLogger), __VA_ARGS__)
+
+namespace v8x {
+
+static size_t queueIndex(v8::TaskPriority priority) {
+  switch (priority) {
+    case v8::TaskPriority::kUserBlocking:
+      return 0;
+    case v8::TaskPriority::kUserVisible:
+      return 1;
+    case v8::TaskPriority::kBestEffort:
+      return 2;
+  }
+  return 1;
+}
+
+static v8::TaskPriority queuePriority(size_t index) {
+  static const v8::TaskPriority g_priorities[] = {v8::TaskPriority::kUserBlocking, v8::TaskPriority::kUserVisible,
+                                                  v8::TaskPriority::kBestEffort};
+  return g_priorities[index];
+}
+
+static void applyAffinity(std::thread& thread, int index, const std::vector<int>& cpus) {
+#if defined(__linux__)
+  auto name = fmt::format("naga-worker-{}", index);
+  pthread_setname_np(thread.native_handle(), name.substr(0, 15).c_str());
+
+  if (cpus.empty()) {
+    return;
+  }
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (auto cpu : cpus) {
+    CPU_SET(cpu, &cpu_set);
+  }
+  if (pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set), &cpu_set) != 0) {
+    SPDLOG_WARN("unable to set CPU affinity of V8 worker thread #{}", index);
+  }
+#else
+  if (!cpus.empty()) {
+    SPDLOG_WARN("CPU affinity of V8 worker threads is not supported on this platform");
+  }
+#endif
+}
+
+WorkerPool::WorkerPool(WorkerPoolConfig config) : m_config(std::move(config)) {
+  if (m_config.m_num_workers <= 0) {
+    auto num_cpus = static_cast<int>(std::thread::hardware_concurrency());
+    m_config.m_num_workers = std::max(num_cpus - 1, 1);
+  }
+  TRACE("WorkerPool::WorkerPool {} num_workers={} best_effort_limit={}", THIS, m_config.m_num_workers,
+        m_config.m_best_effort_limit);
+
+  m_threads.reserve(m_config.m_num_workers);
+  for (auto i = 0; i < m_config.m_num_workers; i++) {
+    m_threads.emplace_back(&WorkerPool::WorkerMain, this, i);
+    applyAffinity(m_threads.back(), i, m_config.m_cpu_affinity);
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  TRACE("WorkerPool::~WorkerPool {}", THIS);
+  Terminate();
+}
+
+int WorkerPool::NumberOfWorkers() const {
+  return m_config.m_num_workers;
+}
+
+void WorkerPool::PostTask(v8::TaskPriority priority, TaskPtr task) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_terminated) {
+      return;
+    }
+    m_queues[queueIndex(priority)].push_back(std::move(task));
+  }
+  m_cv.notify_one();
+}
+
+void WorkerPool::PostDelayedTask(TaskPtr task, double delay_in_seconds) {
+  auto delay = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(delay_in_seconds));
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_terminated) {
+      return;
+    }
+    m_delayed_tasks.push_back(DelayedTask{Clock::now() + delay, std::move(task)});
+    std::push_heap(m_delayed_tasks.begin(), m_delayed_tasks.end(), IsLater);
+  }
+  // the new task might be due sooner than whatever a sleeping worker is waiting for
+  m_cv.notify_one();
+}
+
+void WorkerPool::Terminate() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_terminated) {
+      return;
+    }
+    m_terminated = true;
+  }
+  m_cv.notify_all();
+  for (auto& thread : m_threads) {
+    thread.join();
+  }
+  m_threads.clear();
+
+  // pending tasks are dropped, V8 does not expect them to run after platform shutdown
+  for (auto& queue : m_queues) {
+    queue.clear();
+  }
+  m_delayed_tasks.clear();
+}
+
+bool WorkerPool::IsLater(const DelayedTask& a, const DelayedTask& b) {
+  return a.m_deadline > b.m_deadline;
+}
+
+void WorkerPool::PromoteDueDelayedTasks(Clock::time_point now) {
+  // expects m_mutex to be held
+  while (!m_delayed_tasks.empty() && m_delayed_tasks.front().m_deadline <= now) {
+    std::pop_heap(m_delayed_tasks.begin(), m_delayed_tasks.end(), IsLater);
+    m_queues[queueIndex(v8::TaskPriority::kUserVisible)].push_back(std::move(m_delayed_tasks.back().m_task));
+    m_delayed_tasks.pop_back();
+  }
+}
+
+bool WorkerPool::CanRun(size_t queue_index) const {
+  // expects m_mutex to be held
+  if (m_queues[queue_index].empty()) {
+    return false;
+  }
+  if (queue_index == queueIndex(v8::TaskPriority::kBestEffort) && m_config.m_best_effort_limit > 0) {
+    return m_running_best_effort < m_config.m_best_effort_limit;
+  }
+  return true;
+}
+
+WorkerPool::TaskPtr WorkerPool::NextTask(v8::TaskPriority& priority) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true) {
+    if (m_terminated) {
+      return nullptr;
+    }
+
+    PromoteDueDelayedTasks(Clock::now());
+
+    for (size_t i = 0; i < kNumPriorities; i++) {
+      if (CanRun(i)) {
+        auto task = std::move(m_queues[i].front());
+        m_queues[i].pop_front();
+        priority = queuePriority(i);
+        if (priority == v8::TaskPriority::kBestEffort) {
+          m_running_best_effort++;
+        }
+        return task;
+      }
+    }
+
+    if (m_delayed_tasks.empty()) {
+      m_cv.wait(lock);
+    } else {
+      m_cv.wait_until(lock, m_delayed_tasks.front().m_deadline);
+    }
+  }
+}
+
+void WorkerPool::WorkerMain(int index) {
+  TRACE("WorkerPool::WorkerMain {} index={} [STARTED]", THIS, index);
+  v8::TaskPriority priority;
+  while (auto task = NextTask(priority)) {
+    task->Run();
+    task.reset();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_num_executed[queueIndex(priority)]++;
+    if (priority == v8::TaskPriority::kBestEffort) {
+      m_running_best_effort--;
+      // a throttled best-effort task might be waiting for this slot
+      m_cv.notify_one();
+    }
+  }
+  TRACE("WorkerPool::WorkerMain {} index={} [FINISHED]", THIS, index);
+}
+
+WorkerPool::Stats WorkerPool::CopyStats() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  Stats stats;
+  for (size_t i = 0; i < kNumPriorities; i++) {
+    stats.m_queued[i] = m_queues[i].size();
+  }
+  stats.m_executed = m_num_executed;
+  stats.m_delayed = m_delayed_tasks.size();
+  stats.m_running_best_effort = m_running_best_effort;
+  return stats;
+}
+
+py::dict WorkerPool::GetStats() {
+  // a worker blocked on m_mutex might hold the GIL (e.g. a task calling into Python), never allocate under the lock
+  auto stats = CopyStats();
+  py::dict py_queued;
+  py::dict py_executed;
+  for (size_t i = 0; i < kNumPriorities; i++) {
+    auto name = magic_enum::enum_name(queuePriority(i));
+    py_queued[py::str(name.data(), name.size())] = stats.m_queued[i];
+    py_executed[py::str(name.data(), name.size())] = stats.m_executed[i];
+  }
+  py::dict py_result;
+  py_result["workers"] = m_config.m_num_workers;
+  py_result["queued"] = py_queued;
+  py_result["delayed"] = stats.m_delayed;
+  py_result["executed"] = py_executed;
+  py_result["running_best_effort"] = stats.m_running_best_effort;
+  return py_result;
+}
+
+}  // namespace v8x
@@ -0,0 +1,81 @@
+#ifndef NAGA_V8XWORKERPOOL_H_
+#define NAGA_V8XWORKERPOOL_H_
+
+#include "Base.h"
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace v8x {
+
+// WorkerPool runs V8 background tasks (concurrent GC, off-thread compilation, etc.) on a fixed set of threads.
+//
+// Compared to the pool of V8's default platform it adds a few knobs useful when V8 shares a host with other workloads:
+// 1. the number of workers is configurable
+// 2. workers can be pinned to a set of CPUs
+// 3. tasks are kept in separate queues per v8::TaskPriority, workers always pick the most urgent task first
+// 4. the number of workers concurrently running best-effort tasks can be capped
+//
+// Delayed tasks are kept in a heap ordered by deadline and moved into the normal queue when they become due.
+
+struct WorkerPoolConfig {
+  int m_num_workers{0};  // 0 means one worker per CPU (minus one)
+  std::vector<int> m_cpu_affinity;  // CPUs the workers may run on, empty means no restriction
+  int m_best_effort_limit{0};  // max workers running best-effort tasks at the same time, 0 means no limit
+};
+
+class WorkerPool {
+  using TaskPtr = std::unique_ptr<v8::Task>;
+  using Clock = std::chrono::steady_clock;
+
+  struct DelayedTask {
+    Clock::time_point m_deadline;
+    TaskPtr m_task;
+  };
+
+  static constexpr size_t kNumPriorities = 3;
+
+  // counters copied under the mutex, Python objects are built only after it is released
+  struct Stats {
+    std::array<size_t, kNumPriorities> m_queued{};
+    std::array<uint64_t, kNumPriorities> m_executed{};
+    size_t m_delayed{0};
+    int m_running_best_effort{0};
+  };
+
+  WorkerPoolConfig m_config;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::array<std::deque<TaskPtr>, kNumPriorities> m_queues;
+  std::vector<DelayedTask> m_delayed_tasks;  // heap, earliest deadline at front
+  std::array<uint64_t, kNumPriorities> m_num_executed{};
+  std::vector<std::thread> m_threads;
+  int m_running_best_effort{0};
+  bool m_terminated{false};
+
+  static bool IsLater(const DelayedTask& a, const DelayedTask& b);
+  void WorkerMain(int index);
+  TaskPtr NextTask(v8::TaskPriority& priority);
+  void PromoteDueDelayedTasks(Clock::time_point now);
+  bool CanRun(size_t queue_index) const;
+  Stats CopyStats();
+
+ public:
+  explicit WorkerPool(WorkerPoolConfig config);
+  ~WorkerPool();
+
+  int NumberOfWorkers() const;
+  void PostTask(v8::TaskPriority priority, TaskPtr task);
+  void PostDelayedTask(TaskPtr task, double delay_in_seconds);
+  void Terminate();
+
+  py::dict GetStats();
+};
+
+}  // namespace v8x
+
+#endif
@@ -10,6 +10,8 @@
 #include "PythonUtils.h"
 #include "PybindExtensions.h"
 #include "JSEternals.h"
+#include "JSIsolateStats.h"
+#include "JSBoundaryProfiler.h"
 
 #define TRACE(...) \
   LOGGER_INDENT;   \
@@ -19,6 +21,31 @@ static auto createBindString(v8x::LockedIsolatePtr& v8_isolate) {
   return v8x::createEternalString(v8_isolate, "bind");
 }
 
+static py::object wrapObject(v8x::LockedIsolatePtr& v8_isolate,
+                             v8::Local<v8::Object> v8_obj,
+                             JSBoundaryScope& boundary) {
+  TRACE("wrapObject v8_isolate={} v8_obj={}", P$(v8_isolate), v8_obj);
+  assert(v8_isolate->InContext());
+  auto v8_scope = v8x::withScope(v8_isolate);
+
+  if (v8_obj.IsEmpty()) {
+    throw JSException(v8_isolate, "Unexpected empty V8 object handle.");
+  }
+
+  py::object py_result;
+  auto traced_raw_object = lookupTracedObject(v8_obj);
+  if (traced_raw_object) {
+    boundary.SetKind(JSBoundaryProfiler::kJSToPyTracedObject);
+    py_result = py::reinterpret_borrow<py::object>(traced_raw_object);
+  } else {
+    boundary.SetKind(JSBoundaryProfiler::kJSToPyJSObject);
+    py_result = wrap(v8_isolate, std::make_shared<JSObject>(v8_obj));
+  }
+
+  TRACE("=> {}", py_result);
+  return py_result;
+}
+
 py::object wrap(v8x::LockedIsolatePtr& v8_isolate, v8::Local<v8::Value> v8_val, v8::Local<v8::Object> v8_this) {
   TRACE("wrap v8_isolate={} v8_val={} v8_this={}", P$(v8_isolate), v8_val, v8_this);
 
@@ -47,86 +74,90 @@ py::object wrap(v8x::LockedIsolatePtr& v8_isolate, v8::Local<v8::Value> v8_val)
   TRACE("wrap v8_isolate={} v8_val={}", P$(v8_isolate), v8_val);
   assert(!v8_val.IsEmpty());
   assert(v8_isolate->InContext());
-  auto v8_scope = v8x::withScope(v8_isolate);
+  JSIsolateStats::FromV8(v8_isolate)->RecordJSToPy();
+  auto boundary = JSBoundaryScope(v8_isolate, JSBoundaryProfiler::kJSToPyJSObject);
 
+  // most values are converted without allocating new handles, branches that do allocate (String objects, boxing)
+  // open their own handle scope, objects get theirs in wrapObject
   if (v8_val->IsNull()) {
+    boundary.SetKind(JSBoundaryProfiler::kJSToPyNull);
     return py::js_null();
   }
   if (v8_val->IsUndefined()) {
+    boundary.SetKind(JSBoundaryProfiler::kJSToPyUndefined);
     return py::js_undefined();
   }
   if (v8_val->IsTrue()) {
+    boundary.SetKind(JSBoundaryProfiler::kJSToPyBool);
     return py::bool_(true);
   }
   if (v8_val->IsFalse()) {
+    boundary.SetKind(JSBoundaryProfiler::kJSToPyBool);
     return py::bool_(false);
   }
   if (v8_val->IsInt32()) {
-    auto v8_context = v8x::getCurrentContext(v8_isolate);
-    auto int32 = v8_val->Int32Value(v8_context).ToChecked();
+    boundary.SetKind(JSBoundaryProfiler::kJSToPyInt);
+    auto int32 = v8_val.As<v8::Int32>()->Value();
     return py::int_(int32);
   }
   if (v8_val->IsString()) {
+    boundary.SetKind(JSBoundaryProfiler::kJSToPyStr);
     auto v8_utf = v8x::toUTF(v8_isolate, v8_val.As<v8::String>());
     return py::str(*v8_utf, v8_utf.length());
   }
   if (v8_val->IsStringObject()) {
+    boundary.SetKind(JSBoundaryProfiler::kJSToPyStr);
+    auto v8_scope = v8x::withScope(v8_isolate);
     auto v8_utf = v8x::toUTF(v8_isolate, v8_val.As<v8::StringObject>()->ValueOf());
     return py::str(*v8_utf, v8_utf.length());
   }
   if (v8_val->IsBoolean()) {
+    boundary.SetKind(JSBoundaryProfiler::kJSToPyBool);
     bool val = v8_val->BooleanValue(v8_isolate);
     return py::bool_(val);
   }
   if (v8_val->IsBooleanObject()) {
+    boundary.SetKind(JSBoundaryProfiler::kJSToPyBool);
     auto val = v8_val.As<v8::BooleanObject>()->BooleanValue(v8_isolate);
     return py::bool_(val);
   }
   if (v8_val->IsNumber()) {
-    auto v8_context = v8x::getCurrentContext(v8_isolate);
-    auto val = v8_val->NumberValue(v8_context).ToChecked();
+    boundary.SetKind(JSBoundaryProfiler::kJSToPyFloat);
+    auto val = v8_val.As<v8::Number>()->Value();
     return py::float_(val);
   }
   if (v8_val->IsNumberObject()) {
-    auto v8_context = v8x::getCurrentContext(v8_isolate);
-    auto val = v8_val.As<v8::NumberObject>()->NumberValue(v8_context).ToChecked();
+    boundary.SetKind(JSBoundaryProfiler::kJSToPyFloat);
+    auto val = v8_val.As<v8::NumberObject>()->ValueOf();
     return py::float_(val);
   }
   if (v8_val->IsDate()) {
-    auto v8_context = v8x::getCurrentContext(v8_isolate);
-    auto val = v8_val.As<v8::Date>()->NumberValue(v8_context).ToChecked();
+    boundary.SetKind(JSBoundaryProfiler::kJSToPyDate);
+    auto val = v8_val.As<v8::Date>()->ValueOf();
     auto ts = static_cast<time_t>(floor(val / 1000));
     auto t = localtime(&ts);
     auto u = (static_cast<int64_t>(floor(val))) % 1000 * 1000;
     return pythonFromDateAndTime(t->tm_year + 1900, t->tm_mon + 1, t->tm_mday, t->tm_hour, t->tm_min, t->tm_sec, u);
   }
 
+  if (v8_val->IsObject()) {
+    auto py_result = wrapObject(v8_isolate, v8_val.As<v8::Object>(), boundary);
+    TRACE("=> {}", py_result);
+    return py_result;
+  }
+
+  // remaining primitives (symbols, bigints) get boxed
+  auto v8_scope = v8x::withScope(v8_isolate);
   auto v8_context = v8x::getCurrentContext(v8_isolate);
   auto v8_obj = v8_val->ToObject(v8_context).ToLocalChecked();
-  auto py_result = wrap(v8_isolate, v8_obj);
+  auto py_result = wrapObject(v8_isolate, v8_obj, boundary);
   TRACE("=> {}", py_result);
   return py_result;
 }
 
 py::object wrap(v8x::LockedIsolatePtr& v8_isolate, v8::Local<v8::Object> v8_obj) {
-  TRACE("wrap v8_isolate={} v8_obj={}", P$(v8_isolate), v8_obj);
-  assert(v8_isolate->InContext());
-  auto v8_scope = v8x::withScope(v8_isolate);
-
-  if (v8_obj.IsEmpty()) {
-    throw JSException(v8_isolate, "Unexpected empty V8 object handle.");
-  }
-
-  py::object py_result;
-  auto traced_raw_object = lookupTracedObject(v8_obj);
-  if (traced_raw_object) {
-    py_result = py::reinterpret_borrow<py::object>(traced_raw_object);
-  } else {
-    py_result = wrap(v8_isolate, std::make_shared<JSObject>(v8_obj));
-  }
-
-  TRACE("=> {}", py_result);
-  return py_result;
+  auto boundary = JSBoundaryScope(v8_isolate, JSBoundaryProfiler::kJSToPyJSObject);
+  return wrapObject(v8_isolate, v8_obj, boundary);
 }
 
 py::object wrap(v8x::LockedIsolatePtr& v8_isolate, v8::Local<v8::Array> v8_array) {
@@ -146,15 +177,19 @@ py::object wrap(v8x::LockedIsolatePtr& v8_isolate, const SharedJSObjectPtr& obj)
   return py_result;
 }
 
-static v8::Local<v8::Value> wrapWithTracing(v8x::LockedIsolatePtr& v8_isolate, py::handle py_handle) {
+static v8::Local<v8::Value> wrapWithTracing(v8x::LockedIsolatePtr& v8_isolate,
+                                            py::handle py_handle,
+                                            JSBoundaryScope& boundary) {
   TRACE("wrapWithTracing v8_isolate={} py_handle={}", P$(v8_isolate), py_handle);
 
   auto v8_wrapper = lookupTracedWrapper(v8_isolate, py_handle.ptr());
   if (!v8_wrapper.IsEmpty()) {
     // this is fast path, we've already seen this python object before and we have cached wrapper for it
+    boundary.SetKind(JSBoundaryProfiler::kPyToJSTracedWrapperHit);
     return v8_wrapper;
   } else {
     // this is first time we see this object, let's create a new wrapper for it
+    boundary.SetKind(JSBoundaryProfiler::kPyToJSTracedWrapperMiss);
     auto v8_context = v8x::getCurrentContext(v8_isolate);
     auto v8_wrapper_template = PythonObject::GetOrCreateCachedJSWrapperTemplate(v8_isolate);
     auto v8_new_wrapper = v8_wrapper_template->NewInstance(v8_context).ToLocalChecked();
@@ -167,15 +202,20 @@ static v8::Local<v8::Value> wrapWithTracing(v8x::LockedIsolatePtr& v8_isolate, p
   }
 }
 
-static v8::Local<v8::Value> wrapInternal(v8x::LockedIsolatePtr& v8_isolate, py::handle py_handle) {
+static v8::Local<v8::Value> wrapInternal(v8x::LockedIsolatePtr& v8_isolate,
+                                         py::handle py_handle,
+                                         JSBoundaryScope& boundary) {
   TRACE("wrapInternal v8_isolate={} py_handle={}", P$(v8_isolate), py_handle);
   if (py::isinstance<py::js_null>(py_handle)) {
+    boundary.SetKind(JSBoundaryProfiler::kPyToJSNull);
     return v8::Null(v8_isolate);
   }
   if (py::isinstance<py::js_undefined>(py_handle)) {
+    boundary.SetKind(JSBoundaryProfiler::kPyToJSUndefined);
     return v8::Undefined(v8_isolate);
   }
   if (py::isinstance<py::bool_>(py_handle)) {
+    boundary.SetKind(JSBoundaryProfiler::kPyToJSBool);
     auto py_bool = py::cast<py::bool_>(py_handle);
     if (py_bool) {
       return v8::True(v8_isolate);
@@ -184,17 +224,21 @@ static v8::Local<v8::Value> wrapInternal(v8x::LockedIsolatePtr& v8_isolate, py::
     }
   }
   if (py::isinstance<py::exact_int>(py_handle)) {
+    boundary.SetKind(JSBoundaryProfiler::kPyToJSInt);
     auto py_int = py::cast<py::exact_int>(py_handle);
     return v8::Integer::New(v8_isolate, py_int);
   }
   if (py::isinstance<py::exact_float>(py_handle)) {
+    boundary.SetKind(JSBoundaryProfiler::kPyToJSFloat);
     auto py_float = py::cast<py::exact_float>(py_handle);
     return v8::Number::New(v8_isolate, py_float);
   }
   if (py::isinstance<py::exact_str>(py_handle)) {
+    boundary.SetKind(JSBoundaryProfiler::kPyToJSStr);
     return v8x::toString(v8_isolate, py_handle);
   }
   if (isExactDateTime(py_handle) || isExactDate(py_handle)) {
+    boundary.SetKind(JSBoundaryProfiler::kPyToJSDate);
     tm ts = {0};
     int ms = 0;
     getPythonDateTime(py_handle, ts, ms);
@@ -203,6 +247,7 @@ static v8::Local<v8::Value> wrapInternal(v8x::LockedIsolatePtr& v8_isolate, py::
     return v8::Date::New(v8_context, time).ToLocalChecked();
   }
   if (isExactTime(py_handle)) {
+    boundary.SetKind(JSBoundaryProfiler::kPyToJSDate);
     tm ts = {0};
     int ms = 0;
     getPythonTime(py_handle, ts, ms);
@@ -211,22 +256,25 @@ static v8::Local<v8::Value> wrapInternal(v8x::LockedIsolatePtr& v8_isolate, py::
     return v8::Date::New(v8_context, time).ToLocalChecked();
   }
   if (py::isinstance<JSObject>(py_handle)) {
+    boundary.SetKind(JSBoundaryProfiler::kPyToJSJSObject);
     auto object = py::cast<SharedJSObjectPtr>(py_handle);
     assert(object.get());
     return object->ToV8(v8_isolate);
   }
 
   // fall back to synthesizing custom wrapper on the fly
-  return wrapWithTracing(v8_isolate, py_handle);
+  return wrapWithTracing(v8_isolate, py_handle, boundary);
 }
 
 v8::Local<v8::Value> wrap(const py::handle& py_handle) {
   TRACE("wrap py_handle={}", py_handle);
   auto v8_isolate = v8x::getCurrentIsolate();
   assert(v8_isolate->InContext());
-  auto v8_scope = v8x::withEscapableScope(v8_isolate);
+  JSIsolateStats::FromV8(v8_isolate)->RecordPyToJS();
+  auto boundary = JSBoundaryScope(v8_isolate, JSBoundaryProfiler::kPyToJSTracedWrapperMiss);
+  // no escapable scope here, the result would be the only handle escaping it in the common case
+  // our callers hold a handle scope and the few temporaries of wrapWithTracing end up there
   auto v8_try_catch = v8x::withAutoTryCatch(v8_isolate);
   auto py_gil = pyu::withGIL();
-  auto v8_result = wrapInternal(v8_isolate, py_handle);
-  return v8_scope.Escape(v8_result);
+  return wrapInternal(v8_isolate, py_handle, boundary);
 }
@@ -6,6 +6,11 @@ class JSContext;
 class JSEngine;
 class JSIsolate;
 class JSScript;
+class JSScriptFuture;
+class JSScriptStreamer;
+class JSModule;
+class JSModuleMap;
+class JSFunctionCache;
 class JSStackTrace;
 class JSStackTraceIterator;
 class JSStackFrame;
@@ -13,23 +18,35 @@ class JSException;
 class JSTracer;
 class JSHospital;
 class JSEternals;
+class JSIsolateStats;
+class JSBoundaryProfiler;
+class JSCpuProfiler;
+class JSHeapProfiler;
+class JSMailbox;
 class JSObject;
 class JSObjectKVIterator;
 class JSObjectArrayIterator;
+class JSSharedBuffer;
+class JSBundle;
 
 using SharedJSContextPtr = std::shared_ptr<JSContext>;
 using SharedJSIsolatePtr = std::shared_ptr<JSIsolate>;
 using SharedJSScriptPtr = std::shared_ptr<JSScript>;
+using SharedJSScriptFuturePtr = std::shared_ptr<JSScriptFuture>;
+using SharedJSModulePtr = std::shared_ptr<JSModule>;
 using SharedJSStackTracePtr = std::shared_ptr<JSStackTrace>;
 using SharedJSStackTraceIteratorPtr = std::shared_ptr<JSStackTraceIterator>;
 using SharedJSStackFramePtr = std::shared_ptr<JSStackFrame>;
 using SharedJSObjectPtr = std::shared_ptr<JSObject>;
 using SharedJSObjectKVIteratorPtr = std::shared_ptr<JSObjectKVIterator>;
 using SharedJSObjectArrayIteratorPtr = std::shared_ptr<JSObjectArrayIterator>;
+using SharedJSSharedBufferPtr = std::shared_ptr<JSSharedBuffer>;
+using SharedJSBundlePtr = std::shared_ptr<JSBundle>;
 
 namespace v8x {
 
 class LockedIsolatePtr;
+class Platform;
 class ProtectedIsolatePtr;
 
 using TryCatchPtr = v8::TryCatch*;
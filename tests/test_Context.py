@@ -8,7 +8,7 @@ import logging
 import naga.toolkit as toolkit
 # noinspection PyUnresolvedReferences
 import naga.aux as aux
-from naga import JSIsolate, JSContext, JSObject
+from naga import JSIsolate, JSContext, JSObject, JSError
 
 
 class TestContext(unittest.TestCase):
@@ -17,6 +17,31 @@ class TestContext(unittest.TestCase):
             self.assertEqual(2, context.eval("1+1"))
             self.assertEqual('Hello world', context.eval("'Hello ' + 'world'"))
 
+    def testEvalTimeout(self):
+        with JSContext() as context:
+            with self.assertRaises(TimeoutError):
+                context.eval("while (true) {}", timeout=0.05)
+
+            # the isolate stays usable after the timeout
+            self.assertEqual(2, context.eval("1+1", timeout=1))
+
+            spin = context.eval("(function spin(n) { while (true) {} })")
+            with self.assertRaises(TimeoutError):
+                toolkit.call_with_timeout(spin, 0.05, [1])
+
+            add = context.eval("(function add(a, b) { return a + b })")
+            self.assertEqual(3, toolkit.call_with_timeout(add, 1, [1, 2]))
+
+            # a timeout keyword is plain data for the JS function
+            echo = context.eval("(function echo(a, b) { return b })")
+            self.assertEqual(0.05, echo(1, timeout=0.05))
+
+            # thousands of long deadlines disarmed early do not pile up, a short one still fires
+            for i in range(5000):
+                self.assertEqual(i + 1, toolkit.call_with_timeout(add, 60, [i, 1]))
+            with self.assertRaises(TimeoutError):
+                toolkit.call_with_timeout(spin, 0.05, [1])
+
     # TODO: move this to isolate tests
     def testMultiNamespace(self):
         isolate = JSIsolate.current
@@ -103,6 +128,32 @@ class TestContext(unittest.TestCase):
             # with env2:
             #    self.assertRaises(JSError, toolkit.apply(spy2), env2.locals)
 
+    def testStructuredClone(self):
+        with JSContext() as ctx:
+            self.assertTrue(ctx.eval("""
+                var a = {x: [1, {y: 2}], d: new Date(0), m: new Map([[1, 'one']])};
+                var b = structuredClone(a);
+                b !== a && b.x[1] !== a.x[1] && b.x[1].y === 2 && b.d.getTime() === 0 && b.m.get(1) === 'one'
+            """))
+            self.assertTrue(ctx.eval("""
+                var buf = new ArrayBuffer(4);
+                new Uint8Array(buf)[0] = 42;
+                var moved = structuredClone(buf, {transfer: [buf]});
+                buf.byteLength === 0 && moved.byteLength === 4 && new Uint8Array(moved)[0] === 42
+            """))
+            self.assertFalse(ctx.eval("Object.keys(this).includes('structuredClone')"))
+            with self.assertRaises(JSError):
+                ctx.eval("structuredClone(function() {})")
+
+    def testSerialize(self):
+        with JSContext() as ctx:
+            data = toolkit.serialize({"a": [1, 2.5, "x", None, True], "b": b"\x00\x01"})
+            self.assertEqual({"a": [1, 2.5, "x", None, True], "b": b"\x00\x01"}, toolkit.deserialize(data, plain=True))
+            value = toolkit.deserialize(toolkit.serialize(ctx.eval("({m: new Map([[1, 2]])})")))
+            self.assertEqual(2, ctx.eval("(v) => v.m.get(1)")(value))
+            with self.assertRaises(ValueError):
+                toolkit.deserialize(b"garbage")
+
     def testEncounteringForeignContext(self):
         self.assertRaises(RuntimeError, aux.test_encountering_foreign_context)
 
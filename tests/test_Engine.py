@@ -1,11 +1,17 @@
 #!/usr/bin/env python
 # -*- coding: utf-8 -*-
 
+import io
+import os
 import sys
+import tempfile
+import threading
 import unittest
 import logging
 
-from naga import JSContext, JSEngine, JSScript, JSClass, JSObject, JSUndefined, JSIsolate
+from naga import JSContext, JSEngine, JSScript, JSScriptFuture, JSModule, JSBundle, JSClass, JSObject, JSUndefined, \
+    JSIsolate, JSError
+import naga.bundle
 import naga.toolkit as toolkit
 
 
@@ -27,6 +33,225 @@ class TestEngine(unittest.TestCase):
 
                 self.assertRaises(SyntaxError, engine.compile, "1+")
 
+    def testCompileStream(self):
+        source = "var greeting = 'přílišžluťoučký kůň'; function count(n) { return n * 2; }\n" * 2000 + "count(21)"
+
+        with JSContext():
+            with JSEngine() as engine:
+                s = engine.compile_stream(io.StringIO(source), "stream.js")
+
+                self.assertTrue(isinstance(s, JSScript))
+                self.assertEqual(source, s.source)
+                self.assertEqual(42, s.run())
+
+                # bytes chunks may split multi-byte characters
+                data = source.encode("utf-8")
+                chunks = (data[i:i + 1001] for i in range(0, len(data), 1001))
+                self.assertEqual(42, engine.compile_stream(chunks).run())
+
+                self.assertEqual(3, engine.compile_stream(["1", "+", "2"]).run())
+                self.assertRaises(SyntaxError, engine.compile_stream, ["1+"])
+                self.assertRaises(TypeError, engine.compile_stream, [1, 2])
+
+                def failing():
+                    yield "1+"
+                    raise IOError("broken stream")
+
+                with self.assertRaisesRegex(IOError, "broken stream"):
+                    engine.compile_stream(failing())
+
+    def testCompileAsync(self):
+        with JSContext():
+            with JSEngine() as engine:
+                source = "var x{0} = {0}; function f{0}() {{ return x{0} * 2; }}\nf{0}()"
+                sources = [source.format(i) for i in range(20)]
+                futures = [engine.compile_async(source, "script{}.js".format(i)) for i, source in enumerate(sources)]
+
+                self.assertTrue(isinstance(futures[0], JSScriptFuture))
+                self.assertEqual("script0.js", futures[0].name)
+
+                for i, future in enumerate(futures):
+                    self.assertTrue(future.wait())
+                    self.assertTrue(future.done())
+                    s = future.result()
+                    self.assertTrue(isinstance(s, JSScript))
+                    self.assertEqual(sources[i], s.source)
+                    self.assertEqual(i * 2, s.run())
+                    self.assertIs(s, future.result())
+
+                future = engine.compile_async("1+", "broken.js")
+                self.assertRaises(SyntaxError, future.result)
+                self.assertRaises(SyntaxError, future.result)
+
+            with tempfile.TemporaryDirectory() as path:
+                os.mkdir(os.path.join(path, "lib"))
+                for name, source in (("a.js", "1+1"), ("lib/b.js", "2+2"), ("lib/c.txt", "syntax error")):
+                    with open(os.path.join(path, name), "w") as f:
+                        f.write(source)
+
+                with JSEngine() as engine:
+                    scripts = toolkit.compile_directory(engine, path)
+                self.assertEqual(["a.js", os.path.join("lib", "b.js")], sorted(scripts))
+                self.assertEqual(4, scripts[os.path.join("lib", "b.js")].run())
+
+    def testCompileAsyncConcurrentResults(self):
+        results = []
+        with JSIsolate():
+            with JSContext():
+                with JSEngine() as engine:
+                    future = engine.compile_async("6 * 7", "answer.js")
+                    # the threads block on the isolate lock held by this thread, which finalizes the script
+                    threads = [threading.Thread(target=lambda: results.append(future.result())) for _ in range(2)]
+                    for t in threads:
+                        t.start()
+                    script = future.result()
+                    self.assertEqual(42, script.run())
+        for t in threads:
+            t.join()
+
+        self.assertEqual(2, len(results))
+        for result in results:
+            self.assertIs(script, result)
+
+    def testCompileFunction(self):
+        with JSIsolate() as isolate:
+            with JSContext() as ctx:
+                with JSEngine() as engine:
+                    add = engine.compile_function("return a + b;", ["a", "b"], name="add.js")
+
+                    self.assertTrue(isinstance(add, JSObject))
+                    self.assertEqual(5, add(2, 3))
+                    self.assertEqual("ab", add("a", "b"))
+
+                    self.assertEqual(1, isolate.function_cache_stats()["code_caches"])
+                    self.assertEqual(7, engine.compile_function("return a + b;", ["a", "b"])(3, 4))
+                    stats = isolate.function_cache_stats()
+                    self.assertEqual(2, stats["compiled"])
+                    self.assertEqual(1, stats["code_caches"])
+                    self.assertEqual(1, stats["code_cache_hits"])
+                    self.assertEqual(0, stats["code_cache_rejects"])
+                    self.assertEqual(0, stats["code_cache_evictions"])
+
+                    # same length, different source
+                    self.assertEqual(-1, engine.compile_function("return a - b;", ["a", "b"])(3, 4))
+                    stats = isolate.function_cache_stats()
+                    self.assertEqual(2, stats["code_caches"])
+                    self.assertEqual(1, stats["code_cache_hits"])
+
+                    config = ctx.eval("({scale: 3})")
+                    scale = engine.compile_function("return x * scale;", ["x"], context_extensions=[config])
+                    self.assertEqual(6, scale(2))
+                    self.assertEqual(2, isolate.function_cache_stats()["code_caches"])
+
+                    self.assertRaises(SyntaxError, engine.compile_function, "return a +;", ["a"])
+                    self.assertRaises(TypeError, engine.compile_function, "return 1;", [], [42])
+
+    def testModules(self):
+        sources = {
+            "lib/math.js": "export const two = 2; export function double(x) { return x * two; }",
+            "lib/main.js": "import { double } from './math.js'; export const url = import.meta.url; "
+                           "export default double(21);",
+        }
+        requested = []
+
+        def load(name):
+            requested.append(name)
+            return sources[name]
+
+        with JSIsolate() as isolate:
+            isolate.set_module_resolver(load=load)
+            with JSEngine() as engine:
+                with JSContext() as ctxt:
+                    ns = engine.import_module("lib/main.js")
+                    self.assertEqual(42, ns.default)
+                    self.assertEqual("lib/main.js", ns.url)
+                    self.assertEqual(["lib/main.js", "lib/math.js"], requested)
+
+                    # the module map hands out the same instance for every import in one context
+                    ctxt.eval("import('./lib/math.js').then(m => globalThis.m = m)")
+                    self.assertEqual(4, ctxt.eval("m.double(2)"))
+                    self.assertEqual(2, len(requested))
+
+                    ctxt.eval("import('missing.js').catch(e => globalThis.err = String(e))")
+                    self.assertIn("missing.js", ctxt.eval("err"))
+
+                    module = engine.compile_module("import { two } from 'lib/math.js'; export const four = two * two;",
+                                                   "inline.js")
+                    self.assertTrue(isinstance(module, JSModule))
+                    self.assertEqual("inline.js", module.name)
+                    self.assertEqual(["lib/math.js"], module.requests)
+                    self.assertEqual(4, module.evaluate().four)
+                    self.assertRaises(SyntaxError, engine.compile_module, "export const", "broken.js")
+
+                # a new context gets its own instances, compiled from the code caches of the first one
+                with JSContext():
+                    self.assertEqual(42, engine.import_module("lib/main.js").default)
+                    self.assertRaises(RuntimeError, module.evaluate)
+
+                stats = isolate.module_stats()
+                self.assertEqual(2, stats["code_cache_hits"])
+                self.assertEqual(0, stats["code_cache_rejects"])
+
+    def testModulesFromFiles(self):
+        with tempfile.TemporaryDirectory() as root:
+            os.mkdir(os.path.join(root, "sub"))
+            with open(os.path.join(root, "main.mjs"), "w") as f:
+                f.write("import { name } from './sub/dep.mjs'; export const greeting = 'hello ' + name;")
+            with open(os.path.join(root, "sub", "dep.mjs"), "w") as f:
+                f.write("export const name = 'modules';")
+
+            with JSContext():
+                with JSEngine() as engine:
+                    ns = engine.import_module(os.path.join(root, "main.mjs"))
+                    self.assertEqual("hello modules", ns.greeting)
+                    self.assertRaises(JSError, engine.import_module, "./nope.mjs", os.path.join(root, "main.mjs"))
+
+    def testBundle(self):
+        with tempfile.TemporaryDirectory() as root:
+            files = {
+                "prelude.js": "var greeting = '\u4f60\u597d'; greeting",
+                "app/main.mjs": "import { add } from '../lib/math.mjs'; export default add(40, 2);",
+                "lib/math.mjs": "export function add(a, b) { return a + b; }",
+            }
+            for name, source in files.items():
+                os.makedirs(os.path.dirname(os.path.join(root, name)), exist_ok=True)
+                with open(os.path.join(root, name), "w", encoding="utf-8") as f:
+                    f.write(source)
+            path = os.path.join(root, "app.nbundle")
+            naga.bundle.build(path, scripts=[os.path.join(root, "prelude.js")],
+                              modules=[os.path.join(root, "app/main.mjs"), os.path.join(root, "lib/math.mjs")],
+                              root=root)
+
+            bundle = JSBundle(path)
+            self.assertEqual(["app/main.mjs", "lib/math.mjs", "prelude.js"], bundle.names)
+            self.assertEqual({"../lib/math.mjs": "lib/math.mjs"}, bundle.requests("app/main.mjs"))
+            self.assertEqual(JSEngine.version, bundle.v8_version)
+
+            with JSIsolate() as isolate:
+                with JSContext():
+                    with JSEngine() as engine:
+                        self.assertEqual("\u4f60\u597d", engine.compile_bundled(bundle, "prelude.js").run())
+                        self.assertRaises(KeyError, engine.compile_bundled, bundle, "app/main.mjs")
+
+                        bundle.install()
+                        self.assertEqual(42, engine.import_module("app/main.mjs").default)
+                        self.assertRaises(JSError, engine.import_module, "missing.mjs")
+
+                module_stats = isolate.module_stats()
+                self.assertEqual(2, module_stats["code_cache_hits"])
+                self.assertEqual(0, module_stats["code_caches"])
+
+            stats = bundle.stats()
+            self.assertEqual(1, stats["scripts"])
+            self.assertEqual(2, stats["modules"])
+            self.assertTrue(stats["code_caches_usable"])
+            self.assertEqual(3, stats["sources_served"])
+
+            garbage_path = os.path.join(root, "garbage.nbundle")
+            with open(garbage_path, "wb") as f:
+                f.write(b"garbage" * 10)
+            self.assertRaises(ValueError, JSBundle, garbage_path)
+
     def testUnicodeSource(self):
         class Global(JSClass):
             var = u'测试'
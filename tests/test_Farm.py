@@ -0,0 +1,80 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+import logging
+import os
+import signal
+import sys
+import threading
+import unittest
+
+from naga.farm import JSFarm, JSFarmError, JSFarmWorkerCrashed, _HEAD_SLOT, _Ring
+
+BOOTSTRAP = """
+var api = {
+  add: (a, b) => a + b,
+  describe: (obj) => ({keys: Object.keys(obj).sort(), size: new Uint8Array(obj.data).length}),
+  fail: () => { throw new TypeError('boom'); },
+};
+"""
+
+
+class TestFarm(unittest.TestCase):
+    def testSubmit(self):
+        with JSFarm(workers=2, bootstrap=BOOTSTRAP) as farm:
+            futures = [farm.submit("api.add", i, i) for i in range(100)]
+            self.assertEqual([2 * i for i in range(100)], [f.result(timeout=60) for f in futures])
+            result = farm.submit("api.describe", {"b": [1, 2], "a": None, "data": b"\x01\x02\x03"}).result(timeout=60)
+            self.assertEqual({"keys": ["a", "b", "data"], "size": 3}, result)
+            self.assertEqual(2, len(farm.stats()["workers"]))
+
+    def testErrorsAndCrashes(self):
+        with JSFarm(workers=1, bootstrap=BOOTSTRAP) as farm:
+            with self.assertRaises(JSFarmError) as cm:
+                farm.submit("api.fail").result(timeout=60)
+            self.assertIn("boom", str(cm.exception))
+
+            victim = farm.stats()["workers"][0]["pid"]
+            os.kill(victim, signal.SIGKILL)
+            future = farm.submit("api.add", 1, 2)
+            try:
+                self.assertEqual(3, future.result(timeout=60))
+            except JSFarmWorkerCrashed:
+                # the request might have been sent to the dying worker, a replacement serves the next one
+                self.assertEqual(3, farm.submit("api.add", 1, 2).result(timeout=60))
+            stats = farm.stats()
+            self.assertEqual(1, stats["crashes"])
+            self.assertNotEqual(victim, stats["workers"][0]["pid"])
+
+    def testRingWrap(self):
+        ring = _Ring(256, threading.Semaphore(0))
+        try:
+            # records of 120, 112 and 16 bytes (16 bytes of header each) move the head to capacity - 8,
+            # the next record must wrap without room for a wrap marker
+            sizes = [104, 96, 0, 8, 104, 1, 104, 96, 0, 64]
+            for i, size in enumerate(sizes):
+                if i == 3:
+                    self.assertEqual(ring.capacity - 8, ring.atomics.load(_HEAD_SLOT))
+                payload = bytes([i]) * size
+                self.assertTrue(ring.try_write(1, i, payload))
+                self.assertTrue(ring.available.acquire(timeout=0))
+                self.assertEqual((1, i, payload), ring.read())
+            self.assertRaises(ValueError, ring.try_write, 1, 0, bytes(ring.max_record_size))
+        finally:
+            ring.close()
+
+    def testRecycling(self):
+        with JSFarm(workers=1, bootstrap=BOOTSTRAP, max_requests_per_worker=3) as farm:
+            first = farm.stats()["workers"][0]["pid"]
+            results = [farm.submit("api.add", i, 1).result(timeout=60) for i in range(4)]
+            self.assertEqual([1, 2, 3, 4], results)
+            stats = farm.stats()
+            self.assertEqual(1, stats["recycled"])
+            self.assertEqual(0, stats["crashes"])
+            self.assertNotEqual(first, stats["workers"][0]["pid"])
+
+
+if __name__ == '__main__':
+    level = logging.DEBUG if "-v" in sys.argv else logging.WARN
+    logging.basicConfig(level=level, format='%(asctime)s %(levelname)s %(message)s')
+    unittest.main()
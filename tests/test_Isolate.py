@@ -1,10 +1,15 @@
+import json
+import os
 import sys
+import tempfile
+import threading
 import unittest
 import logging
 
-from naga import JSIsolate, JSContext, JSNull
+from naga import JSIsolate, JSContext, JSEngine, JSNull, JSError, JSSharedBuffer, JSPlatform
 # noinspection PyUnresolvedReferences
 import naga.aux as aux
+import naga.toolkit as toolkit
 
 
 class TestIsolate(unittest.TestCase):
@@ -45,6 +50,372 @@ class TestIsolate(unittest.TestCase):
             self.assertEqual(JSNull, isolate.entered_or_microtask_context)
             self.assertEqual(JSNull, isolate.current_context)
 
+    def testHeapLimit(self):
+        with JSIsolate(max_old_space=32 * 1024 * 1024) as isolate:
+            self.assertFalse(isolate.out_of_memory)
+            with JSContext() as ctx:
+                add = ctx.eval("(function add(a, b) { return a + b })")
+                with self.assertRaises(MemoryError):
+                    ctx.eval("var a = []; while (true) { a.push(new Array(1000).fill('x')) }")
+                self.assertTrue(isolate.out_of_memory)
+
+                # the isolate is marked for disposal and refuses to run anything else
+                with self.assertRaises(MemoryError):
+                    ctx.eval("1 + 1")
+                with self.assertRaises(MemoryError):
+                    add(1, 2)
+                with JSEngine() as engine:
+                    with self.assertRaises(MemoryError):
+                        engine.compile_function("return 1;", [])
+
+        # other isolates are not affected
+        with JSIsolate() as isolate:
+            self.assertFalse(isolate.out_of_memory)
+            with JSContext() as ctx:
+                self.assertEqual(2, ctx.eval("1 + 1"))
+
+    def testStats(self):
+        with JSIsolate() as isolate:
+            with JSContext() as ctx:
+                ctx.eval("var a = []; for (var i = 0; i < 100000; i++) a.push({i: i}); a.length")
+                ctx.eval("(function(x) { return x })")(1)
+
+            stats = isolate.stats()
+            self.assertGreater(stats['heap']['used_heap_size'], 0)
+            self.assertIn('new_space', stats['heap_spaces'])
+            self.assertGreaterEqual(stats['compile']['count'], 2)
+            self.assertGreaterEqual(stats['execute']['count'], 2)
+            self.assertGreater(stats['execute']['time'], 0)
+            self.assertGreaterEqual(stats['conversions']['js_to_py'], 2)
+            self.assertGreaterEqual(stats['conversions']['py_to_js'], 1)
+            self.assertGreaterEqual(stats['gc']['scavenge']['count'], 1)
+            scavenge = stats['gc']['scavenge']
+            self.assertEqual(scavenge['count'], sum(scavenge['pause_histogram'].values()))
+
+            text = toolkit.format_prometheus(stats, labels={'isolate': 'test'})
+            self.assertIn('naga_gc_pause_seconds_bucket{isolate="test",kind="scavenge",le="+Inf"}', text)
+            self.assertIn('naga_execute_total{isolate="test"}', text)
+
+    def testBoundaryProfiler(self):
+        class Point:
+            def __init__(self):
+                self.x = 1
+
+        def callback(a, b):
+            return a + b
+
+        with JSIsolate() as isolate:
+            with JSContext() as ctx:
+                ctx.locals.point = Point()
+                ctx.locals.callback = callback
+                isolate.enable_boundary_profiler(sample_every=1)
+                ctx.eval("for (var i = 0; i < 100; i++) { point.x; callback('a', 'b') }")
+                profile = isolate.boundary_profile()
+                folded = isolate.boundary_profile_folded()
+                isolate.disable_boundary_profiler()
+
+                kinds = profile['kinds']
+                self.assertEqual(100, kinds['callback.NamedGetter']['count'])
+                self.assertEqual(100, kinds['callback.CallPythonCallable']['count'])
+                self.assertGreaterEqual(kinds['js_to_py.str']['count'], 200)
+                self.assertEqual(100, sum(kinds['callback.NamedGetter']['latency_histogram'].values()))
+                self.assertIn("callback.CallPythonCallable;js_to_py.str ", folded)
+
+                ctx.eval("point.x")
+                self.assertEqual(100, isolate.boundary_profile()['kinds']['callback.NamedGetter']['count'])
+
+    def testCpuProfile(self):
+        with JSIsolate() as isolate:
+            with JSContext() as ctx:
+                script = """
+                    function hot(n) { var s = 0; for (var i = 0; i < n; i++) s += Math.sqrt(i); return s }
+                    var end = Date.now() + 200; while (Date.now() < end) hot(10000);
+                """
+
+                isolate.start_cpu_profile("json", sampling_interval_us=100)
+                ctx.eval(script, "hot.js")
+                with tempfile.TemporaryDirectory() as tmp:
+                    path = os.path.join(tmp, "test.cpuprofile")
+                    text = isolate.stop_cpu_profile("json", path=path)
+                    with open(path) as f:
+                        self.assertEqual(text, f.read())
+
+                profile = json.loads(text)
+                self.assertGreater(len(profile['samples']), 0)
+                self.assertEqual(len(profile['samples']), len(profile['timeDeltas']))
+                hot_frames = [node['callFrame'] for node in profile['nodes'] if node['callFrame']['functionName'] == 'hot']
+                self.assertTrue(hot_frames)
+                self.assertEqual("hot.js", hot_frames[0]['url'])
+                self.assertEqual(1, hot_frames[0]['lineNumber'])
+
+                isolate.start_cpu_profile("folded", sampling_interval_us=100)
+                ctx.eval(script, "hot.js")
+                folded = isolate.stop_cpu_profile("folded", format="folded")
+                self.assertIn("hot (hot.js:2)", folded)
+
+                self.assertRaises(RuntimeError, isolate.stop_cpu_profile, "never-started")
+
+    def testHeapSnapshot(self):
+        class Payload:
+            pass
+
+        with JSIsolate() as isolate:
+            with JSContext() as ctx:
+                ctx.eval("function Leaky() { this.data = new Array(100).fill(0) }; var leaks = []")
+                ctx.locals.payload = Payload()
+                with tempfile.TemporaryDirectory() as tmp:
+                    before = os.path.join(tmp, "before.heapsnapshot")
+                    after = os.path.join(tmp, "after.heapsnapshot")
+                    isolate.write_heap_snapshot(before)
+                    ctx.eval("for (var i = 0; i < 1000; i++) leaks.push(new Leaky())")
+                    isolate.write_heap_snapshot(after)
+
+                    with open(after) as f:
+                        snapshot = json.load(f)
+                    self.assertIn("Naga JSContext", snapshot['strings'])
+                    self.assertTrue([s for s in snapshot['strings'] if s.startswith("Naga PythonObject")])
+
+                    report = toolkit.diff_heap_snapshots(before, after)
+                    leaky = [r for r in report if r['category'] == 'Leaky']
+                    self.assertTrue(leaky)
+                    self.assertEqual(1000, leaky[0]['count_delta'])
+                    self.assertGreater(leaky[0]['size_delta'], 0)
+
+                self.assertRaises(OSError, isolate.write_heap_snapshot, "/nonexistent-dir/x.heapsnapshot")
+
+    def testSamplingHeapProfiler(self):
+        with JSIsolate() as isolate:
+            with JSContext() as ctx:
+                isolate.start_sampling_heap_profiler(sample_interval=256, stack_depth=8)
+                self.assertRaises(RuntimeError, isolate.start_sampling_heap_profiler)
+                ctx.eval("""
+                    var kept = [];
+                    function allocator() { for (var i = 0; i < 1000; i++) kept.push({index: i, data: [i, i, i]}) }
+                    allocator();
+                """, "alloc.js")
+                for i in range(100):
+                    ctx.locals["host{}".format(i)] = "x" * 1000
+                report = isolate.stop_sampling_heap_profiler()
+
+                script_sites = [site for site in report['sites'] if site['origin'] == 'script']
+                self.assertTrue(script_sites)
+                allocator_sites = [site for site in script_sites if site['stack'][0]['function'] == 'allocator']
+                self.assertTrue(allocator_sites)
+                self.assertEqual("alloc.js", allocator_sites[0]['stack'][0]['url'])
+                for site in report['sites']:
+                    # allocations in builtins called by the script (e.g. push) count for the script
+                    if any(frame['url'] == "alloc.js" for frame in site['stack']):
+                        self.assertEqual("script", site['origin'])
+                        self.assertEqual("alloc.js", site['script_frame']['url'])
+                self.assertGreater(report['totals']['script'], 0)
+                self.assertGreater(report['totals']['host'], 0)
+
+                self.assertRaises(RuntimeError, isolate.allocation_report)
+
+    def testSamplingHeapProfilerSiblingStacks(self):
+        with JSIsolate() as isolate:
+            with JSContext() as ctx:
+                isolate.start_sampling_heap_profiler(sample_interval=256, stack_depth=8)
+                ctx.eval("""
+                    var kept = [];
+                    function left() { for (var i = 0; i < 1000; i++) kept.push({left: i, data: [i, i]}) }
+                    function right() { for (var i = 0; i < 1000; i++) kept.push({right: i, data: [i, i]}) }
+                    function outer() { left(); right(); }
+                    outer();
+                """, "siblings.js")
+                report = isolate.stop_sampling_heap_profiler()
+
+                for name in ("left", "right"):
+                    sites = [site for site in report['sites'] if site['stack'] and site['stack'][0]['function'] == name]
+                    self.assertTrue(sites)
+                    for site in sites:
+                        functions = [frame['function'] for frame in site['stack']]
+                        self.assertEqual([name, "outer", "(anonymous)"], functions)
+                        self.assertEqual(["siblings.js"] * 3, [frame['url'] for frame in site['stack']])
+
+    def testLeakAccounting(self):
+        class Payload:
+            pass
+
+        with JSIsolate():
+            with JSContext() as ctx:
+                aux.v8_request_gc_for_testing()
+                tracer_before = aux.tracer_stats()
+                handles_before = aux.handle_stats()
+                self.assertEqual(0, handles_before['handle_scope_level'])
+
+                payloads = [Payload() for _ in range(10)]
+                holder = ctx.eval("(function(list) { return list.map(function(p) { return {p: p} }) })")(payloads)
+                tracer = aux.tracer_stats()
+                self.assertEqual(tracer_before['live'] + 10, tracer['live'])
+                handles = aux.handle_stats()
+                self.assertGreaterEqual(handles['global']['tracer_wrapper'], 10)
+                self.assertGreater(handles['global']['js_object'], handles_before['global']['js_object'])
+
+                del holder
+                aux.v8_request_gc_for_testing()
+                self.assertLess(aux.handle_stats()['global']['js_object'], handles['global']['js_object'])
+
+                # JS errors made from Python exceptions keep the exception alive, the hospital releases it on GC
+                def fail():
+                    raise ValueError("patient")
+
+                ctx.locals.fail = fail
+                patients_before = aux.hospital_stats()['patients']
+                ctx.eval("var caught = []; for (var i = 0; i < 3; i++) { try { fail() } catch (e) { caught.push(e) } }")
+                patients = aux.hospital_stats()['patients']
+                self.assertEqual(patients_before + 3, patients)
+
+                ctx.eval("caught = null")
+                aux.v8_request_gc_for_testing()
+                self.assertLess(aux.hospital_stats()['patients'], patients)
+
+    def testTransfer(self):
+        target_isolate = JSIsolate()
+        with target_isolate:
+            target_ctx = JSContext()
+
+        with JSIsolate():
+            with JSContext() as ctx:
+                payload = ctx.eval("var buf = new ArrayBuffer(8); new Uint8Array(buf)[0] = 42; "
+                                   "({name: 'payload', items: [1, 2, {a: 3}], buf: buf})")
+                result = toolkit.transfer(payload, target_ctx, transfer=[ctx.eval("buf")])
+                self.assertEqual(0, ctx.eval("buf.byteLength"))
+                with self.assertRaises(JSError):
+                    toolkit.transfer(ctx.eval("(function() {})"), target_ctx)
+
+        with target_isolate:
+            with target_ctx:
+                target_ctx.locals.result = result
+                self.assertEqual("payload", target_ctx.eval("result.name"))
+                self.assertEqual(45, target_ctx.eval("result.items[2].a + new Uint8Array(result.buf)[0]"))
+
+    def testSharedBuffer(self):
+        shared = JSSharedBuffer(16)
+        self.assertEqual(16, shared.size)
+
+        isolate1 = JSIsolate()
+        with isolate1:
+            ctx1 = JSContext()
+        isolate2 = JSIsolate()
+        with isolate2:
+            ctx2 = JSContext()
+
+        shared.install(ctx1, "shared")
+        shared.install(ctx2, "shared")
+
+        with isolate1:
+            with ctx1:
+                ctx1.eval("Atomics.add(new Int32Array(shared), 0, 40)")
+        with isolate2:
+            with ctx2:
+                self.assertEqual(40, ctx2.eval("Atomics.add(new Int32Array(shared), 0, 2)"))
+        self.assertEqual(42, shared.load(0))
+        self.assertEqual(42, int.from_bytes(shared.memory[0:4], sys.byteorder))
+
+        shared.memory[4] = 7
+        with isolate1:
+            with ctx1:
+                self.assertEqual(7, ctx1.eval("new Uint8Array(shared)[4]"))
+
+        with self.assertRaises(IndexError):
+            shared.load(4)
+
+        self.assertEqual("not-equal", shared.wait(1, 1, timeout=0))
+        self.assertEqual("timed-out", shared.wait(1, 0, timeout=0.01))
+
+        def waiter(results):
+            results.append(shared.wait(1, 0, timeout=10))
+
+        results = []
+        thread = threading.Thread(target=waiter, args=(results,))
+        thread.start()
+        while shared.notify(1) == 0:
+            pass
+        thread.join()
+        self.assertEqual(["ok"], results)
+
+        # Atomics.notify in JS wakes Python waiters as well
+        results = []
+        thread = threading.Thread(target=waiter, args=(results,))
+        thread.start()
+        with isolate2:
+            with ctx2:
+                while ctx2.eval("Atomics.notify(new Int32Array(shared), 1)") == 0:
+                    pass
+        thread.join()
+        self.assertEqual(["ok"], results)
+
+        # NaN and negative counts wake nobody, infinite counts wake everybody
+        results = []
+        thread = threading.Thread(target=waiter, args=(results,))
+        thread.start()
+        with isolate2:
+            with ctx2:
+                for count in ("NaN", "-Infinity", "-1", "0.5"):
+                    self.assertEqual(0, ctx2.eval("Atomics.notify(new Int32Array(shared), 1, %s)" % count))
+                while ctx2.eval("Atomics.notify(new Int32Array(shared), 1, Infinity)") == 0:
+                    pass
+        thread.join()
+        self.assertEqual(["ok"], results)
+
+    def testSharedBufferOverMmap(self):
+        import mmap
+        memory = mmap.mmap(-1, mmap.PAGESIZE)
+        shared = JSSharedBuffer(memory)
+        with JSIsolate():
+            with JSContext() as ctx:
+                shared.install(ctx, "shared")
+                ctx.eval("new Int32Array(shared)[0] = 123")
+        self.assertEqual(123, int.from_bytes(memory[0:4], sys.byteorder))
+        self.assertEqual(mmap.PAGESIZE, shared.size)
+
+    def testMessageChannel(self):
+        isolate1 = JSIsolate()
+        with isolate1:
+            ctx1 = JSContext()
+        isolate2 = JSIsolate()
+        with isolate2:
+            ctx2 = JSContext()
+
+        toolkit.connect(ctx1, ctx2, "port")
+
+        with isolate2:
+            with ctx2:
+                ctx2.eval("var received = []; "
+                          "port.onmessage = (e) => { received.push(e.data); port.postMessage(e.data.n + 1); }")
+        with isolate1:
+            with ctx1:
+                ctx1.eval("var replies = []; port.onmessage = (e) => replies.push(e.data); "
+                          "var buf = new ArrayBuffer(4); "
+                          "port.postMessage({n: 1, buf: buf}, [buf]); port.postMessage({n: 2});")
+                self.assertEqual(0, ctx1.eval("buf.byteLength"))
+
+        # nothing gets delivered until the receiver pumps its message loop
+        stats = isolate2.message_stats()
+        self.assertEqual(2, stats["posted"])
+        self.assertEqual(2, stats["depth"])
+
+        platform = JSPlatform.instance
+        while platform.pump_message_loop(isolate2):
+            pass
+        with isolate2:
+            with ctx2:
+                self.assertEqual(2, ctx2.eval("received.length"))
+                self.assertEqual(4, ctx2.eval("received[0].buf.byteLength"))
+        stats = isolate2.message_stats()
+        self.assertEqual(2, stats["delivered"])
+        self.assertEqual(0, stats["depth"])
+        self.assertEqual(2, sum(stats["latency"]["histogram"].values()))
+
+        while platform.pump_message_loop(isolate1):
+            pass
+        with isolate1:
+            with ctx1:
+                self.assertEqual("2,3", ctx1.eval("replies.join()"))
+                ctx1.eval("port.close(); port.postMessage('ignored')")
+        self.assertEqual(2, isolate2.message_stats()["posted"])
+
     def testEncounteringForeignIsolate(self):
         self.assertRaises(RuntimeError, aux.test_encountering_foreign_isolate)
 
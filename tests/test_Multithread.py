@@ -88,6 +88,46 @@ class TestMultithread(unittest.TestCase):
                 self.assertTrue(isolate4.locked)
             self.assertTrue(isolate3.locked)
 
+    def testTimeSlicing(self):
+        import threading
+
+        isolate = JSIsolate()
+        isolate.enable_time_slicing(quantum=0.01)
+        self.assertTrue(isolate.time_slicing_enabled)
+
+        started = threading.Event()
+        finished = []
+
+        def long_runner():
+            with isolate:
+                with JSContext() as ctxt:
+                    started.set()
+                    ctxt.eval("var end = Date.now() + 1000; while (Date.now() < end) {}")
+
+        def short_runner():
+            started.wait()
+            with isolate:
+                with JSContext() as ctxt:
+                    self.assertEqual(2, ctxt.eval("1+1"))
+            finished.append(threading.current_thread())
+
+        threads = [threading.Thread(target=long_runner)] + [threading.Thread(target=short_runner) for _ in range(3)]
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+
+        # wall-clock latencies depend on the machine, the counters show the long script yielded to the short ones
+        self.assertEqual(3, len(finished))
+        stats = isolate.time_slicing_stats
+        self.assertGreaterEqual(stats['yields'], 1)
+        self.assertGreaterEqual(stats['handoffs'], 1)
+        self.assertGreaterEqual(stats['waits'], 3)
+        self.assertEqual(0, stats['waiters'])
+
+        isolate.disable_time_slicing()
+        self.assertFalse(isolate.time_slicing_enabled)
+
     def testMultiPythonThread(self):
         import time
         import threading
@@ -0,0 +1,163 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+import json
+import logging
+import subprocess
+import sys
+import textwrap
+import unittest
+
+
+# the platform can be initialized only once per process, so each configuration runs in a fresh interpreter
+def run_in_subprocess(code):
+    return subprocess.run([sys.executable, "-c", textwrap.dedent(code)], capture_output=True, text=True)
+
+
+class TestPlatform(unittest.TestCase):
+    def testDefaultPlatform(self):
+        from naga import JSPlatform
+        self.assertTrue(JSPlatform.instance.initialized)
+        self.assertGreater(JSPlatform.instance.worker_threads, 0)
+        self.assertIsNone(JSPlatform.instance.worker_stats)
+
+    def testWorkerPool(self):
+        result = run_in_subprocess("""
+            import naga.config
+            naga.config.naga_platform_options = {'worker_threads': 2, 'best_effort_limit': 1}
+            from naga import JSPlatform, JSContext
+            assert JSPlatform.instance.worker_threads == 2
+            stats = JSPlatform.instance.worker_stats
+            assert stats['workers'] == 2
+            assert set(stats['queued'].keys()) == {'kUserBlocking', 'kUserVisible', 'kBestEffort'}
+            with JSContext() as ctx:
+                assert ctx.eval("[1, 2, 3].map(x => x * 2).join()") == "2,4,6"
+            print("OK")
+        """)
+        self.assertEqual("OK", result.stdout.strip(), result.stderr)
+
+    def testIdleTasks(self):
+        result = run_in_subprocess("""
+            import naga.config
+            naga.config.naga_platform_options = {'idle_tasks': True}
+            from naga import JSPlatform, JSIsolate
+            isolate = JSIsolate.current
+            JSPlatform.instance.run_idle_tasks(isolate, 0.01)
+            while JSPlatform.instance.pump_message_loop(isolate):
+                pass
+            print("OK")
+        """)
+        self.assertEqual("OK", result.stdout.strip(), result.stderr)
+
+    def testInvalidCpuAffinity(self):
+        for cpus in ([-1], [0, 1 << 20]):
+            result = run_in_subprocess("""
+                import naga.config
+                naga.config.naga_platform_options = {'worker_threads': 1, 'cpu_affinity': CPUS}
+                try:
+                    import naga
+                except ValueError:
+                    print("OK")
+            """.replace("CPUS", repr(cpus)))
+            self.assertEqual("OK", result.stdout.strip(), result.stderr)
+
+    def testSingleThreadedOptionsConflict(self):
+        result = run_in_subprocess("""
+            import naga.config
+            naga.config.naga_platform_options = {'single_threaded': True, 'worker_threads': 2}
+            try:
+                import naga
+            except ValueError:
+                print("OK")
+        """)
+        self.assertEqual("OK", result.stdout.strip(), result.stderr)
+
+    def run_pre_fork(self, warm_up):
+        # the master initializes V8 and optionally warms up a context, forked workers use it right away
+        result = run_in_subprocess("""
+            import json, os, time
+            start = time.perf_counter()
+            import naga.config
+            naga.config.naga_platform_options = {'single_threaded': True}
+            from naga import JSPlatform, JSContext
+            ctx = JSContext()
+            ctx.enter()
+            if WARM_UP:
+                ctx.eval("var data = []; for (var i = 0; i < 100000; i++) data.push({i: i, s: 'item' + i});")
+            else:
+                ctx.eval("var data = {length: 100000, 99999: {i: 99999}};")
+            master_startup = time.perf_counter() - start
+
+            single_threaded = JSPlatform.instance.single_threaded
+            worker_threads = JSPlatform.instance.worker_threads
+            threads = len(os.listdir("/proc/self/task"))
+
+            def anonymous_shared_kb():
+                # V8 heap pages live in anonymous mappings, only pages still mapped by the master count as shared
+                shared = 0
+                anonymous = False
+                with open("/proc/self/smaps") as f:
+                    for line in f:
+                        fields = line.split()
+                        if "-" in fields[0] and not fields[0].endswith(":"):
+                            anonymous = len(fields) == 5
+                        elif anonymous and fields[0] in ("Shared_Clean:", "Shared_Dirty:"):
+                            shared += int(fields[1])
+                return shared
+
+            workers = []
+            for _ in range(2):
+                r, w = os.pipe()
+                pid = os.fork()
+                if pid == 0:
+                    os.close(r)
+                    start = time.perf_counter()
+                    value = ctx.eval("data.length + data[99999].i")
+                    worker_startup = time.perf_counter() - start
+                    report = {'value': value, 'startup': worker_startup, 'shared_kb': anonymous_shared_kb()}
+                    os.write(w, json.dumps(report).encode())
+                    os._exit(0)
+                os.close(w)
+                workers.append((pid, r))
+
+            reports = []
+            for pid, r in workers:
+                with os.fdopen(r) as f:
+                    reports.append(json.loads(f.read()))
+                os.waitpid(pid, 0)
+            print(json.dumps({'single_threaded': single_threaded, 'worker_threads': worker_threads, 'threads': threads,
+                              'master_startup': master_startup, 'workers': reports}))
+        """.replace("WARM_UP", repr(warm_up)))
+        self.assertEqual(0, result.returncode, result.stderr)
+        return json.loads(result.stdout.strip().splitlines()[-1])
+
+    @unittest.skipUnless(sys.platform.startswith("linux"), "relies on fork and /proc")
+    def testSingleThreadedPreFork(self):
+        report = self.run_pre_fork(warm_up=True)
+        control = self.run_pre_fork(warm_up=False)
+        for r in (report, control):
+            self.assertTrue(r['single_threaded'])
+            self.assertEqual(0, r['worker_threads'])
+            # no V8 background threads in the master
+            self.assertEqual(1, r['threads'])
+            self.assertEqual(2, len(r['workers']))
+            for worker in r['workers']:
+                self.assertEqual(199999, worker['value'])
+            # startup times depend on the machine, they are reported rather than compared
+            logging.info("pre-fork warm_up=%s master startup %.3fs, worker startups %s", r is report,
+                         r['master_startup'], ", ".join("%.3fs" % worker['startup'] for worker in r['workers']))
+
+        # 100k warmed-up objects take several MB of V8 heap, the workers share them copy-on-write with the master
+        warmed_kb = min(worker['shared_kb'] for worker in report['workers'])
+        control_kb = max(worker['shared_kb'] for worker in control['workers'])
+        self.assertGreater(warmed_kb - control_kb, 2048)
+
+    def testDoubleInit(self):
+        from naga import JSPlatform
+        self.assertFalse(JSPlatform.instance.init(worker_threads=1))
+
+
+if __name__ == '__main__':
+    level = logging.DEBUG if "-v" in sys.argv else logging.WARN
+    logging.basicConfig(level=level, format='%(asctime)s %(levelname)s %(message)s')
+    unittest.main()
@@ -945,6 +945,55 @@ class TestWrapper(unittest.TestCase):
             self.assertTrue(ctxt.eval('null == returnNone()'))
             self.assertTrue(ctxt.eval('null == returnNull()'))
 
+    def testCoroutineReturnsPromise(self):
+        import asyncio
+
+        loop = asyncio.new_event_loop()
+
+        class Global(JSClass):
+            def __init__(self):
+                self.results = []
+                self.done = loop.create_future()
+
+            async def double(self, x):
+                await asyncio.sleep(0)
+                return x * 2
+
+            async def fail(self):
+                await asyncio.sleep(0)
+                raise IndexError("out of range")
+
+            def report(self, value):
+                self.results.append(value)
+                if len(self.results) == 2:
+                    self.done.set_result(True)
+
+        g = Global()
+        isolate = JSIsolate.current
+        isolate.event_loop = loop
+        try:
+            with JSContext(g) as ctxt:
+                self.assertEqual("[object Promise]", ctxt.eval("Object.prototype.toString.call(double(1))"))
+                ctxt.eval("""
+                    Promise.all([double(1), double(2)]).then(v => report(v[0] + v[1]));
+                    fail().catch(e => report(e.name + ': ' + e.message));
+                """)
+                loop.run_until_complete(asyncio.wait_for(g.done, 5))
+        finally:
+            isolate.event_loop = None
+            loop.close()
+
+        self.assertEqual(sorted([6, "RangeError: out of range"], key=str), sorted(g.results, key=str))
+
+    def testCoroutineWithoutEventLoop(self):
+        class Global(JSClass):
+            async def double(self, x):
+                return x * 2
+
+        with JSContext(Global()) as ctxt:
+            message = ctxt.eval("try { double(1); 'no error' } catch (e) { e.message }")
+            self.assertIn("no running event loop", message)
+
 
 if __name__ == '__main__':
     level = logging.DEBUG if "-v" in sys.argv else logging.WARN